@@ -0,0 +1,759 @@
+// Microbenchmarks for the sweep kernels, random number generator, analysis and exact solver.
+// Results are written to stdout as JSON. With `--baseline`, each result is compared with the
+// one in a previous output, and the program fails if any of them regresses.
+// With `--check`, each engine is run at small L instead, and the program also fails if its
+// energy, specific heat or |m| deviates from the exact result, or its energy distribution from
+// that of `Ising2D_PBC`, beyond `--sigma` standard errors (see `Benchmark::RunCheck()`). Its
+// throughput is compared with the baseline as well.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <include/argagg/argagg.hpp>
+#include <include/rapidjson/document.h>
+#include <include/rapidjson/writer.h>
+
+#include "core/cpu-dispatch.h"
+#include "core/exact.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+#include "core/ising-2d-disordered.h"
+#include "core/ising-2d-n-fold.h"
+#include "core/ising-2d-replicas.h"
+#include "core/ising-2d-small.h"
+#include "core/parameter.h"
+#include "core/transfer-matrix.h"
+
+// "Windows.h" should be put after "rapidjson/document.h".
+// See https://github.com/Tencent/rapidjson/issues/766
+//     http://blog.csdn.net/u011519892/article/details/16985239
+#include "core/timing.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+const argagg::parser kBenchArgParser
+{ {
+    {
+        "baseline",
+        { "--baseline", "-b" },
+        "Compare with a previous output (JSON format).",
+        1
+    },
+    {
+        "threshold",
+        { "--threshold", "-t" },
+        "Relative slowdown regarded as a regression (default: 0.1).",
+        1
+    },
+    {
+        "time",
+        { "--time" },
+        "Minimum running time of each benchmark in seconds (default: 0.2).",
+        1
+    },
+    {
+        "cpu",
+        { "--cpu" },
+        "Instruction set of the kernels: auto (default), sse2, avx2, avx512.",
+        1
+    },
+    {
+        "quick",
+        { "--quick", "-q" },
+        "Only run small lattices.",
+        0
+    },
+    {
+        "check",
+        { "--check", "-c" },
+        "Check the engines against the exact results and each other instead.",
+        0
+    },
+    {
+        "sigma",
+        { "--sigma", "-s" },
+        "Deviation in standard errors regarded as a failed check (default: 4).",
+        1
+    },
+    {
+        "help",
+        { "--help", "-h" },
+        "Print help and exit.",
+        0
+    },
+} };
+
+// All the values are throughputs, i.e. larger is better.
+struct BenchmarkResult
+{
+    std::string name;
+    size_t      size;
+    double      temperature;
+    double      value;
+    std::string unit;
+    double      baseline_ratio;
+};
+
+// Sweep kernels to be compared. Append new engines here.
+// `make` gives a sweep of a warmed-up L * L lattice at `beta` (h = 0), or an empty function
+//   if the engine has no lattice of that size.
+typedef std::function<void()> SweepCall;
+struct SweepKernel
+{
+    std::string name;
+    std::function<SweepCall(const size_t &, const double &, const ExpArray &)> make;
+};
+
+const size_t kSweepWarmUp = 4;
+
+template <typename Lattice>
+SweepCall _ExpArraySweep(const size_t & size, const ExpArray & exp_array)
+{
+    auto s = std::make_shared<Lattice>(size);
+    s->Initialize();
+    for (size_t i = 0; i != kSweepWarmUp; ++i)
+        s->Sweep(exp_array);
+    return [s, exp_array]() { s->Sweep(exp_array); };
+}
+
+const std::vector<SweepKernel> kSweepKernels =
+{
+    { "sweep.metropolis", [](const size_t & size, const double & beta, const ExpArray & exp_array)
+    {
+        auto s = std::make_shared<Ising2D_PBC>(size);
+        s->Initialize();
+        for (size_t i = 0; i != kSweepWarmUp; ++i)
+            s->Sweep(exp_array);
+        return SweepCall([s, beta]() { s->Sweep(beta, 0.0); });
+    } },
+    { "sweep.expArray", [](const size_t & size, const double &, const ExpArray & exp_array)
+        { return _ExpArraySweep<Ising2D_PBC>(size, exp_array); } },
+    // The sizes dispatched to it by `RunPeriodic2D()`.
+    { "sweep.small", [](const size_t & size, const double &, const ExpArray & exp_array)
+    {
+        switch (size)
+        {
+        case 4:  return _ExpArraySweep<Ising2DSmall<4>>(size, exp_array);
+        case 8:  return _ExpArraySweep<Ising2DSmall<8>>(size, exp_array);
+        case 16: return _ExpArraySweep<Ising2DSmall<16>>(size, exp_array);
+        case 32: return _ExpArraySweep<Ising2DSmall<32>>(size, exp_array);
+        default: return SweepCall();
+        }
+    } },
+};
+
+// Checked observable of an engine, against the exact value or the reference engine.
+struct CheckResult
+{
+    std::string name;
+    std::string engine;
+    size_t      size;
+    double      temperature;
+    double      magnetic_h;
+    double      value;
+    double      reference;
+    double      error;
+    bool        passed;
+};
+
+// Engines checked by `--check`: `run` samples `sweeps` sweeps of a thermalized periodic L * L
+//   lattice, once per sweep (and lane). Append new engines here.
+typedef std::function<void(const Observable &)> Sampler;
+struct CheckEngine
+{
+    std::string name;
+    std::function<void(const size_t &, const double &, const double &, const size_t &,
+        const Sampler &)> run;
+};
+
+const size_t kCheckThermalization = 1 << 10;
+
+template <typename Lattice, typename Sweep>
+void _SampleEngine(Lattice & s, const Sweep & sweep, const double & magnetic_h,
+    const size_t & sweeps, const Sampler & sample)
+{
+    for (size_t i = 0; i != kCheckThermalization; ++i)
+        sweep();
+    for (size_t i = 0; i != sweeps; ++i)
+    {
+        sweep();
+        sample(s.Analysis(magnetic_h));
+    }
+}
+
+template <size_t L>
+void _SampleSmall(const double & beta, const double & magnetic_h, const size_t & sweeps,
+    const Sampler & sample)
+{
+    Ising2DSmall<L> s(L);
+    s.Initialize();
+    auto exp_array = InitializeExpArray(beta, magnetic_h);
+    _SampleEngine(s, [&]() { s.Sweep(exp_array); }, magnetic_h, sweeps, sample);
+}
+
+const std::vector<CheckEngine> kCheckEngines =
+{
+    // The reference of the energy distributions.
+    { "Ising2D_PBC.metropolis", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        Ising2D_PBC s(size);
+        s.Initialize();
+        _SampleEngine(s, [&]() { s.Sweep(beta, magnetic_h); }, magnetic_h, sweeps, sample);
+    } },
+    { "Ising2D_PBC.expArray", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        Ising2D_PBC s(size);
+        s.Initialize();
+        auto exp_array = InitializeExpArray(beta, magnetic_h);
+        _SampleEngine(s, [&]() { s.Sweep(exp_array); }, magnetic_h, sweeps, sample);
+    } },
+    { "Ising2DSmall", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        if (size == 4)
+            _SampleSmall<4>(beta, magnetic_h, sweeps, sample);
+        else
+            _SampleSmall<8>(beta, magnetic_h, sweeps, sample);
+    } },
+    { "Ising2DNFold", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        Ising2DNFold s(size);
+        s.Initialize();
+        auto exp_array = InitializeExpArray(beta, magnetic_h);
+        _SampleEngine(s, [&]() { s.Sweep(exp_array); }, magnetic_h, sweeps, sample);
+    } },
+    { "Ising2DDisordered.clean", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        Ising2DDisordered s(size);
+        s.Quench(Disorder(), 1);
+        auto table = s.Table(beta, magnetic_h);
+        _SampleEngine(s, [&]() { s.Sweep(table); }, magnetic_h, sweeps, sample);
+    } },
+    // As many samples as the others, from 16 lanes.
+    { "Ising2DReplicas", [](const size_t & size, const double & beta,
+        const double & magnetic_h, const size_t & sweeps, const Sampler & sample)
+    {
+        const size_t kLanes = 16;
+        Ising2DReplicas<kLanes> s(size);
+        vector<ReplicaLane> lanes;
+        for (size_t r = 0; r != kLanes; ++r)
+            lanes.push_back({ beta, magnetic_h, static_cast<unsigned int>(r + 1) });
+        s.Initialize(lanes);
+        for (size_t i = 0; i != kCheckThermalization; ++i)
+            s.Sweep();
+        for (size_t i = 0; i != sweeps / kLanes; ++i)
+        {
+            s.Sweep();
+            for (auto & observable : s.Analysis())
+                sample(observable);
+        }
+    } },
+};
+
+const double kIsingTc = 2.26918531421302196811;
+
+// Below, at and above T_c at h = 0 (`IsingExact2D`), and in a field (`TransferMatrix2D`). The
+//   temperatures are distinct, since they key the throughputs.
+const std::vector<size_t> kCheckSizeList = { 4, 8 };
+const std::vector<std::pair<double, double>> kCheckPointList =
+    { { 1.8, 0.0 }, { kIsingTc, 0.0 }, { 3.0, 0.0 }, { 2.5, 0.3 } };
+const size_t kCheckSweeps = 1 << 17;
+const size_t kCheckBlocks = 32;
+// Bins of the energy distribution rarer than that are not compared.
+const double kCheckMinProbability = 0.01;
+
+const std::vector<size_t> kSizeList      = { 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+const std::vector<size_t> kQuickSizeList = { 8, 16, 32, 64, 128, 256 };
+const std::vector<double> kTemperatureList = { 1.0, kIsingTc, 4.0 };
+const std::vector<size_t> kExactSizeList   = { 16, 256, 4096 };
+
+// Repeat `f` for at least `min_time` seconds (after a warm-up call).
+// Return the average running time of a single call in seconds.
+double _TimePerCall(const function<void()> & f, const double & min_time)
+{
+    f();
+    Timing clock;
+    size_t calls = 0;
+    clock.TimingBegin();
+    do
+    {
+        f();
+        calls += 1;
+        clock.TimingEnd();
+    } while (clock.GetRunningTime() < min_time);
+    return clock.GetRunningTime() / calls;
+}
+
+// Sums of the samples of a block of `--check`, with the energy distribution by the bond energy
+//   -sum_<ij> s_i s_j (an integer).
+struct CheckBlock
+{
+    CheckBlock() : count(0.0), energy(0.0), energy_square(0.0), magnetic_dipole_abs(0.0) {}
+
+    double count;
+    double energy;
+    double energy_square;
+    double magnetic_dipole_abs;
+    std::map<long long, double> distribution;
+};
+
+// Mean and standard error of the block means of `f`.
+pair<double, double> _BlockMean(const vector<CheckBlock> & blocks,
+    const function<double(const CheckBlock &)> & f)
+{
+    const auto n = static_cast<double>(blocks.size());
+    double mean = 0.0, variance = 0.0;
+    for (auto & block : blocks)
+        mean += f(block) / n;
+    for (auto & block : blocks)
+        variance += (f(block) - mean) * (f(block) - mean) / (n - 1.0);
+    return { mean, sqrt(variance / n) };
+}
+
+// Specific heat beta^2 N (<E^2> - <E>^2) of all the blocks, and its standard error by jackknife
+//   (leaving a block out at a time).
+pair<double, double> _JackknifeSpecificHeat(const vector<CheckBlock> & blocks,
+    const double & beta, const double & sites)
+{
+    auto specific_heat = [&beta, &sites](const double & count, const double & energy,
+        const double & energy_square)
+    {
+        return beta * beta * sites * (energy_square / count - pow(energy / count, 2));
+    };
+    double count = 0.0, energy = 0.0, energy_square = 0.0;
+    for (auto & block : blocks)
+    {
+        count         += block.count;
+        energy        += block.energy;
+        energy_square += block.energy_square;
+    }
+    const auto n = static_cast<double>(blocks.size());
+    vector<double> left_out;
+    double mean = 0.0, variance = 0.0;
+    for (auto & block : blocks)
+    {
+        left_out.push_back(specific_heat(count - block.count, energy - block.energy,
+            energy_square - block.energy_square));
+        mean += left_out.back() / n;
+    }
+    for (auto value : left_out)
+        variance += (value - mean) * (value - mean) * (n - 1.0) / n;
+    return { specific_heat(count, energy, energy_square), sqrt(variance) };
+}
+
+class Benchmark
+{
+public:
+    Benchmark(const double & min_time, const bool & quick, const double & sigma) :
+        min_time_(min_time), size_list_(quick ? kQuickSizeList : kSizeList), sigma_(sigma) {}
+
+    void Run()
+    {
+        FastRandInitialize(0);
+        RunSweep();
+        RunRand();
+        RunAnalysis();
+        RunExact();
+    }
+
+    // Statistical checks of the engines, with their throughputs.
+    void RunCheck();
+
+    // Return the number of regressions.
+    size_t CompareWith(const string & file_name, const double & threshold);
+
+    size_t CheckFailures() const
+    {
+        return count_if(check_list_.begin(), check_list_.end(),
+            [](const CheckResult & check) { return !check.passed; });
+    }
+
+    void PrintResults(ostream & os);
+
+private:
+    const double              min_time_;
+    const std::vector<size_t> size_list_;
+    const double              sigma_;
+
+    std::vector<BenchmarkResult> result_list_;
+    std::vector<CheckResult>     check_list_;
+
+    void Add(const string & name, const size_t & size, const double & temperature,
+        const double & value, const string & unit)
+    {
+        result_list_.push_back({ name, size, temperature, value, unit, 0.0 });
+        cerr << name << " (L = " << size << ", T = " << temperature << "): "
+             << value << " " << unit << endl;
+    }
+
+    // Passed if `value` is within `sigma_` standard errors of `reference` (or equal to it if
+    //   `error` is 0).
+    void Check(const string & name, const string & engine, const size_t & size,
+        const double & temperature, const double & magnetic_h, const double & value,
+        const double & reference, const double & error)
+    {
+        auto passed = error > 0.0 ? fabs(value - reference) <= sigma_ * error
+                                  : fabs(value - reference) <= 1.0e-12;
+        check_list_.push_back({ name, engine, size, temperature, magnetic_h, value, reference,
+            error, passed });
+        cerr << (passed ? "Passed: " : "FAILED: ") << name << " of " << engine << " (L = " << size
+             << ", T = " << temperature << ", h = " << magnetic_h << "): " << value << " vs "
+             << reference << " +- " << error << endl;
+    }
+
+    void RunSweep();
+    void RunRand();
+    void RunAnalysis();
+    void RunExact();
+};
+
+void Benchmark::RunSweep()
+{
+    for (auto size : size_list_)
+        for (auto T : kTemperatureList)
+            for (auto & kernel : kSweepKernels)
+            {
+                auto beta = 1.0 / T;
+                auto sweep = kernel.make(size, beta, InitializeExpArray(beta, 0.0));
+                if (!sweep)
+                    continue;
+                auto time = _TimePerCall(sweep, min_time_);
+                Add(kernel.name, size, T, size * size / (1.0e9 * time), "flips/ns");
+            }
+}
+
+void Benchmark::RunRand()
+{
+    const size_t kDraws = 1 << 20;
+    // Accumulate the results to prevent optimization.
+    unsigned int sink = 0;
+    auto time = _TimePerCall([&]()
+    {
+        for (size_t i = 0; i != kDraws; ++i)
+            sink += FastRand();
+    }, min_time_);
+    Add("rand.fastRand", 0, 0.0, kDraws / (1.0e9 * time), "draws/ns");
+    if (sink == 1)
+        cerr << endl;
+}
+
+void Benchmark::RunAnalysis()
+{
+    for (auto size : size_list_)
+    {
+        Ising2D_PBC s(size);
+        s.Initialize();
+        double sink = 0.0;
+        auto time = _TimePerCall([&]() { sink += s.Analysis(0.0).energy; }, min_time_);
+        Add("analysis", size, 0.0, size * size / (1.0e9 * time), "sites/ns");
+        if (sink == 1.0)
+            cerr << endl;
+    }
+}
+
+void Benchmark::RunExact()
+{
+    const double kAsymptoticTolerance = 1.0e-12;
+    for (auto size : kExactSizeList)
+        for (auto T : { 2.0, kIsingTc })
+        {
+            double sink = 0.0;
+            auto time = _TimePerCall([&]()
+            {
+                sink += IsingExact2D(size, T).SpecificHeat();
+            }, min_time_);
+            Add("exact.specificHeat", size, T, 1.0 / time, "evaluations/s");
+            time = _TimePerCall([&]()
+            {
+                sink += IsingExact2D(size, T, kAsymptoticTolerance).SpecificHeat();
+            }, min_time_);
+            Add("exact.specificHeat.asymptotic", size, T, 1.0 / time, "evaluations/s");
+            if (sink == 1.0)
+                cerr << endl;
+        }
+}
+
+// Each engine samples `kCheckSweeps` sweeps in `kCheckBlocks` blocks, each far longer than the
+//   autocorrelation time at these sizes, so that the block means are independent. The errors of
+//   <E> and <|m|> are those of the block means, and the specific heat (not a mean) is by jackknife.
+//   A right engine fails a check at 4 sigma with a probability of 6e-5, and the random numbers
+//   are seeded, so that the outcome is reproducible.
+// The energy distributions are compared bin by bin with the first engine, and the worst bin is
+//   reported.
+void Benchmark::RunCheck()
+{
+    for (auto size : kCheckSizeList)
+        for (auto & point : kCheckPointList)
+        {
+            auto T = point.first, h = point.second;
+            auto beta = 1.0 / T;
+            const auto sites = static_cast<double>(size * size);
+
+            // As `Ising2D::Analysis()`, each bond counted twice.
+            auto exact = TransferMatrix2D(size, size).Evaluate(T, h);
+            auto exact_energy = exact.observable.energy;
+            auto exact_specific_heat = exact.specific_heat;
+            if (h == 0.0)
+            {
+                IsingExact2D kaufman(size, T);
+                exact_energy = 2.0 * kaufman.Energy();
+                exact_specific_heat = 4.0 * kaufman.SpecificHeat();
+            }
+
+            vector<CheckBlock> reference;
+            for (auto & engine : kCheckEngines)
+            {
+                FastRandInitialize(1);
+                vector<CheckBlock> blocks(kCheckBlocks);
+                size_t samples = 0;
+                engine.run(size, beta, h, kCheckSweeps, [&](const Observable & observable)
+                {
+                    auto & block = blocks[min(samples++ * kCheckBlocks / kCheckSweeps,
+                        kCheckBlocks - 1)];
+                    block.count               += 1.0;
+                    block.energy              += observable.energy;
+                    block.energy_square       += observable.energy * observable.energy;
+                    block.magnetic_dipole_abs += observable.magnetic_dipole_abs;
+                    block.distribution[llround((observable.energy
+                        + h * observable.magnetic_dipole) * sites / 2.0)] += 1.0;
+                });
+
+                // The throughput without the sampling, but with `Analysis()` every sweep.
+                Timing clock;
+                clock.TimingBegin();
+                engine.run(size, beta, h, kCheckSweeps, [](const Observable &) {});
+                clock.TimingEnd();
+                Add("check." + engine.name, size, T,
+                    (kCheckSweeps + kCheckThermalization) * sites / (1.0e9 * clock.GetRunningTime()),
+                    "flips/ns");
+
+                auto energy = _BlockMean(blocks,
+                    [](const CheckBlock & b) { return b.energy / b.count; });
+                auto magnetic_dipole_abs = _BlockMean(blocks,
+                    [](const CheckBlock & b) { return b.magnetic_dipole_abs / b.count; });
+                auto specific_heat = _JackknifeSpecificHeat(blocks, beta, sites);
+                Check("energy", engine.name, size, T, h,
+                    energy.first, exact_energy, energy.second);
+                Check("specificHeat", engine.name, size, T, h,
+                    specific_heat.first, exact_specific_heat, specific_heat.second);
+                Check("magnetizationAbs", engine.name, size, T, h,
+                    magnetic_dipole_abs.first, exact.observable.magnetic_dipole_abs,
+                    magnetic_dipole_abs.second);
+
+                if (reference.empty())
+                {
+                    reference = blocks;
+                    continue;
+                }
+                map<long long, bool> levels;
+                for (auto & block : blocks)
+                    for (auto & bin : block.distribution)
+                        levels[bin.first] = true;
+                for (auto & block : reference)
+                    for (auto & bin : block.distribution)
+                        levels[bin.first] = true;
+                double worst = 0.0, worst_value = 0.0, worst_reference = 0.0, worst_error = 0.0;
+                for (auto & level : levels)
+                {
+                    auto probability = [&level](const CheckBlock & b)
+                    {
+                        auto iter = b.distribution.find(level.first);
+                        return iter == b.distribution.end() ? 0.0 : iter->second / b.count;
+                    };
+                    auto value = _BlockMean(blocks, probability);
+                    auto expected = _BlockMean(reference, probability);
+                    auto error = hypot(value.second, expected.second);
+                    if ((value.first + expected.first) / 2.0 < kCheckMinProbability || error == 0.0)
+                        continue;
+                    auto deviation = fabs(value.first - expected.first) / error;
+                    if (deviation >= worst)
+                    {
+                        worst = deviation;
+                        worst_value = value.first;
+                        worst_reference = expected.first;
+                        worst_error = error;
+                    }
+                }
+                Check("energyDistribution", engine.name, size, T, h,
+                    worst_value, worst_reference, worst_error);
+            }
+        }
+}
+
+string _ResultKey(const string & name, const size_t & size, const double & temperature)
+{
+    ostringstream key;
+    key << name << "/" << size << "/" << temperature;
+    return key.str();
+}
+
+size_t Benchmark::CompareWith(const string & file_name, const double & threshold)
+{
+    ifstream file(file_name);
+    string json_string = static_cast<stringstream const&>(stringstream() << file.rdbuf()).str();
+    file.close();
+
+    rapidjson::Document doc;
+    doc.Parse(json_string.c_str());
+    if (doc.HasParseError() || !doc.IsObject() || !doc.HasMember("benchmarks"))
+    {
+        cerr << "Invalid baseline file: " << file_name << endl;
+        return 1;
+    }
+
+    map<string, double> baseline;
+    for (auto & i : doc["benchmarks"].GetArray())
+        baseline[_ResultKey(i["name"].GetString(),
+            i["size"].GetUint64(), i["temperature"].GetDouble())] = i["value"].GetDouble();
+
+    size_t regressions = 0;
+    cerr << endl << "Comparing with baseline " << file_name << "..." << endl;
+    for (auto & result : result_list_)
+    {
+        auto iter = baseline.find(_ResultKey(result.name, result.size, result.temperature));
+        if (iter == baseline.end() || iter->second <= 0.0)
+            continue;
+        result.baseline_ratio = result.value / iter->second;
+        if (result.baseline_ratio < 1.0 - threshold)
+        {
+            regressions += 1;
+            cerr << "Regression: " << result.name << " (L = " << result.size
+                 << ", T = " << result.temperature << "): "
+                 << result.baseline_ratio << "x baseline" << endl;
+        }
+    }
+    cerr << regressions << " regression(s)." << endl;
+    return regressions;
+}
+
+void Benchmark::PrintResults(ostream & os)
+{
+    rapidjson::Document doc(rapidjson::Type::kObjectType);
+    auto & doc_allocator = doc.GetAllocator();
+
+    rapidjson::Value result_list_val(rapidjson::Type::kArrayType);
+    for (auto & result : result_list_)
+    {
+        rapidjson::Value result_val(rapidjson::Type::kObjectType);
+        result_val.AddMember("name",
+            rapidjson::Value(result.name.c_str(), doc_allocator), doc_allocator);
+        result_val.AddMember("size", static_cast<uint64_t>(result.size), doc_allocator);
+        result_val.AddMember("temperature", result.temperature, doc_allocator);
+        result_val.AddMember("value", result.value, doc_allocator);
+        result_val.AddMember("unit",
+            rapidjson::Value(result.unit.c_str(), doc_allocator), doc_allocator);
+        if (result.baseline_ratio > 0.0)
+            result_val.AddMember("baselineRatio", result.baseline_ratio, doc_allocator);
+        result_list_val.PushBack(result_val, doc_allocator);
+    }
+    doc.AddMember("instructionSet",
+        rapidjson::Value(CpuPathName(ActiveCpuPath()).c_str(), doc_allocator), doc_allocator);
+    doc.AddMember("benchmarks", result_list_val, doc_allocator);
+
+    if (!check_list_.empty())
+    {
+        rapidjson::Value check_list_val(rapidjson::Type::kArrayType);
+        for (auto & check : check_list_)
+        {
+            rapidjson::Value check_val(rapidjson::Type::kObjectType);
+            check_val.AddMember("name",
+                rapidjson::Value(check.name.c_str(), doc_allocator), doc_allocator);
+            check_val.AddMember("engine",
+                rapidjson::Value(check.engine.c_str(), doc_allocator), doc_allocator);
+            check_val.AddMember("size", static_cast<uint64_t>(check.size), doc_allocator);
+            check_val.AddMember("temperature", check.temperature, doc_allocator);
+            check_val.AddMember("magneticField", check.magnetic_h, doc_allocator);
+            check_val.AddMember("value", check.value, doc_allocator);
+            check_val.AddMember("reference", check.reference, doc_allocator);
+            check_val.AddMember("error", check.error, doc_allocator);
+            check_val.AddMember("passed", check.passed, doc_allocator);
+            check_list_val.PushBack(check_val, doc_allocator);
+        }
+        doc.AddMember("checks", check_list_val, doc_allocator);
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    doc.Accept(writer);
+
+    string json_str(buffer.GetString());
+    os << json_str << endl;
+}
+
+int PrintHelp(char * exe_name)
+{
+    ostringstream usage;
+    usage << endl
+          << "Usage: " << exe_name << " [OPTIONS...]" << endl
+          << endl;
+    argagg::fmt_ostream fmt(cerr);
+    fmt << usage.str() << kBenchArgParser;
+
+    return EXIT_SUCCESS;
+}
+
+int Run(int argc, char * argv[])
+{
+    argagg::parser_results args;
+    try
+    {
+        args = kBenchArgParser.parse(argc, argv);
+    }
+    catch (const exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (args["help"])
+        return PrintHelp(argv[0]);
+
+    if (args["cpu"] && !SelectCpuPath(args["cpu"].as<string>("auto")))
+    {
+        cerr << "Instruction set \"" << args["cpu"].as<string>("auto")
+             << "\" is unknown or not supported by this CPU." << endl;
+        return EXIT_FAILURE;
+    }
+
+    Benchmark bench(args["time"].as<double>(0.2), static_cast<bool>(args["quick"]),
+        args["sigma"].as<double>(4.0));
+    if (args["check"])
+        bench.RunCheck();
+    else
+        bench.Run();
+
+    size_t regressions = 0;
+    if (args["baseline"])
+        regressions = bench.CompareWith(args["baseline"].as<string>(""),
+            args["threshold"].as<double>(0.1));
+    auto failures = bench.CheckFailures();
+    if (args["check"])
+        cerr << failures << " failed check(s)." << endl;
+
+    bench.PrintResults(cout);
+    return regressions == 0 && failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+ISING_NAMESPACE_END
+
+int main(int argc, char * argv[])
+{
+    int exit_code = ising::Run(argc, argv);
+    return exit_code;
+}
@@ -0,0 +1,84 @@
+#include "core/adaptive-grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+// Deviation of the interior point `p` from the line through its neighbors, beyond twice
+//   its error bar.
+double _CurvatureDeviation(const vector<GridPoint> & curve, const size_t & p)
+{
+    auto & left  = curve[p - 1];
+    auto & point = curve[p];
+    auto & right = curve[p + 1];
+    auto weight = (point.temperature - left.temperature) / (right.temperature - left.temperature);
+    auto line = left.value + weight * (right.value - left.value);
+    return max(0.0, fabs(point.value - line) - 2.0 * point.error);
+}
+
+vector<double> RefineTemperatureGrid(const vector<vector<GridPoint>> & curves,
+    const double & tolerance, const double & min_step, const size_t & budget)
+{
+    if (curves.empty() || curves[0].size() < 2 || budget == 0 || tolerance <= 0.0)
+        return vector<double>();
+    const auto & kGrid = curves[0];
+    const auto kIntervals = kGrid.size() - 1;
+    const auto kRange = kGrid.back().temperature - kGrid.front().temperature;
+
+    // Score of each interval, refined if > 1.
+    vector<double> score(kIntervals, 0.0);
+    for (auto & curve : curves)
+    {
+        auto minmax = minmax_element(curve.begin(), curve.end(),
+            [](const GridPoint & a, const GridPoint & b) { return a.value < b.value; });
+        auto scale = minmax.second->value - minmax.first->value;
+        if (scale <= 0.0)
+            continue;
+
+        // Curvature.
+        for (size_t p = 1; p + 1 < curve.size(); ++p)
+        {
+            auto deviation = _CurvatureDeviation(curve, p) / (scale * tolerance);
+            score[p - 1] = max(score[p - 1], deviation);
+            score[p]     = max(score[p], deviation);
+        }
+
+        // Peak location: the points which may be the maximum within the error bars.
+        auto & peak = *minmax.second;
+        for (size_t p = 0; p != curve.size(); ++p)
+        {
+            if (curve[p].value + 2.0 * curve[p].error < peak.value - 2.0 * peak.error)
+                continue;
+            for (auto k : { p - 1, p })
+                if (k < kIntervals)
+                    score[k] = max(score[k],
+                        (kGrid[k + 1].temperature - kGrid[k].temperature) / (kRange * tolerance));
+        }
+    }
+
+    vector<pair<double, double>> candidates;
+    for (size_t k = 0; k != kIntervals; ++k)
+    {
+        auto width = kGrid[k + 1].temperature - kGrid[k].temperature;
+        if (score[k] > 1.0 && width / 2.0 >= min_step)
+            candidates.emplace_back(score[k], kGrid[k].temperature + width / 2.0);
+    }
+    sort(candidates.begin(), candidates.end(),
+        [](const pair<double, double> & a, const pair<double, double> & b) { return a.first > b.first; });
+    if (candidates.size() > budget)
+        candidates.resize(budget);
+
+    vector<double> temperatures;
+    for (auto & candidate : candidates)
+        temperatures.push_back(candidate.second);
+    return temperatures;
+}
+
+ISING_NAMESPACE_END
@@ -0,0 +1,33 @@
+#ifndef ISING_CORE_ADAPTIVE_GRID_H_
+#define ISING_CORE_ADAPTIVE_GRID_H_
+
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// A response function (e.g. specific heat) at a temperature, with its error bar.
+struct GridPoint
+{
+    double temperature;
+    double value;
+    double error;
+};
+
+// Adaptive temperature grid: the temperatures to add to a sampled grid, i.e. the midpoints
+//   of the intervals where any of the `curves` is not resolved yet.
+// Each curve is a list of points sorted by temperature, all curves on the same temperatures.
+// An interval is refined when
+//   * an end point deviates from the line through its neighbors by more than `tolerance`
+//     (relative to the range of the curve), beyond twice its error bar (curvature), or
+//   * an end point may be the peak of a curve within the error bars, and the interval is
+//     wider than `tolerance` of the temperature range (peak location),
+// and the new intervals would not be narrower than `min_step`.
+// At most `budget` temperatures are returned, the worst resolved intervals first.
+std::vector<double> RefineTemperatureGrid(const std::vector<std::vector<GridPoint>> & curves,
+    const double & tolerance, const double & min_step, const size_t & budget);
+
+ISING_NAMESPACE_END
+
+#endif
@@ -0,0 +1,85 @@
+#include "core/async-writer.h"
+
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+const size_t AsyncWriter::kDefaultCapacity;
+
+AsyncWriter::AsyncWriter(const size_t & capacity) :
+    capacity_(capacity == 0 ? 1 : capacity),
+    finished_(false),
+    thread_(&AsyncWriter::Loop, this) {}
+
+AsyncWriter::~AsyncWriter()
+{
+    Finish();
+}
+
+void AsyncWriter::Push(function<void()> job)
+{
+    unique_lock<mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return queue_.size() < capacity_; });
+    queue_.push_back(move(job));
+    not_empty_.notify_one();
+}
+
+void AsyncWriter::Finish()
+{
+    {
+        lock_guard<mutex> lock(mutex_);
+        finished_ = true;
+    }
+    not_empty_.notify_one();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void AsyncWriter::Loop()
+{
+    while (true)
+    {
+        function<void()> job;
+        {
+            unique_lock<mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return !queue_.empty() || finished_; });
+            if (queue_.empty())
+                return;
+            job = move(queue_.front());
+            queue_.pop_front();
+        }
+        not_full_.notify_one();
+        job();
+    }
+}
+
+JsonArrayStream::JsonArrayStream(ostream & os) :
+    os_(os),
+    next_(0)
+{
+    os_ << "[";
+}
+
+void JsonArrayStream::Put(const size_t & index, string element)
+{
+    pending_[index] = move(element);
+    for (auto it = pending_.begin(); it != pending_.end() && it->first == next_;
+         it = pending_.erase(it), ++next_)
+        os_ << (next_ == 0 ? "" : ",") << it->second;
+}
+
+void JsonArrayStream::Close()
+{
+    os_ << "]" << endl;
+}
+
+ISING_TOOLKIT_NAMESPACE_END
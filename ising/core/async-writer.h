@@ -0,0 +1,79 @@
+#ifndef ISING_CORE_ASYNC_WRITER_H_
+#define ISING_CORE_ASYNC_WRITER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "core/ising.h"
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Output thread overlapping the serialization and writing of results with the simulation.
+// Workers push a job for each completed cell onto a bounded queue and only block while the
+//   queue is full. A single output thread runs the jobs in the order they are pushed, so
+//   the jobs need no locking among themselves.
+// Usage:
+//     AsyncWriter output;
+//     /* In the parallel loop, after a cell is completed. */
+//     output.Push([=] { /* Serialize and write the cell. */ });
+//     /* After the parallel loop. */
+//     output.Finish();
+class AsyncWriter
+{
+public:
+    // Cells are coarse (seconds of sweeps each), so the queue hardly sees any contention
+    //   and a mutex is as good as a lock-free ring here.
+    static const size_t kDefaultCapacity = 64;
+
+    explicit AsyncWriter(const size_t & capacity = kDefaultCapacity);
+    ~AsyncWriter();
+
+    AsyncWriter(const AsyncWriter &) = delete;
+    AsyncWriter & operator=(const AsyncWriter &) = delete;
+
+    // Thread safe, called by the workers.
+    void Push(std::function<void()> job);
+    // Wait for the queued jobs and stop the output thread.
+    void Finish();
+
+private:
+    const size_t capacity_;
+
+    std::deque<std::function<void()>> queue_;
+    std::mutex              mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    bool                    finished_;
+    std::thread             thread_;
+
+    void Loop();
+};
+
+// Elements of a JSON array arriving in any order (e.g. cells of a parallel loop), written
+//   to `os` in index order as soon as all the elements before them have arrived.
+// The text is the same as writing the whole array at once.
+class JsonArrayStream
+{
+public:
+    explicit JsonArrayStream(std::ostream & os);
+
+    // `element` is the serialized JSON value of index `index`.
+    void Put(const size_t & index, std::string element);
+    // Write the closing bracket, after all the elements [0, n) have been put.
+    void Close();
+
+private:
+    std::ostream &                os_;
+    size_t                        next_;
+    std::map<size_t, std::string> pending_;
+};
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
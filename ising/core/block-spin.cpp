@@ -0,0 +1,117 @@
+#include "core/block-spin.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+string BlockRuleName(const BlockRule & rule)
+{
+    return rule == kDecimation ? "Decimation" : "Majority";
+}
+
+Lattice2D BlockSpin(const Lattice2D & lattice, const size_t & scale, const BlockRule & rule)
+{
+    auto x_size = lattice.size() / scale;
+    auto y_size = lattice.empty() ? 0 : lattice[0].size() / scale;
+    Lattice2D blocked(x_size, vector<int>(y_size));
+
+    if (rule == kDecimation)
+    {
+        for (size_t i = 0; i != x_size; ++i)
+            for (size_t j = 0; j != y_size; ++j)
+                blocked[i][j] = lattice[i * scale][j * scale];
+        return blocked;
+    }
+
+    // Sum the `scale` rows of a block row column by column (a contiguous loop, which is
+    //   vectorized), then sum `scale` successive columns.
+    const auto kColumns = y_size * scale;
+    vector<int> column_sum(kColumns);
+    for (size_t i = 0; i != x_size; ++i)
+    {
+        const auto & first_row = lattice[i * scale];
+        for (size_t k = 0; k != kColumns; ++k)
+            column_sum[k] = first_row[k];
+        for (size_t l = 1; l != scale; ++l)
+        {
+            const auto & row = lattice[i * scale + l];
+            for (size_t k = 0; k != kColumns; ++k)
+                column_sum[k] += row[k];
+        }
+        for (size_t j = 0; j != y_size; ++j)
+        {
+            int block_sum = 0;
+            for (size_t l = 0; l != scale; ++l)
+                block_sum += column_sum[j * scale + l];
+            blocked[i][j] = block_sum > 0 ? 1 : (block_sum < 0 ? -1 : first_row[j * scale]);
+        }
+    }
+    return blocked;
+}
+
+Observable LatticeObservable(const Lattice2D & lattice, const double & magnetic_h)
+{
+    const auto kXSize = lattice.size();
+    const auto kYSize = lattice.empty() ? 0 : lattice[0].size();
+    if (kXSize * kYSize == 0)
+        return Observable();
+    long long spin_total = 0, bond_total = 0;
+    for (size_t i = 0; i != kXSize; ++i)
+    {
+        const auto & row  = lattice[i];
+        const auto & down = lattice[i == kXSize - 1 ? 0 : i + 1];
+        for (size_t j = 0; j != kYSize; ++j)
+        {
+            spin_total += row[j];
+            bond_total += row[j] * (row[j == kYSize - 1 ? 0 : j + 1] + down[j]);
+        }
+    }
+    // Sum of (spin * nearest sum) counts each bond twice.
+    auto energy_total = 2 * bond_total;
+
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -static_cast<double>(energy_total) - magnetic_h * spin_total;
+    auto scale = static_cast<double>(kXSize * kYSize);
+    observable.magnetic_dipole /= scale;
+    observable.energy          /= scale;
+    observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    return observable;
+}
+
+BlockSpinMeasurement::BlockSpinMeasurement(const vector<size_t> & scales, const BlockRule & rule) :
+    scales_(scales),
+    rule_(rule),
+    sums_(scales.size()) {}
+
+void BlockSpinMeasurement::Measure(const Lattice2D & lattice, const double & magnetic_h)
+{
+    for (size_t i = 0; i != scales_.size(); ++i)
+        sums_[i] += LatticeObservable(BlockSpin(lattice, scales_[i], rule_), magnetic_h);
+    count_ += 1;
+}
+
+vector<Observable> BlockSpinMeasurement::Result() const
+{
+    vector<Observable> result(sums_.size());
+    if (count_ == 0)
+        return result;
+    for (size_t i = 0; i != sums_.size(); ++i)
+    {
+        result[i] = sums_[i];
+        result[i] /= static_cast<double>(count_);
+    }
+    return result;
+}
+
+ISING_NAMESPACE_END
@@ -0,0 +1,52 @@
+#ifndef ISING_CORE_BLOCK_SPIN_H_
+#define ISING_CORE_BLOCK_SPIN_H_
+
+#include <string>
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Block-spin (real space renormalization group) transforms of 2D lattices.
+// A b * b block becomes one spin:
+//   * majority:   the sign of the block sum, or the top left spin of the block for a tie;
+//   * decimation: the top left spin of the block.
+// Rows and columns that do not fill a whole block are dropped.
+// See `BlockRule` in "core/ising.h".
+
+std::string BlockRuleName(const BlockRule & rule);
+
+// The lattice blocked with the scale factor `scale` (b).
+Lattice2D BlockSpin(const Lattice2D & lattice, const size_t & scale, const BlockRule & rule);
+
+// Physical quantities of a lattice with periodic boundary condition, normalized as
+//   `Ising2D::Analysis()`.
+Observable LatticeObservable(const Lattice2D & lattice, const double & magnetic_h);
+
+// Averages of the observables of the blocked lattices at several scales, accumulated
+//   along a Monte Carlo run (see `Ising2D::Evaluate()`).
+class BlockSpinMeasurement
+{
+public:
+    BlockSpinMeasurement() = default;
+    BlockSpinMeasurement(const std::vector<size_t> & scales, const BlockRule & rule);
+
+    // Block `lattice` at all the scales and accumulate the observables.
+    void Measure(const Lattice2D & lattice, const double & magnetic_h);
+
+    // Averages for each scale (in the order of `scales`).
+    std::vector<Observable> Result() const;
+
+    inline bool Empty() const { return scales_.empty(); }
+
+private:
+    std::vector<size_t>     scales_;
+    BlockRule               rule_;
+    std::vector<Observable> sums_;
+    size_t                  count_ = 0;
+};
+
+ISING_NAMESPACE_END
+
+#endif
@@ -0,0 +1,141 @@
+#include "core/chebyshev.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <istream>
+#include <limits>
+#include <ostream>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+size_t Chebyshev::Fit(const function<double(double)> & f,
+    const double & a, const double & b, const double & tolerance)
+{
+    pieces_.clear();
+    return FitPiece(f, a, b, tolerance, 0);
+}
+
+double Chebyshev::operator()(const double & x) const
+{
+    return Evaluate(FindPiece(x), x);
+}
+
+bool Chebyshev::Accurate(const double & x) const
+{
+    return !FindPiece(x).coefficients.empty();
+}
+
+const Chebyshev::Piece & Chebyshev::FindPiece(const double & x) const
+{
+    // Find the last piece with `a <= x`. Points outside [a, b] are extrapolated.
+    auto iter = upper_bound(pieces_.begin(), pieces_.end(), x,
+        [](const double & value, const Piece & piece) { return value < piece.a; });
+    if (iter != pieces_.begin())
+        --iter;
+    return *iter;
+}
+
+void Chebyshev::Write(ostream & os) const
+{
+    const auto kDefaultPrecision = os.precision();
+    os.precision(numeric_limits<double>::max_digits10);
+    os << pieces_.size() << endl;
+    for (auto & piece : pieces_)
+    {
+        os << piece.a << " " << piece.b << " " << piece.coefficients.size();
+        for (auto c : piece.coefficients)
+            os << " " << c;
+        os << endl;
+    }
+    os.precision(kDefaultPrecision);
+}
+
+bool Chebyshev::Read(istream & is)
+{
+    size_t piece_count;
+    if (!(is >> piece_count))
+        return false;
+    pieces_.resize(piece_count);
+    for (auto & piece : pieces_)
+    {
+        size_t coefficient_count;
+        if (!(is >> piece.a >> piece.b >> coefficient_count))
+            return false;
+        piece.coefficients.resize(coefficient_count);
+        for (auto & c : piece.coefficients)
+            if (!(is >> c))
+                return false;
+    }
+    return true;
+}
+
+size_t Chebyshev::FitPiece(const function<double(double)> & f,
+    const double & a, const double & b, const double & tolerance, const size_t & depth)
+{
+    const double kMathPi = 3.14159265358979323846;
+    const auto n = kNodeCount;
+    const auto half_width = (b - a) / 2;
+    const auto middle     = (b + a) / 2;
+
+    // Values at the nodes x_k = cos(pi * (k + 1/2) / n).
+    vector<double> values(n);
+    for (size_t k = 0; k != n; ++k)
+        values[k] = f(middle + half_width * cos(kMathPi * (k + 0.5) / n));
+
+    // c_j = 2/n * \sum_k f(x_k) cos(pi * j * (k + 1/2) / n)
+    Piece piece = { a, b, vector<double>(n) };
+    for (size_t j = 0; j != n; ++j)
+    {
+        double sum = 0.0;
+        for (size_t k = 0; k != n; ++k)
+            sum += values[k] * cos(kMathPi * j * (k + 0.5) / n);
+        piece.coefficients[j] = 2.0 * sum / n;
+    }
+
+    // Check at the points between the nodes, where the interpolation error is the largest.
+    size_t evaluations = n;
+    bool accurate = true;
+    for (size_t k = 0; k != n - 1 && accurate; ++k)
+    {
+        auto x = middle + half_width * cos(kMathPi * (k + 1) / n);
+        accurate = fabs(Evaluate(piece, x) - f(x)) <= tolerance;
+        evaluations += 1;
+    }
+
+    if (accurate || depth == kMaxDepth)
+    {
+        if (!accurate)
+            piece.coefficients.clear();
+        pieces_.push_back(piece);
+        return evaluations;
+    }
+    evaluations += FitPiece(f, a, middle, tolerance, depth + 1);
+    evaluations += FitPiece(f, middle, b, tolerance, depth + 1);
+    return evaluations;
+}
+
+// Clenshaw's recurrence for f(x) = \sum_j c_j T_j(y) - c_0 / 2, y = (2x - a - b) / (b - a).
+double Chebyshev::Evaluate(const Piece & piece, const double & x) const
+{
+    auto & c = piece.coefficients;
+    if (c.empty())
+        return numeric_limits<double>::quiet_NaN();
+    auto y  = (2 * x - piece.a - piece.b) / (piece.b - piece.a);
+    auto y2 = 2 * y;
+    double d = 0.0, dd = 0.0;
+    for (auto j = c.size() - 1; j != 0; --j)
+    {
+        auto temp = d;
+        d  = y2 * d - dd + c[j];
+        dd = temp;
+    }
+    return y * d - dd + c[0] / 2;
+}
+
+ISING_TOOLKIT_NAMESPACE_END
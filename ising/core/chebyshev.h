@@ -0,0 +1,71 @@
+// Piecewise Chebyshev interpolation of a smooth function on [a, b].
+// See W.H.Press et al. *Numerical Recipes (3rd ed)* 5.8.
+
+#ifndef ISING_CORE_CHEBYSHEV_H_
+#define ISING_CORE_CHEBYSHEV_H_
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Usage:
+//     Chebyshev f_approx;
+//     f_approx.Fit(f, a, b, tolerance);
+//     f_approx(x);
+//
+// Each piece is interpolated at the Chebyshev nodes and then checked against `f` at the
+// points half-way between the nodes. Pieces failing the check are bisected recursively,
+// so only the intervals where `f` varies quickly (e.g. near the specific heat peak) are
+// refined. Pieces still failing at `kMaxDepth` are kept without coefficients: `Accurate()`
+// is false there, and `f` should be evaluated directly.
+class Chebyshev
+{
+public:
+    Chebyshev() = default;
+
+    // Return the number of evaluations of `f`. `a` should be less than `b`.
+    size_t Fit(const std::function<double(double)> & f,
+        const double & a, const double & b, const double & tolerance);
+
+    // NaN where not `Accurate()`.
+    double operator()(const double & x) const;
+    // Whether `x` is in a piece within the tolerance.
+    bool Accurate(const double & x) const;
+
+    bool Empty() const { return pieces_.empty(); }
+
+    // Plain text (de)serialization for caching on disk.
+    void Write(std::ostream & os) const;
+    bool Read(std::istream & is);
+
+private:
+    // Number of nodes (= degree + 1) on each piece.
+    const size_t kNodeCount = 24;
+    // Maximum depth of bisection.
+    const size_t kMaxDepth  = 24;
+
+    struct Piece
+    {
+        double a;
+        double b;
+        // Empty if the piece missed the tolerance.
+        std::vector<double> coefficients;
+    };
+
+    // Pieces are sorted and adjacent.
+    std::vector<Piece> pieces_;
+
+    const Piece & FindPiece(const double & x) const;
+    size_t FitPiece(const std::function<double(double)> & f,
+        const double & a, const double & b, const double & tolerance, const size_t & depth);
+    double Evaluate(const Piece & piece, const double & x) const;
+};
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
@@ -0,0 +1,147 @@
+#include "core/correlation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "core/fft.h"
+#include "core/ising.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+typedef complex<double> Complex;
+
+// 2D transform of `data` ([row][column]) in place, rows first.
+void _Transform2D(vector<vector<Complex>> & data, const Fft & row_fft, const Fft & column_fft,
+    vector<Complex> & line, const bool & inverse)
+{
+    for (auto & row : data)
+        inverse ? row_fft.Inverse(row) : row_fft.Forward(row);
+    line.resize(data.size());
+    for (size_t j = 0; j != row_fft.Size(); ++j)
+    {
+        for (size_t i = 0; i != data.size(); ++i)
+            line[i] = data[i][j];
+        inverse ? column_fft.Inverse(line) : column_fft.Forward(line);
+        for (size_t i = 0; i != data.size(); ++i)
+            data[i][j] = line[i];
+    }
+}
+
+// Shell of the offset (i, j) on a `rows` * `columns` torus, rounded distance to the origin.
+size_t _Shell(const size_t & i, const size_t & j, const size_t & rows, const size_t & columns)
+{
+    auto di = static_cast<double>(min(i, rows - i));
+    auto dj = static_cast<double>(min(j, columns - j));
+    return static_cast<size_t>(sqrt(di * di + dj * dj) + 0.5);
+}
+
+// Average of `values` ([row][column]) over the shells.
+vector<double> _ShellAverage(const vector<vector<double>> & values)
+{
+    const auto kRows = values.size();
+    const auto kColumns = values[0].size();
+    vector<double> sums(_Shell(kRows / 2, kColumns / 2, kRows, kColumns) + 1, 0.0);
+    vector<size_t> counts(sums.size(), 0);
+    for (size_t i = 0; i != kRows; ++i)
+        for (size_t j = 0; j != kColumns; ++j)
+        {
+            auto shell = _Shell(i, j, kRows, kColumns);
+            sums[shell]   += values[i][j];
+            counts[shell] += 1;
+        }
+    for (size_t k = 0; k != sums.size(); ++k)
+        sums[k] = counts[k] == 0 ? 0.0 : sums[k] / counts[k];
+    return sums;
+}
+
+void CorrelationMeasurement::Measure(const Lattice2D & lattice)
+{
+    if (lattice.empty() || lattice[0].empty())
+        return;
+    if (lattice.size() != rows_ || lattice[0].size() != columns_)
+    {
+        rows_       = lattice.size();
+        columns_    = lattice[0].size();
+        row_fft_    = Fft(columns_);
+        column_fft_ = Fft(rows_);
+        sums_.assign(rows_, vector<double>(columns_, 0.0));
+        transform_.assign(rows_, vector<Complex>(columns_));
+        count_ = 0;
+    }
+
+    // The lattice is real: two rows are transformed at once as (a + i b), and separated by
+    //   A_k = (Z_k + conj(Z_{n - k})) / 2, B_k = (Z_k - conj(Z_{n - k})) / 2i.
+    for (size_t i = 0; i < rows_; i += 2)
+    {
+        auto & z = transform_[i];
+        for (size_t j = 0; j != columns_; ++j)
+            z[j] = Complex(lattice[i][j], i + 1 < rows_ ? lattice[i + 1][j] : 0);
+        row_fft_.Forward(z);
+        if (i + 1 == rows_)
+            break;
+        auto & b = transform_[i + 1];
+        for (size_t j = 0; j != columns_; ++j)
+            b[j] = (z[j] - conj(z[(columns_ - j) % columns_])) * Complex(0.0, -0.5);
+        for (size_t j = 0; j != columns_; ++j)
+            z[j] -= Complex(0.0, 1.0) * b[j];
+    }
+    line_.resize(rows_);
+    for (size_t j = 0; j != columns_; ++j)
+    {
+        for (size_t i = 0; i != rows_; ++i)
+            line_[i] = transform_[i][j];
+        column_fft_.Forward(line_);
+        for (size_t i = 0; i != rows_; ++i)
+            sums_[i][j] += norm(line_[i]);
+    }
+    count_ += 1;
+}
+
+Correlation CorrelationMeasurement::Result() const
+{
+    Correlation correlation;
+    if (count_ == 0)
+        return correlation;
+
+    const auto kSites = static_cast<double>(rows_ * columns_);
+    vector<vector<double>> structure_factor(sums_);
+    vector<vector<Complex>> function(rows_, vector<Complex>(columns_));
+    for (size_t i = 0; i != rows_; ++i)
+        for (size_t j = 0; j != columns_; ++j)
+        {
+            structure_factor[i][j] /= count_ * kSites;
+            function[i][j] = structure_factor[i][j];
+        }
+    vector<Complex> line;
+    _Transform2D(function, row_fft_, column_fft_, line, true);
+    vector<vector<double>> function_real(rows_, vector<double>(columns_));
+    for (size_t i = 0; i != rows_; ++i)
+        for (size_t j = 0; j != columns_; ++j)
+            function_real[i][j] = function[i][j].real();
+
+    correlation.function = _ShellAverage(function_real);
+    correlation.structure_factor = _ShellAverage(structure_factor);
+
+    // Along both axes (the same for a square lattice).
+    if (rows_ > 1 && columns_ > 1)
+    {
+        // The rounding of the transforms leaves about 1e-30 S(0) in S(k_min) of ordered samples,
+        //   while a single flipped spin of N gives 4 / N^2 S(0).
+        const double kOrderedRatio = 1.0e-20;
+        auto s_min = (structure_factor[0][1] + structure_factor[1][0]) / 2.0;
+        auto k_min = 2.0 * 3.14159265358979323846 / columns_;
+        if (s_min > kOrderedRatio * structure_factor[0][0])
+        {
+            auto ratio = structure_factor[0][0] / s_min - 1.0;
+            correlation.length = ratio > 0.0 ? sqrt(ratio) / (2.0 * sin(k_min / 2.0)) : 0.0;
+        }
+    }
+    return correlation;
+}
+
+ISING_NAMESPACE_END
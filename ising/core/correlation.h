@@ -0,0 +1,57 @@
+#ifndef ISING_CORE_CORRELATION_H_
+#define ISING_CORE_CORRELATION_H_
+
+#include <complex>
+#include <vector>
+
+#include "core/fft.h"
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Spin correlations of an L * L lattice (periodic), with k = 2 pi (p, q) / L:
+//   S(k) = <|sum_x s_x exp(-i k x)|^2> / N              structure factor
+//   G(r) = <sum_x s_x s_{x + r}> / N                     correlation function
+//   xi   = sqrt(S(0) / S(k_min) - 1) / (2 sin(k_min / 2))
+//                                                        second-moment correlation length
+// with k_min = 2 pi / L (averaged over both axes). xi is 0 where it is undefined: S(0) <= S(k_min),
+//   or S(k_min) = 0 (up to rounding) as for fully ordered samples, where it is infinite.
+// G(r) and S(k) are averaged over shells:
+//   `function[i]` over |r| (minimum image) rounded to i lattice spacings, and
+//   `structure_factor[i]` over |k| rounded to i * 2 pi / L.
+struct Correlation
+{
+    std::vector<double> function;
+    std::vector<double> structure_factor;
+    double              length = 0.0;
+};
+
+// Correlations accumulated along a Monte Carlo run (see `Ising2D::Evaluate()`).
+// Each measurement is a 2D FFT of the lattice, O(N log N), and only |F(k)|^2 is accumulated.
+// G(r) is the inverse transform of S(k).
+class CorrelationMeasurement
+{
+public:
+    CorrelationMeasurement() = default;
+
+    // Transform `lattice` (rows of equal length) and accumulate |F(k)|^2 / N.
+    void Measure(const Lattice2D & lattice);
+
+    Correlation Result() const;
+
+private:
+    size_t                            rows_ = 0;
+    size_t                            columns_ = 0;
+    toolkit::Fft                      row_fft_;
+    toolkit::Fft                      column_fft_;
+    // [row][column], S(k) summed over the measurements.
+    std::vector<std::vector<double>>  sums_;
+    size_t                            count_ = 0;
+    // Work space of the transforms.
+    std::vector<std::vector<std::complex<double>>> transform_;
+    std::vector<std::complex<double>>              line_;
+};
+
+ISING_NAMESPACE_END
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef ISING_CORE_COUNTERS_H_
+#define ISING_CORE_COUNTERS_H_
+
+#include <array>
+#include <cstddef>
+
+#include "core/ising.h"
+
+// Performance counters of the kernels (`Ising2D::Sweep`, `Analysis` and `Evaluate`, and the
+//   same of the other lattice engines).
+// They are compiled in only with `-DISING_COUNTERS` (e.g. `make all COUNTERS=1`). Otherwise
+//   `ISING_COUNT()` expands to nothing, and neither the kernels nor the output change.
+
+#ifdef ISING_COUNTERS
+#define ISING_COUNT(_statement) _statement
+#else
+#define ISING_COUNT(_statement)
+#endif
+
+ISING_NAMESPACE_BEGIN
+
+// Each lattice owns its counters, so they are never shared between threads.
+// They are summed up after the parallel loop, without any locking.
+struct KernelCounters
+{
+    // The largest number of classes, see `ExpArray3D`.
+    static const std::size_t kMaxClassCount = 26;
+
+    KernelCounters(const std::size_t & classes = 0) :
+        class_count(classes),
+        sweeps(0),
+        analyses(0),
+        rand_draws(0),
+        attempted_by_class(),
+        accepted_by_class(),
+        sweep_time(0.0),
+        analysis_time(0.0),
+        serialize_time(0.0) {}
+
+    // Number of the classes used by the lattice.
+    std::size_t class_count;
+    std::size_t sweeps;
+    std::size_t analyses;
+    std::size_t rand_draws;
+
+    // Attempted and accepted flips, classified by the index of `ExpArray` (spin, nearest sum).
+    std::array<std::size_t, kMaxClassCount> attempted_by_class;
+    std::array<std::size_t, kMaxClassCount> accepted_by_class;
+
+    // Running time in seconds.
+    double sweep_time;
+    double analysis_time;
+    // Building the JSON value of a cell. The file itself is written by the output thread.
+    double serialize_time;
+
+    std::size_t AttemptedFlips() const
+    {
+        std::size_t sum = 0;
+        for (auto i : attempted_by_class)
+            sum += i;
+        return sum;
+    }
+
+    std::size_t AcceptedFlips() const
+    {
+        std::size_t sum = 0;
+        for (auto i : accepted_by_class)
+            sum += i;
+        return sum;
+    }
+
+    KernelCounters & operator+=(const KernelCounters & counters)
+    {
+        class_count     = class_count > counters.class_count ? class_count : counters.class_count;
+        sweeps         += counters.sweeps;
+        analyses       += counters.analyses;
+        rand_draws     += counters.rand_draws;
+        for (std::size_t i = 0; i != attempted_by_class.size(); ++i)
+        {
+            attempted_by_class[i] += counters.attempted_by_class[i];
+            accepted_by_class[i]  += counters.accepted_by_class[i];
+        }
+        sweep_time     += counters.sweep_time;
+        analysis_time  += counters.analysis_time;
+        serialize_time += counters.serialize_time;
+        return *this;
+    }
+};
+
+ISING_NAMESPACE_END
+
+#endif
@@ -0,0 +1,95 @@
+#include "core/cpu-dispatch.h"
+
+#include <string>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+#ifdef ISING_MULTIVERSION
+// CPUID (including the OS support of the YMM / ZMM states).
+bool _CpuSupports(const CpuPath & path)
+{
+    __builtin_cpu_init();
+    switch (path)
+    {
+    case kCpuAvx512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")
+            && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("fma");
+    case kCpuAvx2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    default:
+        return true;
+    }
+}
+
+// Paths that are actually compiled.
+bool _IsCompiled(const CpuPath &)
+{
+    return true;
+}
+#else
+bool _CpuSupports(const CpuPath & path)
+{
+    return path == kCpuSse2;
+}
+
+bool _IsCompiled(const CpuPath & path)
+{
+    return path == kCpuSse2;
+}
+#endif
+
+CpuPath DetectCpuPath()
+{
+    for (auto path : { kCpuAvx512, kCpuAvx2 })
+        if (_IsCompiled(path) && _CpuSupports(path))
+            return path;
+    return kCpuSse2;
+}
+
+// Detected once at startup.
+static CpuPath _active_cpu_path = DetectCpuPath();
+
+CpuPath ActiveCpuPath()
+{
+    return _active_cpu_path;
+}
+
+bool SelectCpuPath(const string & name)
+{
+    CpuPath path;
+    if (name == "auto")
+        path = DetectCpuPath();
+    else if (name == "sse2")
+        path = kCpuSse2;
+    else if (name == "avx2")
+        path = kCpuAvx2;
+    else if (name == "avx512")
+        path = kCpuAvx512;
+    else
+        return false;
+
+    if (!_IsCompiled(path) || !_CpuSupports(path))
+        return false;
+    _active_cpu_path = path;
+    return true;
+}
+
+string CpuPathName(const CpuPath & path)
+{
+    switch (path)
+    {
+    case kCpuAvx512:
+        return "AVX-512";
+    case kCpuAvx2:
+        return "AVX2";
+    default:
+        return "SSE2";
+    }
+}
+
+ISING_TOOLKIT_NAMESPACE_END
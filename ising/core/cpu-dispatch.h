@@ -0,0 +1,60 @@
+#ifndef ISING_CORE_CPU_DISPATCH_H_
+#define ISING_CORE_CPU_DISPATCH_H_
+
+#include <string>
+
+#include "core/ising.h"
+
+// Runtime selection of the instruction set used by the hot kernels.
+// Each kernel is compiled once per instruction set (with `ISING_TARGET_*`) from the same
+//   inline body, and the version to call is chosen by `ActiveCpuPath()`, which is
+//   detected by CPUID at startup and may be overridden by `SelectCpuPath()`.
+//
+// Multiversioning needs the `target` attribute of GCC / Clang on x86. Otherwise only the
+//   baseline version is compiled, and all the paths fall back to it.
+#if (defined __GNUC__ || defined __clang__) && (defined __x86_64__ || defined __i386__)
+#define ISING_MULTIVERSION
+#define ISING_TARGET_SSE2     __attribute__((target("sse2")))
+#define ISING_TARGET_AVX2     __attribute__((target("avx2,fma")))
+#define ISING_TARGET_AVX512   __attribute__((target("avx512f,avx512bw,avx512vl,avx2,fma")))
+#define ISING_ALWAYS_INLINE   inline __attribute__((always_inline))
+#else
+#define ISING_TARGET_SSE2
+#define ISING_TARGET_AVX2
+#define ISING_TARGET_AVX512
+#define ISING_ALWAYS_INLINE   inline
+#endif
+
+// The next loop has no dependencies between its iterations, e.g. through pointers which could
+//   alias, so that it can be vectorized.
+#if defined __clang__
+#define ISING_IVDEP           _Pragma("clang loop vectorize(assume_safety)")
+#elif defined __GNUC__
+#define ISING_IVDEP           _Pragma("GCC ivdep")
+#elif defined _MSC_VER
+#define ISING_IVDEP           __pragma(loop(ivdep))
+#else
+#define ISING_IVDEP
+#endif
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Ordered from the most portable to the fastest.
+enum CpuPath { kCpuSse2, kCpuAvx2, kCpuAvx512 };
+
+// The best path supported by both the CPU and the build.
+CpuPath DetectCpuPath();
+
+// The path used by the kernels (`DetectCpuPath()` unless overridden).
+CpuPath ActiveCpuPath();
+
+// Override the path by its name ("auto", "sse2", "avx2" or "avx512").
+// Return false (and keep the current path) if the name is unknown or the path is not
+//   supported by the CPU.
+bool SelectCpuPath(const std::string & name);
+
+std::string CpuPathName(const CpuPath & path);
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
@@ -0,0 +1,381 @@
+#include "core/dataset-server.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#ifndef _MSC_VER
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "core/info.h"
+#include "core/ising.h"
+#include "core/ising-2d-replicas.h"
+#include "core/parameter.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+DatasetServer::DatasetServer(const Parameter & param, const string & socket_path) :
+    socket_path_(socket_path),
+    equilibration_sweeps_(param.iterations),
+    sample_sweeps_(param.server_sample_sweeps),
+    temperature_count_(param.server_temperature_count),
+    max_size_(param.server_max_size),
+    max_chains_(param.server_max_chains),
+    seed_(param.seed),
+    stopping_(false) {}
+
+// Little-endian (native on the supported platforms) bytes of `value`.
+template <typename T>
+void _AppendBytes(vector<uint8_t> & bytes, const T & value)
+{
+    auto begin = reinterpret_cast<const uint8_t *>(&value);
+    bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+// Bytes of a lattice of size L, bits packed row by row.
+size_t _LatticeBytes(const size_t & size)
+{
+    return size * ((size + 7) / 8);
+}
+
+// Seed of the random stream of a lane of a chain (the same on all platforms).
+unsigned int _ChainSeed(const int & seed, const size_t & size, const double & temperature,
+    const double & magnetic_h, const size_t & lane)
+{
+    uint64_t t = 0, h = 0;
+    memcpy(&t, &temperature, sizeof(t));
+    memcpy(&h, &magnetic_h, sizeof(h));
+    seed_seq sequence{ static_cast<unsigned int>(seed), static_cast<unsigned int>(size),
+        static_cast<unsigned int>(t), static_cast<unsigned int>(t >> 32),
+        static_cast<unsigned int>(h), static_cast<unsigned int>(h >> 32),
+        static_cast<unsigned int>(lane) };
+    unsigned int chain_seed = 0;
+    sequence.generate(&chain_seed, &chain_seed + 1);
+    return chain_seed;
+}
+
+bool DatasetServer::ParseRequest(const string & line, DatasetRequest & request) const
+{
+    istringstream is(line);
+    request = { 0, 0.0, 0.0, 0, 0.0 };
+    is >> request.size >> request.t_begin >> request.t_end >> request.count;
+    // The header has the size, the count and the bytes per lattice in 32 bits.
+    const size_t kMaxHeaderValue = numeric_limits<uint32_t>::max();
+    if (is.fail() || request.size < 2 || request.size > max_size_
+        || _LatticeBytes(request.size) > kMaxHeaderValue || request.count > kMaxHeaderValue
+        || !(request.t_begin > 0.0 && request.t_end > 0.0)
+        || !isfinite(request.t_begin) || !isfinite(request.t_end))
+        return false;
+    if (!(is >> request.magnetic_h))
+        request.magnetic_h = 0.0;
+    return isfinite(request.magnetic_h);
+}
+
+vector<uint8_t> DatasetServer::Header(const DatasetRequest & request) const
+{
+    // All of them fit in 32 bits, see `ParseRequest()`.
+    vector<uint8_t> header = { 'I', 'S', 'N', 'G' };
+    header.reserve(header.size() + 3 * sizeof(uint32_t));
+    _AppendBytes(header, static_cast<uint32_t>(request.size));
+    _AppendBytes(header, static_cast<uint32_t>(request.count));
+    _AppendBytes(header, static_cast<uint32_t>(_LatticeBytes(request.size)));
+    return header;
+}
+
+void DatasetServer::Record(const DatasetRequest & request, const size_t & index,
+    vector<uint8_t> & record)
+{
+    const auto kPoints = request.t_begin == request.t_end ? 1 : temperature_count_;
+    auto point = index % kPoints;
+    auto temperature = kPoints == 1 ? request.t_begin :
+        request.t_begin + (request.t_end - request.t_begin) * point / (kPoints - 1);
+    Sample(request.size, temperature, request.magnetic_h, record);
+}
+
+size_t DatasetServer::ChainCount()
+{
+    lock_guard<mutex> lock(chains_mutex_);
+    return chains_.size();
+}
+
+shared_ptr<DatasetServer::Chain> DatasetServer::FindChain(const size_t & size,
+    const double & temperature, const double & magnetic_h)
+{
+    lock_guard<mutex> lock(chains_mutex_);
+    auto & entry = chains_[ChainKey(size, { temperature, magnetic_h })];
+    entry.second = ++chain_clock_;
+    if (entry.first)
+        return entry.first;
+
+    auto chain = make_shared<Chain>(size);
+    entry.first = chain;
+    // Drop the least recently used chain. A client still sampling it keeps it alive.
+    if (chains_.size() > max_chains_)
+    {
+        auto oldest = chains_.begin();
+        for (auto iter = chains_.begin(); iter != chains_.end(); ++iter)
+            if (iter->second.second < oldest->second.second)
+                oldest = iter;
+        chains_.erase(oldest);
+    }
+    return chain;
+}
+
+void DatasetServer::Sample(const size_t & size, const double & temperature,
+    const double & magnetic_h, vector<uint8_t> & record)
+{
+    auto chain = FindChain(size, temperature, magnetic_h);
+    lock_guard<mutex> lock(chain->mutex);
+    auto & lattices = chain->lattices;
+    if (!chain->equilibrated)
+    {
+        vector<ReplicaLane> lanes;
+        for (size_t r = 0; r != kChainLanes; ++r)
+            lanes.push_back({ 1.0 / temperature, magnetic_h,
+                _ChainSeed(seed_, size, temperature, magnetic_h, r) });
+        lattices.Initialize(lanes);
+        for (size_t i = 0; i != equilibration_sweeps_; ++i)
+            lattices.Sweep();
+        chain->equilibrated = true;
+    }
+    if (chain->next_lane == kChainLanes)
+    {
+        for (size_t i = 0; i != sample_sweeps_; ++i)
+            lattices.Sweep();
+        chain->observables = lattices.Analysis();
+        chain->next_lane = 0;
+    }
+    auto lane = chain->next_lane++;
+
+    auto & observable = chain->observables[lane];
+    _AppendBytes(record, temperature);
+    _AppendBytes(record, magnetic_h);
+    _AppendBytes(record, observable.energy);
+    _AppendBytes(record, observable.magnetic_dipole);
+    auto spins = lattices.Spins();
+    for (size_t x = 0; x != size; ++x)
+        for (size_t y = 0; y < size; y += 8)
+        {
+            uint8_t byte = 0;
+            for (size_t k = 0; k != 8 && y + k != size; ++k)
+                byte |= (spins[(x * size + y + k) * kChainLanes + lane] > 0 ? 1 : 0) << (7 - k);
+            record.push_back(byte);
+        }
+}
+
+void DatasetServer::Stop()
+{
+    stopping_ = true;
+}
+
+void DatasetServer::PrintParameters(ostream & os)
+{
+    os << endl << InformationSeparator() << endl;
+
+    os << "* Serve lattice data generated with Monte Carlo algorithm" << endl
+       << "*" << endl
+       << "* Parameters:" << endl;
+
+    os << "*   Socket:             "
+       << socket_path_ << endl
+       << "*   Equilibration:      "
+       << equilibration_sweeps_ << " sweeps" << endl
+       << "*   Between samples:    "
+       << sample_sweeps_ << " sweeps" << endl
+       << "*   Temperature points: "
+       << temperature_count_ << endl
+       << "*   Maximum size:       "
+       << max_size_ << endl
+       << "*   Maximum chains:     "
+       << max_chains_ << endl
+       << "*   Seed:               "
+       << seed_ << endl
+       << InformationSeparator() << endl << endl;
+}
+
+#ifndef _MSC_VER
+
+// Set by SIGINT and SIGTERM.
+static volatile sig_atomic_t _stop_signal = 0;
+
+void _StopSignal(int)
+{
+    _stop_signal = 1;
+}
+
+// Send all of `bytes`. Return false if the client has gone.
+bool _SendAll(const int & client, const vector<uint8_t> & bytes)
+{
+#ifdef MSG_NOSIGNAL
+    const int kFlags = MSG_NOSIGNAL;
+#else
+    const int kFlags = 0;
+#endif
+    size_t sent = 0;
+    while (sent != bytes.size())
+    {
+        auto n = send(client, bytes.data() + sent, bytes.size() - sent, kFlags);
+        if (n <= 0)
+            return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void DatasetServer::Serve(Client & client)
+{
+    // Read the request line.
+    string line;
+    char c;
+    while (line.size() < 256 && recv(client.socket, &c, 1, 0) == 1 && c != '\n')
+        line.push_back(c);
+
+    DatasetRequest request;
+    if (!ParseRequest(line, request))
+        _SendAll(client.socket, { 'E', 'R', 'R', '\n' });
+    else
+    {
+        bool connected = _SendAll(client.socket, Header(request));
+        vector<uint8_t> record;
+        for (size_t i = 0; connected && (request.count == 0 || i != request.count); ++i)
+        {
+            record.clear();
+            Record(request, i, record);
+            connected = !stopping_ && _SendAll(client.socket, record);
+        }
+    }
+    // The socket is closed by `JoinClients()`, so that `Run()` never shuts down a reused one,
+    //   but the client sees the end of the stream now.
+    shutdown(client.socket, SHUT_RDWR);
+    client.done = true;
+}
+
+void DatasetServer::JoinClients(const bool & all)
+{
+    lock_guard<mutex> lock(clients_mutex_);
+    for (auto iter = clients_.begin(); iter != clients_.end();)
+    {
+        if (all || iter->done)
+        {
+            iter->worker.join();
+            close(iter->socket);
+            iter = clients_.erase(iter);
+        }
+        else
+            ++iter;
+    }
+}
+
+int DatasetServer::Run()
+{
+    PrintParameters(cerr);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path_.size() >= sizeof(address.sun_path))
+    {
+        cerr << "Socket path is too long: " << socket_path_ << endl;
+        return 1;
+    }
+    strcpy(address.sun_path, socket_path_.c_str());
+
+    server_socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(socket_path_.c_str());
+    if (server_socket_ < 0
+        || ::bind(server_socket_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0
+        || listen(server_socket_, SOMAXCONN) != 0)
+    {
+        cerr << "Failed to listen on " << socket_path_ << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    // Clients that disconnect early must not kill the server.
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, _StopSignal);
+    signal(SIGTERM, _StopSignal);
+
+    cerr << "Listening on " << socket_path_ << "..." << endl;
+    int exit_code = 0;
+    while (!stopping_ && !_stop_signal)
+    {
+        // Wake up now and then to notice `Stop()` and the signals.
+        pollfd server_poll = { server_socket_, POLLIN, 0 };
+        auto ready = poll(&server_poll, 1, 200);
+        if (ready <= 0)
+        {
+            if (ready == 0 || errno == EINTR)
+                continue;
+            cerr << "Failed to poll: " << strerror(errno) << endl;
+            exit_code = 1;
+            break;
+        }
+        auto client = accept(server_socket_, nullptr, nullptr);
+        if (client < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            cerr << "Failed to accept: " << strerror(errno) << endl;
+            exit_code = 1;
+            break;
+        }
+        JoinClients(false);
+        lock_guard<mutex> lock(clients_mutex_);
+        clients_.emplace_back();
+        auto & entry = clients_.back();
+        entry.socket = client;
+        entry.done = false;
+        entry.worker = thread(&DatasetServer::Serve, this, ref(entry));
+    }
+
+    // Wake up the clients waiting for their requests or sending, and wait for them.
+    cerr << "Stopping..." << endl;
+    stopping_ = true;
+    {
+        lock_guard<mutex> lock(clients_mutex_);
+        for (auto & client : clients_)
+            shutdown(client.socket, SHUT_RDWR);
+    }
+    JoinClients(true);
+    close(server_socket_);
+    unlink(socket_path_.c_str());
+    return exit_code;
+}
+
+#else
+
+void DatasetServer::Serve(Client &) {}
+
+void DatasetServer::JoinClients(const bool &) {}
+
+int DatasetServer::Run()
+{
+    cerr << "The dataset server needs Unix domain sockets (POSIX)." << endl;
+    return 1;
+}
+
+#endif
+
+int RunDatasetServer(const Parameter & param, const string & socket_path)
+{
+    DatasetServer server(param, socket_path);
+    return server.Run();
+}
+
+ISING_NAMESPACE_END
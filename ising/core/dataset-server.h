@@ -0,0 +1,138 @@
+#ifndef ISING_CORE_DATASET_SERVER_H_
+#define ISING_CORE_DATASET_SERVER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/ising.h"
+#include "core/ising-2d-replicas.h"
+#include "core/parameter.h"
+
+ISING_NAMESPACE_BEGIN
+
+// A request of a client of `DatasetServer`.
+struct DatasetRequest
+{
+    size_t size;
+    double t_begin;
+    double t_end;
+    // 0 for an endless stream.
+    size_t count;
+    double magnetic_h;
+};
+
+// Dataset server: streams freshly generated 2D periodic lattices to the clients of a Unix
+//   domain socket (POSIX only).
+//
+// A client sends one request line (ASCII):
+//   <size> <temperature begin> <temperature end> <count> [<external magnetic field>]\n
+// and receives (all integers and reals little-endian):
+//   header:  "ISNG", uint32 size, uint32 count, uint32 bytes per lattice
+//   records: float64 temperature, float64 field, float64 energy, float64 magnetization,
+//            and the lattice with bits packed row by row (as `np.packbits(axis=-1)`)
+// `count` = 0 streams until the client disconnects. An invalid request gets "ERR\n", e.g.
+//   a size above "server.maxSize" or a count above 2^32 - 1.
+//
+// The temperatures cycle through "server.temperatureCount" evenly spaced points of the
+//   range. Each point has a chain kept in memory: `kChainLanes` lattices swept in lockstep
+//   by `Ising2DReplicas`, with random streams drawn from ("seed", size, T, H). A chain is
+//   equilibrated with "iterations" sweeps when first used, and its lanes are sampled in turn,
+//   each of them "server.sweepsBetweenSamples" sweeps after its previous sample, so the
+//   chains stay warm across requests and a stream never repeats itself.
+// Clients are served by their own threads. Each chain has its own lock, so the clients of
+//   different chains never wait for each other. At most "server.maxChains" chains are kept,
+//   the least recently used one being dropped for a new one.
+class DatasetServer
+{
+public:
+    static const size_t kChainLanes = 16;
+
+    DatasetServer(const Parameter & param, const std::string & socket_path);
+
+    // Serve until `Stop()`, SIGINT or SIGTERM. Returns after all the clients are closed.
+    int Run();
+    // Stop `Run()` from another thread.
+    void Stop();
+
+    // Parse a request line (without "\n"). Return false if it is invalid.
+    bool ParseRequest(const std::string & line, DatasetRequest & request) const;
+    // The header of the response to `request`.
+    std::vector<uint8_t> Header(const DatasetRequest & request) const;
+    // Append the `index`-th record of the response to `request` to `record`.
+    void Record(const DatasetRequest & request, const size_t & index, std::vector<uint8_t> & record);
+    // Number of chains in memory.
+    size_t ChainCount();
+
+private:
+    // Chains are identified by (size, temperature, field).
+    typedef std::pair<size_t, std::pair<double, double>> ChainKey;
+
+    struct Chain
+    {
+        Chain(const size_t & size) : lattices(size) {}
+
+        // Guards all the members below.
+        std::mutex                      mutex;
+        Ising2DReplicas<kChainLanes>    lattices;
+        bool                            equilibrated = false;
+        // Observables of the lanes since the last sweeps, and the lane to sample next
+        //   (`kChainLanes` when all have been sampled).
+        std::vector<Observable>         observables;
+        size_t                          next_lane = kChainLanes;
+    };
+
+    // A thread serving a client.
+    struct Client
+    {
+        int                 socket;
+        std::thread         worker;
+        std::atomic<bool>   done;
+    };
+
+    const std::string socket_path_;
+    const size_t      equilibration_sweeps_;
+    const size_t      sample_sweeps_;
+    const size_t      temperature_count_;
+    const size_t      max_size_;
+    const size_t      max_chains_;
+    const int         seed_;
+
+    // With the time of their last use.
+    std::map<ChainKey, std::pair<std::shared_ptr<Chain>, size_t>> chains_;
+    size_t chain_clock_ = 0;
+    // Guards `chains_` and `chain_clock_` (not the chains).
+    std::mutex chains_mutex_;
+
+    std::list<Client> clients_;
+    // Guards `clients_`.
+    std::mutex clients_mutex_;
+    std::atomic<bool> stopping_;
+    int server_socket_ = -1;
+
+    void Serve(Client & client);
+    // Join the threads of the closed clients.
+    void JoinClients(const bool & all);
+    // The chain of (size, T, H), created if needed.
+    std::shared_ptr<Chain> FindChain(const size_t & size, const double & temperature,
+        const double & magnetic_h);
+    // Sample the chain of (size, T, H) and append its record to `record`.
+    void Sample(const size_t & size, const double & temperature, const double & magnetic_h,
+        std::vector<uint8_t> & record);
+    void PrintParameters(std::ostream & os);
+};
+
+// Interface.
+int RunDatasetServer(const Parameter & param, const std::string & socket_path);
+
+ISING_NAMESPACE_END
+
+#endif
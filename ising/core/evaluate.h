@@ -0,0 +1,135 @@
+#ifndef ISING_CORE_EVALUATE_H_
+#define ISING_CORE_EVALUATE_H_
+
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+#include "core/metropolis.h"
+#include "core/timing.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Evaluation processes shared by the lattice engines (`Ising2D`, `Ising2DSmall`, `Ising3D`),
+//   and their schedule, also used by `Ising2DReplicas`.
+// `Lattice` should provide `kNeighbors`, `Sweep(const double &, const double &)`,
+//   `Sweep(const MetropolisTable<kNeighbors> &)`, `Analysis(const double &)` and `Lattice()`.
+// Only included by the source files of the engines, since "core/timing.h" may include
+//   "Windows.h" (see "core/simulation.h").
+
+// Metropolis table of `lattice` for `Sweep()`. Engines with their own tables overload it
+//   (see "core/ising-2d-disordered.h").
+template <typename Lattice>
+inline MetropolisTable<Lattice::kNeighbors> InitializeSweepTable(const Lattice &,
+    const double & beta, const double & magnetic_h)
+{
+    return InitializeMetropolisTable<Lattice::kNeighbors>(beta, magnetic_h);
+}
+
+// The schedule of an evaluation, shared by the engines: `iterations - n_ensemble` sweeps,
+//   then the ensemble sweeps with `analyze()` after every `n_delta`-th of them, to avoid
+//   correlation between successive configurations. Returns the number of analyses, i.e.
+//   `n_ensemble / n_delta`.
+// The time spent in `analyze()` is counted as analysis, and the rest as sweeps.
+template <typename SweepFunction, typename AnalyzeFunction>
+size_t _EvaluateSchedule(KernelCounters & counters,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    SweepFunction sweep, AnalyzeFunction analyze)
+{
+#ifdef ISING_COUNTERS
+    toolkit::Timing evaluate_clock, analysis_clock;
+    double analysis_time = 0.0;
+    evaluate_clock.TimingBegin();
+#endif
+
+    // Sweep.
+    for (size_t i = 0; i != iterations - n_ensemble; ++i)
+        sweep();
+
+    // Sweep and analysis.
+    size_t count = 0, analyses = 0;
+    for (size_t i = iterations - n_ensemble - 1; i != iterations; ++i)
+    {
+        sweep();
+        if (count == n_delta)
+        {
+            ISING_COUNT(analysis_clock.TimingBegin());
+            analyze();
+            ISING_COUNT(analysis_clock.TimingEnd());
+            ISING_COUNT(analysis_time += analysis_clock.GetRunningTime());
+            analyses += 1;
+            count = 0;
+        }
+        count += 1;
+    }
+#ifdef ISING_COUNTERS
+    evaluate_clock.TimingEnd();
+    counters.analysis_time += analysis_time;
+    counters.sweep_time    += evaluate_clock.GetRunningTime() - analysis_time;
+#endif
+    return analyses;
+}
+
+// A complete evaluation process. Should be initialized before!
+// The blocked lattices and the correlations are measured with each analysis if `block_spin`
+//   and `correlation` are not null.
+template <typename Lattice>
+Observable _Evaluate(Lattice & lattice, KernelCounters & counters,
+    const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
+{
+#ifdef ISING_FAST_EXP
+    auto exp_array = InitializeSweepTable(lattice, beta, magnetic_h);
+#endif
+    Observable observable;
+    auto analyses = _EvaluateSchedule(counters, iterations, n_ensemble, n_delta, [&]()
+    {
+#ifdef ISING_FAST_EXP
+        lattice.Sweep(exp_array);
+#else
+        lattice.Sweep(beta, magnetic_h);
+#endif
+    }, [&]()
+    {
+        observable += lattice.Analysis(magnetic_h);
+        if (block_spin || correlation)
+        {
+            auto spins = lattice.Lattice();
+            if (block_spin)
+                block_spin->Measure(spins, magnetic_h);
+            if (correlation)
+                correlation->Measure(spins);
+        }
+        ISING_COUNT(counters.analyses += 1);
+    });
+    // Normalize.
+    return observable / static_cast<double>(analyses);
+}
+
+// For lattice data generating and convergence analysis.
+template <typename Lattice>
+LatticeInfo _EvaluateLatticeData(Lattice & lattice,
+    const double & beta, const double & magnetic_h, const size_t & iterations)
+{
+#ifdef ISING_FAST_EXP
+    auto exp_array = InitializeSweepTable(lattice, beta, magnetic_h);
+#endif
+    std::vector<Observable> result;
+    for (size_t i = 0; i != iterations; ++i)
+    {
+#ifdef ISING_FAST_EXP
+        lattice.Sweep(exp_array);
+#else
+        lattice.Sweep(beta, magnetic_h);
+#endif
+        result.push_back(lattice.Analysis(magnetic_h));
+    }
+    return { lattice.Lattice(), result };
+}
+
+ISING_NAMESPACE_END
+
+#endif
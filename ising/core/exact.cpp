@@ -1,13 +1,23 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "core/exact.h"
 
+#include "core/chebyshev.h"
+#include "core/cpu-dispatch.h"
 #include "core/info.h"
 #include "core/ising.h"
 #include "core/parameter.h"
+#include "core/progress.h"
 #include "core/timing.h"
+#include "core/transfer-matrix.h"
 
 using namespace std;
 using namespace ising::toolkit;
@@ -15,31 +25,328 @@ using namespace ising::toolkit;
 ISING_NAMESPACE_BEGIN
 
 IsingExact2D::IsingExact2D(const size_t & size, const double & T) :
-    IsingExact2D({ size, size }, T) {}
-IsingExact2D::IsingExact2D(const size_t & size, const double & T, const double & dT) :
-    IsingExact2D({ size, size }, T, dT) {}
+    IsingExact2D({ size, size }, T, 0.0) {}
 IsingExact2D::IsingExact2D(const LatticeSize & size, const double & T) :
-    n_(size.x), m_(size.y), T_(T), dT_(kDerivativeIncrement * T) {}
-IsingExact2D::IsingExact2D(const LatticeSize & size, const double & T, const double & dT) :
-    n_(size.x), m_(size.y), T_(T), dT_(dT) {}
+    IsingExact2D(size, T, 0.0) {}
+IsingExact2D::IsingExact2D(const size_t & size, const double & T, const double & tolerance) :
+    IsingExact2D({ size, size }, T, tolerance) {}
+IsingExact2D::IsingExact2D(const LatticeSize & size, const double & T, const double & tolerance) :
+    n_(size.x), m_(size.y), T_(T), tolerance_(tolerance) {}
 
-// E(k) = -dQ(k)/dk
-// E(T) = T^2 * d/dT ln Q(1/T)
-double IsingExact2D::Energy(const double & T)
+// Multiply the product `p` by the factor `f`, keeping track of the derivatives.
+inline void _ProductUpdate(const double & f, const double & f_1, const double & f_2,
+    double & p, double & p_1, double & p_2)
 {
-    // Derivative: f'(x) = 1/(2h) * [f(x+h) - f(x-h)]
-    return T * T / (n_ * m_) * (log_Q(1 / (T + dT_)) - log_Q(1 / (T - dT_))) / (2 * dT_);
+    p_2 = p_2 * f + 2 * p_1 * f_1 + p * f_2;
+    p_1 = p_1 * f + p * f_1;
+    p   = p   * f;
 }
 
-// C(T) = dE(T)/dT
+// Add the logarithm of a factor to `l`, keeping track of the derivatives.
+inline void _LogSumUpdate(const double & f, const double & f_1, const double & f_2,
+    double & l, double & l_1, double & l_2)
+{
+    l   += f;
+    l_1 += f_1;
+    l_2 += f_2;
+}
+
+// Convert the logarithm (with derivatives) of a product back to the product itself.
+inline void _LogToProduct(const double & l, const double & l_1, const double & l_2,
+    double & p, double & p_1, double & p_2)
+{
+    p   = std::exp(l);
+    p_1 = p * l_1;
+    p_2 = p * (l_1 * l_1 + l_2);
+}
+
+IsingExact2D::Derivatives IsingExact2D::log_Y(const double & k)
+{
+    switch (ActiveCpuPath())
+    {
+    case kCpuAvx512:
+        return log_Y_avx512(k);
+    case kCpuAvx2:
+        return log_Y_avx2(k);
+    default:
+        return log_Y_sse2(k);
+    }
+}
+
+ISING_TARGET_SSE2 IsingExact2D::Derivatives IsingExact2D::log_Y_sse2(const double & k)
+{
+    return log_Y_body(k);
+}
+
+ISING_TARGET_AVX2 IsingExact2D::Derivatives IsingExact2D::log_Y_avx2(const double & k)
+{
+    return log_Y_body(k);
+}
+
+ISING_TARGET_AVX512 IsingExact2D::Derivatives IsingExact2D::log_Y_avx512(const double & k)
+{
+    return log_Y_body(k);
+}
+
+ISING_ALWAYS_INLINE IsingExact2D::Derivatives IsingExact2D::log_Y_body(const double & k)
+{
+    const double a = m_ / 2.0;
+
+    // log(Y1) and its derivatives.
+    double l1 = n_ * kMathLog2, l1_1 = 0.0, l1_2 = 0.0;
+    // log(Y2/Y1), log(Y3/Y1), log|Y4/Y1| (without q = 0) and their derivatives.
+    double l2 = 0.0, l2_1 = 0.0, l2_2 = 0.0;
+    double l3 = 0.0, l3_1 = 0.0, l3_2 = 0.0;
+    double l4 = 0.0, l4_1 = 0.0, l4_2 = 0.0;
+    // The q = 0 factor of Y4/Y1, which may vanish at K = K_c.
+    double g4 = 1.0, g4_1 = 0.0, g4_2 = 0.0;
+
+    for (size_t q = 0; q != n_; ++q)
+    {
+        // Use `e` for gamma_{2q} and `o` for gamma_{2q+1}; `x = m/2 * gamma`.
+        // Only gamma_0 may be negative.
+        auto g_e = gamma(2 * q,     k);
+        auto g_o = gamma(2 * q + 1, k);
+        auto x_e = a * g_e.value, x_e_1 = a * g_e.first, x_e_2 = a * g_e.second;
+        auto x_o = a * g_o.value, x_o_1 = a * g_o.first, x_o_2 = a * g_o.second;
+        auto t_e = tanh_(x_e);
+        auto t_o = tanh_(x_o);
+
+        // (log cosh x)' = x' tanh x, (log cosh x)'' = x'' tanh x + x'^2 sech^2 x.
+        auto log_cosh_e   = log_cosh(x_e);
+        auto log_cosh_o   = log_cosh(x_o);
+        auto log_cosh_e_1 = x_e_1 * t_e;
+        auto log_cosh_o_1 = x_o_1 * t_o;
+        auto log_cosh_e_2 = x_e_2 * t_e + x_e_1 * x_e_1 * (1 - t_e * t_e);
+        auto log_cosh_o_2 = x_o_2 * t_o + x_o_1 * x_o_1 * (1 - t_o * t_o);
+
+        _LogSumUpdate(log_cosh_o, log_cosh_o_1, log_cosh_o_2, l1, l1_1, l1_2);
+
+        // tanh(x_o)
+        // (log tanh x)'  = x' (1 - tanh^2 x) / tanh x,
+        // (log tanh x)'' = x'' (1 - tanh^2 x) / tanh x - x'^2 (1 - tanh^4 x) / tanh^2 x.
+        _LogSumUpdate(x_o > kSaturation ? 0.0 : std::log(t_o),
+            x_o_1 * (1 - t_o * t_o) / t_o,
+            x_o_2 * (1 - t_o * t_o) / t_o - x_o_1 * x_o_1 * (1 - t_o * t_o * t_o * t_o) / (t_o * t_o),
+            l2, l2_1, l2_2);
+
+        // cosh(x_e) / cosh(x_o)
+        _LogSumUpdate(log_cosh_e - log_cosh_o,
+            log_cosh_e_1 - log_cosh_o_1,
+            log_cosh_e_2 - log_cosh_o_2,
+            l3, l3_1, l3_2);
+
+        // sinh(x_e) / cosh(x_o)
+        if (q == 0)
+        {
+            // Differentiate sinh and 1/cosh separately since sinh(x_e) may vanish.
+            auto s = sinh_over_cosh(x_e, x_o);
+            auto c = std::exp(log_cosh_e - log_cosh_o);
+            g4   = s;
+            g4_1 = x_e_1 * c - s * log_cosh_o_1;
+            g4_2 = x_e_2 * c + x_e_1 * x_e_1 * s - 2 * x_e_1 * c * log_cosh_o_1
+                 - s * (x_o_2 * t_o + x_o_1 * x_o_1 * (1 - 2 * t_o * t_o));
+        }
+        else
+        {
+            // (log sinh x)' = x' / tanh x, (log sinh x)'' = x'' / tanh x - x'^2 / sinh^2 x.
+            _LogSumUpdate(log_sinh_abs(x_e) - log_cosh_o,
+                x_e_1 / t_e - log_cosh_o_1,
+                x_e_2 / t_e - x_e_1 * x_e_1 * (1 / (t_e * t_e) - 1) - log_cosh_o_2,
+                l4, l4_1, l4_2);
+        }
+    }
+
+    double r2, r2_1, r2_2;
+    double r3, r3_1, r3_2;
+    double r4, r4_1, r4_2;
+    _LogToProduct(l2, l2_1, l2_2, r2, r2_1, r2_2);
+    _LogToProduct(l3, l3_1, l3_2, r3, r3_1, r3_2);
+    _LogToProduct(l4, l4_1, l4_2, r4, r4_1, r4_2);
+    _ProductUpdate(g4, g4_1, g4_2, r4, r4_1, r4_2);
+
+    auto sum   = 1 + r2 + r3 + r4;
+    auto sum_1 = (r2_1 + r3_1 + r4_1) / sum;
+    auto sum_2 = (r2_2 + r3_2 + r4_2) / sum;
+
+    return { l1 + std::log(sum), l1_1 + sum_1, l1_2 + sum_2 - sum_1 * sum_1 };
+}
+
+IsingExact2D::Derivatives IsingExact2D::log_Q(const double & k)
+{
+    const double half_nm = n_ * m_ / 2.0;
+    auto sinh_2k = std::sinh(2 * k);
+    auto log_y = log_Y(k);
+    return { -kMathLog2 + half_nm * std::log(2 * sinh_2k) + log_y.value,
+             2 * half_nm * coth(2 * k) + log_y.first,
+             -4 * half_nm / (sinh_2k * sinh_2k) + log_y.second };
+}
+
+// Complete elliptic integrals of the first and second kind K(k), E(k) by the
+// arithmetic-geometric mean. See M.Abramowitz & I.A.Stegun *Handbook of Mathematical
+// Functions* 17.6.
+inline pair<double, double> _EllipticKE(const double & k)
+{
+    const double kMathPi  = 3.14159265358979323846;
+    const double kEpsilon       = 1.0e-15;
+    const size_t kMaxIterations = 64;
+
+    double a = 1.0, b = sqrt(1 - k * k), c = k;
+    double power = 0.5, sum = power * c * c;
+    for (size_t i = 0; i != kMaxIterations && fabs(c) > kEpsilon * a; ++i)
+    {
+        c = (a - b) / 2;
+        auto a_next = (a + b) / 2;
+        b = sqrt(a * b);
+        a = a_next;
+        power *= 2;
+        sum += power * c * c;
+    }
+    auto elliptic_k = kMathPi / (2 * a);
+    return { elliptic_k, elliptic_k * (1 - sum) };
+}
+
+// u = -coth(2K) [1 + 2/pi * k' K(k)],
+// where k = 2sinh(2K) / cosh^2(2K), k' = 2tanh^2(2K) - 1.
+double IsingExact2D::OnsagerEnergy(const double & k)
+{
+    auto modulus   = 2 * std::sinh(2 * k) / std::pow(std::cosh(2 * k), 2);
+    auto modulus_c = 2 * std::pow(std::tanh(2 * k), 2) - 1;
+    auto elliptic  = _EllipticKE(modulus);
+    return -coth(2 * k) * (1 + 2 / kMathPi * modulus_c * elliptic.first);
+}
+
+// c = 2/pi * (K coth(2K))^2 * {2K(k) - 2E(k) - (1 - k') [pi/2 + k' K(k)]}
+double IsingExact2D::OnsagerSpecificHeat(const double & k)
+{
+    auto modulus   = 2 * std::sinh(2 * k) / std::pow(std::cosh(2 * k), 2);
+    auto modulus_c = 2 * std::pow(std::tanh(2 * k), 2) - 1;
+    auto elliptic  = _EllipticKE(modulus);
+    return 2 / kMathPi * std::pow(k * coth(2 * k), 2)
+        * (2 * elliptic.first - 2 * elliptic.second
+           - (1 - modulus_c) * (kMathPi / 2 + modulus_c * elliptic.first));
+}
+
+// The finite size corrections decay as exp(-L |gamma_0|), where L = min(n, m) and
+// 1/|gamma_0| = 1/|2K - 2K*| is the correlation length, with a prefactor of order 10 for
+// the specific heat. Outside the critical window L |gamma_0| < log(L^2 / tolerance) the
+// infinite lattice result is therefore accurate enough, with a generous margin. Inside
+// it the full product is needed, whose Ferdinand-Fisher behavior (ln L at T_c) is not
+// captured by any short asymptotic expansion to the required tolerance.
+bool IsingExact2D::IsAsymptotic()
+{
+    if (tolerance_ <= 0.0)
+        return false;
+    auto k = 1 / T_;
+    auto size = static_cast<double>(n_ < m_ ? n_ : m_);
+    auto gamma_0 = fabs(gamma(0, k).value);
+    return size * gamma_0 > log(size * size / tolerance_);
+}
+
+// E(K) = -d ln Q(K)/dK
+double IsingExact2D::Energy()
+{
+    if (IsAsymptotic())
+        return OnsagerEnergy(1 / T_);
+    return -log_Q(1 / T_).first / (n_ * m_);
+}
+
+// C(T) = dE(T)/dT = K^2 * d^2 ln Q(K)/dK^2
 double IsingExact2D::SpecificHeat()
 {
-    // Derivative: f'(x) = 1/(2h) * [f(x+h) - f(x-h)]
-    return (Energy(T_ + dT_) - Energy(T_ - dT_)) / (2 * dT_);
+    auto k = 1 / T_;
+    if (IsAsymptotic())
+        return OnsagerSpecificHeat(k);
+    return k * k * log_Q(k).second / (n_ * m_);
+}
+
+// Brent's method for minimizing `f` in the bracket [a, b] with a known interior point `x`.
+// See W.H.Press et al. *Numerical Recipes (3rd ed)* 10.3.
+// Return the position of the minimum and the function value.
+template <typename Function>
+pair<double, double> _BrentMinimize(Function f, double a, double b, double x,
+    const double & tolerance, const size_t & max_iterations = 100)
+{
+    const double kGoldenRatio = 0.38196601125010515180; // = (3 - sqrt(5)) / 2
+    const double kEpsilon     = 1.0e-12;
+
+    double w = x, v = x;
+    double f_x = f(x), f_w = f_x, f_v = f_x;
+    double d = 0.0, e = 0.0;
+
+    for (size_t i = 0; i != max_iterations; ++i)
+    {
+        auto x_m   = (a + b) / 2;
+        auto tol_1 = tolerance * fabs(x) + kEpsilon;
+        auto tol_2 = 2 * tol_1;
+        if (fabs(x - x_m) <= tol_2 - (b - a) / 2)
+            break;
+
+        if (fabs(e) > tol_1)
+        {
+            // Try a parabolic step through x, v and w.
+            auto r = (x - w) * (f_x - f_v);
+            auto q = (x - v) * (f_x - f_w);
+            auto p = (x - v) * q - (x - w) * r;
+            q = 2 * (q - r);
+            if (q > 0.0)
+                p = -p;
+            q = fabs(q);
+            auto e_old = e;
+            e = d;
+            if (fabs(p) >= fabs(q * e_old / 2) || p <= q * (a - x) || p >= q * (b - x))
+            {
+                e = (x >= x_m ? a - x : b - x);
+                d = kGoldenRatio * e;
+            }
+            else
+            {
+                d = p / q;
+                auto u = x + d;
+                if (u - a < tol_2 || b - u < tol_2)
+                    d = copysign(tol_1, x_m - x);
+            }
+        }
+        else
+        {
+            // Golden section step.
+            e = (x >= x_m ? a - x : b - x);
+            d = kGoldenRatio * e;
+        }
+
+        auto u   = (fabs(d) >= tol_1 ? x + d : x + copysign(tol_1, d));
+        auto f_u = f(u);
+        if (f_u <= f_x)
+        {
+            (u >= x ? a : b) = x;
+            v = w; f_v = f_w;
+            w = x; f_w = f_x;
+            x = u; f_x = f_u;
+        }
+        else
+        {
+            (u < x ? a : b) = u;
+            if (f_u <= f_w || w == x)
+            {
+                v = w; f_v = f_w;
+                w = u; f_w = f_u;
+            }
+            else if (f_u <= f_v || v == x || v == w)
+            {
+                v = u; f_v = f_u;
+            }
+        }
+    }
+    return { x, f_x };
 }
 
 Exact::Exact(const Parameter & param) :
-    size_list_(param.lattice_size_list), temperature_list_(param.temperature_list)
+    size_list_(param.lattice_size_list), temperature_list_(param.temperature_list),
+    method_(param.exact_method), length_(param.exact_length),
+    magnetic_h_list_(param.magnetic_h_list),
+    surrogate_tolerance_(param.exact_tolerance), surrogate_cache_(param.exact_cache),
+    asymptotic_tolerance_(param.exact_asymptotic_tolerance),
+    status_file_(param.status_file)
 {
     result_.resize(temperature_list_.size());
     for (auto & i : result_)
@@ -49,15 +356,48 @@ Exact::Exact(const Parameter & param) :
 int Exact::Run()
 {
     PrintParameter(cerr);
-    Evaluate();
-    PrintFirstRow(cout);
-    PrintResult(cout);
+    if (method_ == kExactKaufman)
+    {
+        Evaluate();
+        PrintFirstRow(cout);
+        PrintResult(cout);
+        return 0;
+    }
+
+    // The narrow side of a torus is the width.
+    for (auto size : size_list_)
+        if ((method_ == kExactStrip || length_ == 0 ? size : min(size, length_))
+            > TransferMatrix2D::kMaxWidth)
+        {
+            cerr << "The transfer matrix is limited to a width of "
+                 << TransferMatrix2D::kMaxWidth << "." << endl;
+            return 1;
+        }
+    EvaluateTransferMatrix();
+    PrintTransferMatrixResult(cout);
+    return 0;
+}
+
+int Exact::RunPeak()
+{
+    PrintParameter(cerr);
+    EvaluatePeak();
+    PrintPeakResult(cout);
 
     return 0;
 }
 
 void Exact::Evaluate()
 {
+    // A single temperature has no range to fit, and is evaluated directly.
+    auto range = minmax_element(temperature_list_.begin(), temperature_list_.end());
+    if (surrogate_tolerance_ > 0.0 && range.first != temperature_list_.end()
+        && *range.first < *range.second)
+    {
+        EvaluateSurrogate();
+        return;
+    }
+
     Timing run_clock;
     cerr << "Running..." << endl;
     run_clock.TimingBegin();
@@ -69,7 +409,7 @@ void Exact::Evaluate()
         auto T = temperature_list_[i];
         for (size_t j = 0; j < size_list_.size(); ++j)
         {
-            IsingExact2D e(size_list_[j], T);
+            IsingExact2D e(size_list_[j], T, asymptotic_tolerance_);
             result_[i][j] = e.SpecificHeat();
         }
         PrintProgress(temperature_list_.size(), i + 1);
@@ -80,12 +420,205 @@ void Exact::Evaluate()
          << "Running time: " << run_clock.GetRunningTime() << "s." << endl;
 }
 
+// For dense temperature lists, fit C(T) of each size with a piecewise Chebyshev expansion
+// from a few nodes, and evaluate the whole list from the expansion. The expansion is
+// fitted to C(T) itself rather than ln Q, since differentiating the latter twice would
+// amplify the interpolation error.
+// The temperatures where the expansion missed the tolerance are evaluated directly.
+void Exact::EvaluateSurrogate()
+{
+    auto range = minmax_element(temperature_list_.begin(), temperature_list_.end());
+    const auto t_min = *range.first;
+    const auto t_max = *range.second;
+
+    auto surrogates = ReadSurrogateCache();
+
+    // Index of the surrogate for each size. New entries are appended for the missing ones.
+    vector<size_t> surrogate_index(size_list_.size());
+    vector<size_t> fit_list;
+    for (size_t j = 0; j != size_list_.size(); ++j)
+    {
+        auto iter = find_if(surrogates.begin(), surrogates.end(), [&](const Surrogate & s)
+        {
+            return s.size == size_list_[j] && s.t_min == t_min && s.t_max == t_max
+                && s.tolerance == surrogate_tolerance_
+                && s.asymptotic_tolerance == asymptotic_tolerance_;
+        });
+        if (iter == surrogates.end())
+        {
+            surrogate_index[j] = surrogates.size();
+            fit_list.push_back(surrogates.size());
+            surrogates.push_back({ size_list_[j], t_min, t_max, surrogate_tolerance_,
+                asymptotic_tolerance_, {} });
+        }
+        else
+            surrogate_index[j] = iter - surrogates.begin();
+    }
+
+    Timing run_clock;
+    cerr << "Running..." << endl;
+    run_clock.TimingBegin();
+    size_t evaluations = 0;
+    // The cost of an evaluation is proportional to L.
+    size_t total_work = 0;
+    for (auto k : fit_list)
+        total_work += surrogates[k].size;
+    Progress progress(fit_list.size(), total_work, status_file_);
+    progress.Start();
+#ifdef ISING_PARALLEL
+#pragma omp parallel for reduction(+:evaluations)
+#endif
+    // OpenMP for need signed integer.
+    for (int i = 0; i < static_cast<int>(fit_list.size()); ++i)
+    {
+        auto & surrogate = surrogates[fit_list[i]];
+        auto size = surrogate.size;
+        auto tolerance = asymptotic_tolerance_;
+        evaluations += surrogate.specific_heat.Fit([size, tolerance](double T)
+        {
+            return IsingExact2D(size, T, tolerance).SpecificHeat();
+        }, t_min, t_max, surrogate_tolerance_);
+        progress.Advance(0, size);
+        progress.Complete();
+    }
+    progress.Stop();
+    size_t direct_count = 0;
+#ifdef ISING_PARALLEL
+#pragma omp parallel for reduction(+:direct_count)
+#endif
+    // OpenMP for need signed integer.
+    for (int i = 0; i < static_cast<int>(temperature_list_.size()); ++i)
+    {
+        auto T = temperature_list_[i];
+        for (size_t j = 0; j != size_list_.size(); ++j)
+        {
+            auto & specific_heat = surrogates[surrogate_index[j]].specific_heat;
+            if (specific_heat.Accurate(T))
+                result_[i][j] = specific_heat(T);
+            else
+            {
+                result_[i][j] = IsingExact2D(size_list_[j], T, asymptotic_tolerance_).SpecificHeat();
+                direct_count += 1;
+            }
+        }
+    }
+    run_clock.TimingEnd();
+    cerr << "Finished!" << endl
+         << "Surrogate: " << size_list_.size() - fit_list.size() << " cached, "
+         << fit_list.size() << " fitted with " << evaluations << " evaluations." << endl;
+    if (direct_count != 0)
+        cerr << "Surrogate: " << direct_count << " points evaluated directly, "
+             << "where it missed the tolerance." << endl;
+    cerr << "Running time: " << run_clock.GetRunningTime() << "s." << endl;
+
+    if (!fit_list.empty())
+        WriteSurrogateCache(surrogates);
+}
+
+// The specific heat of a finite lattice has a single maximum near T_c, so we bracket it
+// on a coarse grid over the temperature range and refine it by Brent's method.
+pair<double, double> SpecificHeatPeak(const size_t & size, const double & t_begin,
+    const double & t_end, const double & tolerance)
+{
+    const auto t_step = (t_end - t_begin) / (kPeakBracketPoints - 1);
+    auto negative_specific_heat = [size, tolerance](const double & T)
+    {
+        return -IsingExact2D(size, T, tolerance).SpecificHeat();
+    };
+
+    // Coarse grid for bracketing.
+    size_t peak_index = 0;
+    double peak_value = 0.0;
+    for (size_t j = 0; j != kPeakBracketPoints; ++j)
+    {
+        auto value = negative_specific_heat(t_begin + j * t_step);
+        if (value < peak_value)
+        {
+            peak_index = j;
+            peak_value = value;
+        }
+    }
+    auto a = t_begin + (peak_index == 0 ? 0 : peak_index - 1) * t_step;
+    auto b = t_begin + (peak_index == kPeakBracketPoints - 1 ? peak_index : peak_index + 1) * t_step;
+
+    auto peak = _BrentMinimize(negative_specific_heat,
+        a, b, t_begin + peak_index * t_step, kPeakTolerance);
+    return { peak.first, -peak.second };
+}
+
+void Exact::EvaluatePeak()
+{
+    const auto t_begin = temperature_list_.front();
+    const auto t_end   = temperature_list_.back();
+
+    peak_temperature_.resize(size_list_.size());
+    peak_specific_heat_.resize(size_list_.size());
+
+    // The cost of an evaluation is proportional to L.
+    size_t total_work = 0;
+    for (auto size : size_list_)
+        total_work += size;
+    Progress progress(size_list_.size(), total_work, status_file_);
+
+    Timing run_clock;
+    cerr << "Running..." << endl;
+    run_clock.TimingBegin();
+    progress.Start();
+#ifdef ISING_PARALLEL
+#pragma omp parallel for
+#endif
+    // OpenMP for need signed integer.
+    for (int i = 0; i < static_cast<int>(size_list_.size()); ++i)
+    {
+        auto peak = SpecificHeatPeak(size_list_[i], t_begin, t_end, asymptotic_tolerance_);
+        peak_temperature_[i]   = peak.first;
+        peak_specific_heat_[i] = peak.second;
+
+        progress.Advance(0, size_list_[i]);
+        progress.Complete();
+    }
+    progress.Stop();
+    run_clock.TimingEnd();
+    cerr << "Finished!" << endl
+         << "Running time: " << run_clock.GetRunningTime() << "s." << endl;
+}
+
+// The cells of a size are evaluated in turn, since a strip starts from the eigenvector of the
+//   last cell. The transfer matrix itself is multi-threaded.
+void Exact::EvaluateTransferMatrix()
+{
+    const auto kCells = size_list_.size() * magnetic_h_list_.size() * temperature_list_.size();
+    transfer_result_.resize(kCells);
+
+    Timing run_clock;
+    cerr << "Running..." << endl;
+    run_clock.TimingBegin();
+    size_t index = 0;
+    for (auto size : size_list_)
+    {
+        TransferMatrix2D matrix(size, method_ == kExactStrip ? 0 : (length_ == 0 ? size : length_));
+        for (auto h : magnetic_h_list_)
+            for (auto T : temperature_list_)
+            {
+                transfer_result_[index] = matrix.Evaluate(T, h);
+                PrintProgress(kCells, ++index);
+            }
+    }
+    run_clock.TimingEnd();
+    cerr << endl
+         << "Finished!" << endl
+         << "Running time: " << run_clock.GetRunningTime() << "s." << endl;
+}
+
 void Exact::PrintParameter(ostream & os)
 {
     os << endl << InformationSeparator() << endl;
 
-    os << "* Calculate specific heat for finite size 2D Ising model" << endl
-       << "*" << endl
+    if (method_ == kExactKaufman)
+        os << "* Calculate specific heat for finite size 2D Ising model" << endl;
+    else
+        os << "* Calculate 2D Ising model by the transfer matrix" << endl;
+    os << "*" << endl
        << "* Parameters:" << endl;
 
     os << "*   Size list:" << endl
@@ -98,6 +631,26 @@ void Exact::PrintParameter(ostream & os)
        << "*     "
        << temperature_list_.front() << " -- " << temperature_list_.back() << endl;
 
+    if (method_ != kExactKaufman)
+    {
+        os << "*   External magnetic field list:" << endl
+           << "*     ";
+        for (auto i : magnetic_h_list_)
+            os << i << " ";
+        os << endl;
+        os << "*   Geometry:           ";
+        if (method_ == kExactStrip)
+            os << "L * infinity strips";
+        else if (length_ == 0)
+            os << "L * L tori";
+        else
+            os << "L * " << length_ << " tori";
+        os << endl;
+    }
+
+    os << "*   Instruction set:    "
+       << CpuPathName(ActiveCpuPath()) << endl;
+
     os << InformationSeparator() << endl << endl;
 }
 
@@ -119,10 +672,92 @@ void Exact::PrintResult(ostream & os)
     }
 }
 
+// Cache file format (plain text), for each entry:
+//   v2 <size> <T_min> <T_max> <tolerance> <asymptotic tolerance>
+//   <Chebyshev data>
+// The entries of other versions are dropped.
+const string kSurrogateCacheVersion = "v2";
+
+vector<Exact::Surrogate> Exact::ReadSurrogateCache()
+{
+    vector<Surrogate> surrogates;
+    if (surrogate_cache_.empty())
+        return surrogates;
+
+    ifstream file(surrogate_cache_);
+    Surrogate s;
+    string version;
+    while (file >> version && version == kSurrogateCacheVersion
+        && file >> s.size >> s.t_min >> s.t_max >> s.tolerance >> s.asymptotic_tolerance)
+    {
+        if (!s.specific_heat.Read(file))
+            break;
+        surrogates.push_back(s);
+    }
+    file.close();
+    return surrogates;
+}
+
+void Exact::WriteSurrogateCache(const vector<Surrogate> & surrogates)
+{
+    if (surrogate_cache_.empty())
+        return;
+
+    ofstream file(surrogate_cache_);
+    file.precision(numeric_limits<double>::max_digits10);
+    for (auto & s : surrogates)
+    {
+        file << kSurrogateCacheVersion << " " << s.size << " " << s.t_min << " " << s.t_max
+             << " " << s.tolerance << " " << s.asymptotic_tolerance << endl;
+        s.specific_heat.Write(file);
+    }
+    file.close();
+}
+
+void Exact::PrintPeakResult(ostream & os)
+{
+    const streamsize kPeakPrecision = 12;
+    os << setprecision(kPeakPrecision);
+    os << "size,temperature,specificHeat" << endl;
+    for (size_t i = 0; i != size_list_.size(); ++i)
+        os << size_list_[i] << "," << peak_temperature_[i] << "," << peak_specific_heat_[i] << endl;
+}
+
+// Per site, with the energy and specific heat as `Simulation` (each bond counted twice). The
+//   length of a strip is 0.
+void Exact::PrintTransferMatrixResult(ostream & os)
+{
+    const streamsize kPrecision = 12;
+    os << setprecision(kPrecision);
+    os << "size,length,temperature,magneticField,freeEnergy,energy,magnetization,"
+       << "magnetizationAbs,magnetizationSquare,energySquare,magnetizationFourth,energyFourth,"
+       << "specificHeat,susceptibility" << endl;
+    size_t index = 0;
+    for (auto size : size_list_)
+        for (auto h : magnetic_h_list_)
+            for (auto T : temperature_list_)
+            {
+                auto & result = transfer_result_[index++];
+                auto & o = result.observable;
+                os << size << "," << (method_ == kExactStrip ? 0 : (length_ == 0 ? size : length_))
+                   << "," << T << "," << h << "," << result.free_energy
+                   << "," << o.energy << "," << o.magnetic_dipole << "," << o.magnetic_dipole_abs
+                   << "," << o.magnetic_dipole_square << "," << o.energy_square
+                   << "," << o.magnetic_dipole_fourth << "," << o.energy_fourth
+                   << "," << result.specific_heat << "," << result.susceptibility << endl;
+            }
+}
+
 int RunExact(const Parameter & param)
 {
     Exact eval(param);
     return eval.Run();
 }
 
+int RunExactPeak(const Parameter & param)
+{
+    Exact eval(param);
+    return eval.RunPeak();
+}
+
 ISING_NAMESPACE_END
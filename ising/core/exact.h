@@ -6,10 +6,14 @@
 
 #include <cmath>
 #include <ostream>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "core/chebyshev.h"
 #include "core/ising.h"
 #include "core/parameter.h"
+#include "core/transfer-matrix.h"
 
 ISING_NAMESPACE_BEGIN
 
@@ -18,37 +22,90 @@ class IsingExact2D
 public:
     IsingExact2D() = default;
     IsingExact2D(const size_t & size, const double & T);
-    IsingExact2D(const size_t & size, const double & T, const double & dT);
     IsingExact2D(const LatticeSize & size, const double & T);
-    IsingExact2D(const LatticeSize & size, const double & T, const double & dT);
+    // Use the infinite lattice result wherever the finite size correction is below `tolerance`.
+    IsingExact2D(const size_t & size, const double & T, const double & tolerance);
+    IsingExact2D(const LatticeSize & size, const double & T, const double & tolerance);
 
-    double Energy(const double & T);
+    double Energy();
     double SpecificHeat();
 
+    // Whether the infinite lattice result is used, i.e. T is outside the critical window.
+    bool IsAsymptotic();
+
 private:
     // Math constants.
     const double kMathPi   = 3.14159265358979323846;
     const double kMathLog2 = 0.69314718055994530942;
     const double kIsingTc  = 2.26918531421302196811; // = 2 / log(1 + sqrt(2))
 
-    const double kDerivativeIncrement = 0.001;
+    // tanh(x) == 1 and log(cosh(x)) == |x| - log(2) in double precision for |x| > 20.
+    const double kSaturation = 20.0;
 
     const size_t n_;
     const size_t m_;
     const double T_;
-    const double dT_;
+    const double tolerance_;
+
+    // A function value together with its first and second derivatives with respect to K.
+    struct Derivatives
+    {
+        double value;
+        double first;
+        double second;
+    };
 
     // Left-over hyperbolic function.
     inline double coth(const double & x) { return 1.0 / std::tanh(x); }
 
+    // Overflow-free log(cosh(x)), log|sinh(x)| and sinh(x) / cosh(y).
+    // Hyperbolic functions of large arguments are short-cut since they have converged.
+    inline double tanh_(const double & x)
+    {
+        return std::fabs(x) > kSaturation ? std::copysign(1.0, x) : std::tanh(x);
+    }
+    inline double log_cosh(const double & x)
+    {
+        if (std::fabs(x) > kSaturation)
+            return std::fabs(x) - kMathLog2;
+        return std::fabs(x) + std::log1p(std::exp(-2 * std::fabs(x))) - kMathLog2;
+    }
+    inline double log_sinh_abs(const double & x)
+    {
+        if (std::fabs(x) > kSaturation)
+            return std::fabs(x) - kMathLog2;
+        return std::fabs(x) + std::log1p(-std::exp(-2 * std::fabs(x))) - kMathLog2;
+    }
+    inline double sinh_over_cosh(const double & x, const double & y)
+    {
+        return std::copysign(std::exp(std::fabs(x) - std::fabs(y)), x)
+            * (1 - std::exp(-2 * std::fabs(x))) / (1 + std::exp(-2 * std::fabs(y)));
+    }
+
     // [eq. 13.4 (48)] cosh(gamma_q) = cosh^2(2K) / sinh(2K) - cos(pi*q/n), for 0 < q < 2n;
     // [eq. 13.4 (49)] exp(gamma_0)  = exp(2K) * tanh(K).
-    inline double gamma(const size_t & q, const double & k)
+    // The derivatives follow from differentiating the two equations directly:
+    //   gamma_q'  = c' / sinh(gamma_q),
+    //   gamma_q'' = (c'' - cosh(gamma_q) * gamma_q'^2) / sinh(gamma_q),
+    // where c = cosh^2(2K) / sinh(2K);
+    //   gamma_0'  = 2 + 2 / sinh(2K),
+    //   gamma_0'' = -4cosh(2K) / sinh^2(2K).
+    inline Derivatives gamma(const size_t & q, const double & k)
     {
+        auto sinh_2k = std::sinh(2 * k);
+        auto cosh_2k = std::cosh(2 * k);
         if (q == 0)
-            return std::log(std::exp(2 * k) * std::tanh(k));
-        else
-            return std::acosh(std::cosh(2 * k) * coth(2 * k) - std::cos(kMathPi * q / n_));
+            return { 2 * k + std::log(std::tanh(k)),
+                     2 + 2 / sinh_2k,
+                     -4 * cosh_2k / (sinh_2k * sinh_2k) };
+        auto cosh_gamma = cosh_2k * cosh_2k / sinh_2k - std::cos(kMathPi * q / n_);
+        auto sinh_gamma = std::sqrt(cosh_gamma * cosh_gamma - 1);
+        auto c_1 = 2 * cosh_2k * (1 - 1 / (sinh_2k * sinh_2k));
+        auto c_2 = 4 * sinh_2k - 4 / sinh_2k + 8 * cosh_2k * cosh_2k / (sinh_2k * sinh_2k * sinh_2k);
+        auto gamma_1 = c_1 / sinh_gamma;
+        return { std::acosh(cosh_gamma),
+                 gamma_1,
+                 (c_2 - cosh_gamma * gamma_1 * gamma_1) / sinh_gamma };
     }
 
     // [eq. 13.4 (51)]
@@ -59,74 +116,104 @@ private:
 
     // Direct calculation of Y1, ..., Y4 may overflow.
     // Use the identity log(Y1 + Y2 + Y3 + Y4) = log(1 + Y2/Y1 + Y3/Y1 + Y4/Y1) + log(Y1).
-
-    inline double log_Y1(const double & k)
-    {
-        double result = n_ * kMathLog2;
-        for (size_t q = 0; q != n_; ++q)
-            result += std::log(std::cosh(m_ * gamma(2 * q + 1, k) / 2));
-        return result;
-    }
-
-    inline double Y2_over_Y1(const double & k)
-    {
-        double result = 1.0;
-        for (size_t q = 0; q != n_; ++q)
-            result *= std::tanh(m_ * gamma(2 * q + 1, k) / 2);
-        return result;
-    }
-
-    inline double Y3_over_Y1(const double & k)
-    {
-        double result = 1.0;
-        for (size_t q = 0; q != n_; ++q)
-            result *= std::cosh(m_ * gamma(2 * q    , k) / 2)
-                    / std::cosh(m_ * gamma(2 * q + 1, k) / 2);
-        return result;
-    }
-
-    inline double Y4_over_Y1(const double & k)
-    {
-        double result = 1.0;
-        for (size_t q = 0; q != n_; ++q)
-            result *= std::sinh(m_ * gamma(2 * q    , k) / 2)
-                    / std::cosh(m_ * gamma(2 * q + 1, k) / 2);
-        return result;
-    }
+    // All of them (and their derivatives) are accumulated in a single pass over q.
+    // The ratios are accumulated as logarithms, since the partial products may underflow
+    // half-way and recover afterwards for large lattices.
+    // The loop over q is compiled for each instruction set, see "core/cpu-dispatch.h".
+    Derivatives log_Y(const double & k);
+    Derivatives log_Y_body(const double & k);
+    Derivatives log_Y_sse2(const double & k);
+    Derivatives log_Y_avx2(const double & k);
+    Derivatives log_Y_avx512(const double & k);
 
     // `Q` is the partition function.
     // [eq. 13.4 (50)] Q_{nm} (K) = 1/2 * (2sinh(2K))^(nm/2) * (Y1+Y2+Y3+Y4)
     // Use logarithm of partition function since direct calculation can easily overflow.
-    inline double log_Q(const double & k)
-    {
-        return -kMathLog2 + n_ * m_ / 2 * std::log(2 * std::sinh(2 * k))
-            + log_Y1(k) + std::log(1 + Y2_over_Y1(k) + Y3_over_Y1(k) + Y4_over_Y1(k));
-    }
+    Derivatives log_Q(const double & k);
+
+    // Infinite lattice results by L.Onsager.
+    // See R.K.Pathria & Paul D. Beale *Statistical Mechanics (3rd ed)* 13.4.A.
+    double OnsagerEnergy(const double & k);
+    double OnsagerSpecificHeat(const double & k);
 };
 
+// Number of coarse grid points used for bracketing the specific heat peak.
+const size_t kPeakBracketPoints = 32;
+// Relative tolerance (in T) of the peak location. Near a minimum f changes as (T - T_0)^2, so
+//   no method can locate it better than about sqrt(epsilon) |T| from the values of f.
+const double kPeakTolerance     = 1.0e-8;
+
+// The specific heat peak of the L * L torus in [t_begin, t_end], bracketed on a coarse grid and
+//   refined by Brent's method: T_c(L) and C_max(L). See `IsingExact2D` for `tolerance`.
+std::pair<double, double> SpecificHeatPeak(const size_t & size, const double & t_begin,
+    const double & t_end, const double & tolerance = 0.0);
+
 class Exact
 {
 public:
     Exact() = default;
     Exact(const Parameter & param);
 
+    // The specific heat (Kaufman), or all the observables by the transfer matrix (see
+    //   `ExactMethod`).
     int Run();
+    // Locate the specific heat peak (pseudo-critical temperature) for each size.
+    int RunPeak();
 
 private:
     typedef std::vector<double> Result;
 
+    // Chebyshev surrogate of C(T) for a given size and temperature range.
+    struct Surrogate
+    {
+        size_t size;
+        double t_min;
+        double t_max;
+        double tolerance;
+        // Of the exact solution fitted, see `asymptotic_tolerance_`.
+        double asymptotic_tolerance;
+        toolkit::Chebyshev specific_heat;
+    };
+
     std::vector<size_t> size_list_;
     std::vector<double> temperature_list_;
     std::vector<Result> result_;
 
+    ExactMethod         method_;
+    // Length of the tori of the transfer matrix (0 for square).
+    size_t              length_;
+    std::vector<double> magnetic_h_list_;
+    // By size, field and temperature.
+    std::vector<TransferResult> transfer_result_;
+
+    // Use surrogate when `surrogate_tolerance_` > 0.
+    double      surrogate_tolerance_;
+    std::string surrogate_cache_;
+    // Use the infinite lattice result when `asymptotic_tolerance_` > 0.
+    double      asymptotic_tolerance_;
+    std::string status_file_;
+
+    // For each size: T_c(L) and C_max(L).
+    std::vector<double> peak_temperature_;
+    std::vector<double> peak_specific_heat_;
+
     void Evaluate();
+    void EvaluateSurrogate();
+    void EvaluatePeak();
+    void EvaluateTransferMatrix();
     void PrintParameter(std::ostream & os);
     void PrintFirstRow(std::ostream & os);
     void PrintResult(std::ostream & os);
+    void PrintPeakResult(std::ostream & os);
+    void PrintTransferMatrixResult(std::ostream & os);
+
+    std::vector<Surrogate> ReadSurrogateCache();
+    void WriteSurrogateCache(const std::vector<Surrogate> & surrogates);
 };
 
 // Interface.
 int RunExact(const Parameter & param);
+int RunExactPeak(const Parameter & param);
 
 ISING_NAMESPACE_END
 
@@ -5,8 +5,15 @@
 
 ISING_TOOLKIT_NAMESPACE_BEGIN
 
+// The same generator as `rand()` of MSVC, but with a separate (single, global) state. Its
+//   values are in [0, kFastRandMax], whatever `RAND_MAX` is (2^31 - 1 with glibc).
+const unsigned int kFastRandMax = 0x7fff;
+
 unsigned int FastRand();
 
+// Uniform in [0, 1), so that a probability of 1 is always accepted.
+inline double FastRandUniform() { return FastRand() * (1.0 / (kFastRandMax + 1.0)); }
+
 void FastRandInitialize();
 void FastRandInitialize(const int & seed);
 
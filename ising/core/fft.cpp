@@ -0,0 +1,93 @@
+#include "core/fft.h"
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+const double kPi = 3.14159265358979323846;
+
+Fft::Fft(const size_t & n) :
+    n_(n == 0 ? 1 : n),
+    m_(1)
+{
+    const bool kPowerOfTwo = (n_ & (n_ - 1)) == 0;
+    while (m_ < (kPowerOfTwo ? n_ : 2 * n_ - 1))
+        m_ *= 2;
+    for (size_t k = 0; k != m_ / 2; ++k)
+        twiddles_.push_back(polar(1.0, -2.0 * kPi * k / m_));
+    if (kPowerOfTwo)
+        return;
+
+    // j^2 mod 2n keeps the phase accurate for large j.
+    for (size_t j = 0; j != n_; ++j)
+        chirp_.push_back(polar(1.0, -kPi * static_cast<double>(j * j % (2 * n_)) / n_));
+    filter_.assign(m_, Complex(0.0, 0.0));
+    filter_[0] = conj(chirp_[0]);
+    for (size_t j = 1; j != n_; ++j)
+        filter_[j] = filter_[m_ - j] = conj(chirp_[j]);
+    Radix2(filter_);
+}
+
+void Fft::Radix2(vector<Complex> & data) const
+{
+    // Bit reversal permutation.
+    for (size_t i = 1, j = 0; i != m_; ++i)
+    {
+        auto bit = m_ >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+            swap(data[i], data[j]);
+    }
+    for (size_t length = 2; length <= m_; length *= 2)
+    {
+        const auto kStride = m_ / length;
+        for (size_t i = 0; i != m_; i += length)
+            for (size_t k = 0; k != length / 2; ++k)
+            {
+                auto t = data[i + k + length / 2] * twiddles_[k * kStride];
+                data[i + k + length / 2] = data[i + k] - t;
+                data[i + k] += t;
+            }
+    }
+}
+
+void Fft::Forward(vector<Complex> & data) const
+{
+    if (chirp_.empty())
+    {
+        Radix2(data);
+        return;
+    }
+
+    // X_k = c_k sum_j (x_j c_j) conj(c_{k - j}), with c_j = exp(-pi i j^2 / n).
+    vector<Complex> work(m_, Complex(0.0, 0.0));
+    for (size_t j = 0; j != n_; ++j)
+        work[j] = data[j] * chirp_[j];
+    Radix2(work);
+    // Inverse transform of the product, by conjugation.
+    for (size_t j = 0; j != m_; ++j)
+        work[j] = conj(work[j] * filter_[j]);
+    Radix2(work);
+    for (size_t k = 0; k != n_; ++k)
+        data[k] = chirp_[k] * conj(work[k]) / static_cast<double>(m_);
+}
+
+void Fft::Inverse(vector<Complex> & data) const
+{
+    for (auto & x : data)
+        x = conj(x);
+    Forward(data);
+    for (auto & x : data)
+        x = conj(x) / static_cast<double>(n_);
+}
+
+ISING_TOOLKIT_NAMESPACE_END
@@ -0,0 +1,44 @@
+#ifndef ISING_CORE_FFT_H_
+#define ISING_CORE_FFT_H_
+
+#include <complex>
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Discrete Fourier transform of a fixed length n,
+//   X_k = sum_j x_j exp(-2 pi i j k / n),
+// in O(n log n) for any n: radix-2 for powers of two, Bluestein's algorithm (a convolution
+//   of length 2^m >= 2n - 1) otherwise. The tables are computed once by the constructor.
+class Fft
+{
+public:
+    typedef std::complex<double> Complex;
+
+    explicit Fft(const size_t & n = 1);
+
+    inline size_t Size() const { return n_; }
+
+    // In place, `data` has `Size()` elements.
+    void Forward(std::vector<Complex> & data) const;
+    // Inverse transform, including the 1 / n.
+    void Inverse(std::vector<Complex> & data) const;
+
+private:
+    size_t n_;
+    // Length of the radix-2 transforms (n_ for powers of two).
+    size_t m_;
+    // exp(-2 pi i k / m_), k < m_ / 2.
+    std::vector<Complex> twiddles_;
+    // Bluestein: exp(-pi i j^2 / n_), and the transform of its (conjugate) filter.
+    std::vector<Complex> chirp_;
+    std::vector<Complex> filter_;
+
+    void Radix2(std::vector<Complex> & data) const;
+};
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
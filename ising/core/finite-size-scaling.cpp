@@ -0,0 +1,291 @@
+#include "core/finite-size-scaling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "core/adaptive-grid.h"
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+// Quality of collapses where the sizes do not overlap.
+const double kNoOverlap = numeric_limits<double>::max();
+
+// Mean and standard error of `values`.
+GridPoint _MeanPoint(const double & temperature, const vector<double> & values)
+{
+    double n = static_cast<double>(values.size()), mean = 0.0, variance = 0.0;
+    for (auto value : values)
+        mean += value / n;
+    for (auto value : values)
+        variance += (value - mean) * (value - mean) / (n - 1.0);
+    return { temperature, mean, values.size() < 2 ? 0.0 : sqrt(variance / n) };
+}
+
+CellResponse EstimateResponse(const double & temperature, const vector<Observable> & results,
+    const double & sites)
+{
+    auto beta = 1.0 / temperature;
+    vector<double> specific_heat, susceptibility, binder_cumulant;
+    for (auto & result : results)
+    {
+        specific_heat.push_back(beta * beta * sites
+            * (result.energy_square - result.energy * result.energy));
+        susceptibility.push_back(beta * sites
+            * (result.magnetic_dipole_square - pow(result.magnetic_dipole_abs, 2)));
+        binder_cumulant.push_back(result.magnetic_dipole_square == 0.0 ? 0.0 :
+            1.0 - result.magnetic_dipole_fourth / (3.0 * pow(result.magnetic_dipole_square, 2)));
+    }
+    return { _MeanPoint(temperature, specific_heat), _MeanPoint(temperature, susceptibility),
+        _MeanPoint(temperature, binder_cumulant) };
+}
+
+// Linear interpolation of `curve` (sorted) at `temperature`. False if out of range.
+bool _Interpolate(const vector<GridPoint> & curve, const double & temperature, GridPoint & point)
+{
+    if (curve.empty() || temperature < curve.front().temperature
+        || temperature > curve.back().temperature)
+        return false;
+    auto upper = lower_bound(curve.begin(), curve.end(), temperature,
+        [](const GridPoint & p, const double & t) { return p.temperature < t; });
+    if (upper->temperature == temperature)
+    {
+        point = *upper;
+        return true;
+    }
+    auto lower = upper - 1;
+    auto w = (temperature - lower->temperature) / (upper->temperature - lower->temperature);
+    point.temperature = temperature;
+    point.value = (1.0 - w) * lower->value + w * upper->value;
+    point.error = sqrt(pow((1.0 - w) * lower->error, 2) + pow(w * upper->error, 2));
+    return true;
+}
+
+bool FindBinderCrossing(const vector<GridPoint> & small, const vector<GridPoint> & large,
+    BinderCrossing & crossing)
+{
+    if (small.empty() || large.empty())
+        return false;
+    auto t_min = max(small.front().temperature, large.front().temperature);
+    auto t_max = min(small.back().temperature, large.back().temperature);
+
+    // U_4(large) - U_4(small) on the temperatures of both curves.
+    vector<double> temperatures;
+    for (auto curve : { &small, &large })
+        for (auto & point : *curve)
+            if (point.temperature >= t_min && point.temperature <= t_max)
+                temperatures.push_back(point.temperature);
+    sort(temperatures.begin(), temperatures.end());
+    temperatures.erase(unique(temperatures.begin(), temperatures.end()), temperatures.end());
+    vector<GridPoint> difference;
+    for (auto t : temperatures)
+    {
+        GridPoint p, q;
+        _Interpolate(small, t, p);
+        _Interpolate(large, t, q);
+        difference.push_back({ t, q.value - p.value, sqrt(p.error * p.error + q.error * q.error) });
+    }
+
+    double steepest = 0.0;
+    for (size_t i = 0; i + 1 < difference.size(); ++i)
+    {
+        auto & a = difference[i];
+        auto & b = difference[i + 1];
+        if (a.value <= 0.0 || b.value > 0.0)
+            continue;
+        auto slope = (a.value - b.value) / (b.temperature - a.temperature);
+        if (slope <= steepest)
+            continue;
+        steepest = slope;
+        auto w = a.value / (a.value - b.value);
+        crossing.temperature = a.temperature + w * (b.temperature - a.temperature);
+        crossing.error = sqrt(pow((1.0 - w) * a.error, 2) + pow(w * b.error, 2)) / slope;
+    }
+    return steepest > 0.0;
+}
+
+double CollapseQuality(const vector<size_t> & sizes, const vector<vector<GridPoint>> & curves,
+    const double & critical_temperature, const double & nu, const double & exponent)
+{
+    if (nu <= 0.0)
+        return kNoOverlap;
+
+    vector<vector<GridPoint>> scaled(curves.size());
+    double range = 0.0;
+    for (size_t i = 0; i != curves.size(); ++i)
+    {
+        auto x_scale = pow(static_cast<double>(sizes[i]), 1.0 / nu);
+        auto y_scale = pow(static_cast<double>(sizes[i]), -exponent);
+        for (auto & point : curves[i])
+        {
+            scaled[i].push_back({ (point.temperature - critical_temperature) * x_scale,
+                point.value * y_scale, point.error * y_scale });
+            range = max(range, fabs(point.value * y_scale));
+        }
+    }
+    const auto kFloor = kCollapseErrorFloor * range;
+
+    double sum = 0.0;
+    size_t count = 0, total = 0;
+    for (size_t i = 0; i != scaled.size(); ++i)
+        for (auto & point : scaled[i])
+        {
+            total += 1;
+            double master = 0.0, variance = 0.0, n = 0.0;
+            GridPoint other;
+            for (size_t j = 0; j != scaled.size(); ++j)
+                if (j != i && _Interpolate(scaled[j], point.temperature, other))
+                {
+                    master   += other.value;
+                    variance += other.error * other.error;
+                    n        += 1.0;
+                }
+            if (n == 0.0)
+                continue;
+            master   /= n;
+            variance /= n * n;
+            auto denominator = point.error * point.error + variance + kFloor * kFloor;
+            sum += pow(point.value - master, 2) / max(denominator, numeric_limits<double>::min());
+            count += 1;
+        }
+    // Otherwise the collapse could improve by scaling the sizes apart.
+    if (count == 0 || 2 * count < total)
+        return kNoOverlap;
+    return sum / count;
+}
+
+// Nelder-Mead minimization of `f` from the simplex spanned by `start` and `steps`.
+vector<double> _Minimize(const function<double(const vector<double> &)> & f,
+    const vector<double> & start, const vector<double> & steps)
+{
+    const size_t kMaxEvaluations = 2000;
+    const double kTolerance      = 1.0e-10;
+
+    const auto kN = start.size();
+    vector<vector<double>> simplex(kN + 1, start);
+    vector<double> values(kN + 1);
+    for (size_t i = 0; i != kN; ++i)
+        simplex[i + 1][i] += steps[i];
+    for (size_t i = 0; i != kN + 1; ++i)
+        values[i] = f(simplex[i]);
+    size_t evaluations = kN + 1;
+
+    // x = c + t (w - c), from the centroid `c` of the best `kN` points and the worst `w`.
+    auto along = [](const vector<double> & c, const vector<double> & w, const double & t)
+    {
+        vector<double> x(c.size());
+        for (size_t k = 0; k != c.size(); ++k)
+            x[k] = c[k] + t * (w[k] - c[k]);
+        return x;
+    };
+    vector<size_t> order(kN + 1);
+    while (evaluations < kMaxEvaluations)
+    {
+        for (size_t i = 0; i != kN + 1; ++i)
+            order[i] = i;
+        sort(order.begin(), order.end(), [&](size_t a, size_t b) { return values[a] < values[b]; });
+        auto best = order.front(), worst = order.back(), second = order[kN - 1];
+        if (values[worst] - values[best] <= kTolerance * (fabs(values[best]) + kTolerance))
+            break;
+
+        vector<double> centroid(kN, 0.0);
+        for (size_t i = 0; i != kN; ++i)
+            for (size_t k = 0; k != kN; ++k)
+                centroid[k] += simplex[order[i]][k] / kN;
+
+        auto reflected = along(centroid, simplex[worst], -1.0);
+        auto reflected_value = f(reflected);
+        evaluations += 1;
+        if (reflected_value < values[best])
+        {
+            auto expanded = along(centroid, simplex[worst], -2.0);
+            auto expanded_value = f(expanded);
+            evaluations += 1;
+            if (expanded_value < reflected_value)
+                simplex[worst] = expanded, values[worst] = expanded_value;
+            else
+                simplex[worst] = reflected, values[worst] = reflected_value;
+            continue;
+        }
+        if (reflected_value < values[second])
+        {
+            simplex[worst] = reflected, values[worst] = reflected_value;
+            continue;
+        }
+        auto contracted = along(centroid, simplex[worst], 0.5);
+        auto contracted_value = f(contracted);
+        evaluations += 1;
+        if (contracted_value < values[worst])
+        {
+            simplex[worst] = contracted, values[worst] = contracted_value;
+            continue;
+        }
+        // Shrink towards the best point.
+        for (size_t i = 0; i != kN + 1; ++i)
+            if (i != best)
+            {
+                simplex[i] = along(simplex[best], simplex[i], 0.5);
+                values[i] = f(simplex[i]);
+                evaluations += 1;
+            }
+    }
+    return simplex[min_element(values.begin(), values.end()) - values.begin()];
+}
+
+CollapseFit FitCollapse(const vector<size_t> & sizes, const vector<vector<GridPoint>> & curves,
+    const CollapseFit & start, const bool & fit_scaling, const bool & fit_exponent)
+{
+    // The fitted ones of (Tc, nu, exponent).
+    vector<double *> parameters;
+    vector<double *> errors;
+    vector<double> steps;
+    CollapseFit fit = start;
+    if (fit_scaling)
+    {
+        parameters.insert(parameters.end(), { &fit.critical_temperature, &fit.nu });
+        errors.insert(errors.end(), { &fit.critical_temperature_error, &fit.nu_error });
+        steps.insert(steps.end(), { 0.05, 0.2 });
+    }
+    if (fit_exponent)
+    {
+        parameters.push_back(&fit.exponent);
+        errors.push_back(&fit.exponent_error);
+        steps.push_back(0.2);
+    }
+
+    auto quality = [&](const vector<double> & x)
+    {
+        for (size_t k = 0; k != x.size(); ++k)
+            *parameters[k] = x[k];
+        return CollapseQuality(sizes, curves, fit.critical_temperature, fit.nu, fit.exponent);
+    };
+    vector<double> x;
+    for (auto p : parameters)
+        x.push_back(*p);
+    if (x.empty() == false)
+        x = _Minimize(quality, x, steps);
+    fit.quality = quality(x);
+
+    // Quality + 1 from the curvature at the minimum.
+    for (size_t k = 0; k != x.size(); ++k)
+    {
+        auto h = 1.0e-3 * max(fabs(x[k]), 0.1);
+        auto shifted = x;
+        shifted[k] = x[k] + h;
+        auto upper = quality(shifted);
+        shifted[k] = x[k] - h;
+        auto lower = quality(shifted);
+        auto curvature = (upper - 2.0 * fit.quality + lower) / (h * h);
+        *errors[k] = curvature > 0.0 && upper != kNoOverlap && lower != kNoOverlap ?
+            sqrt(2.0 / curvature) : 0.0;
+    }
+    quality(x);
+    return fit;
+}
+
+ISING_NAMESPACE_END
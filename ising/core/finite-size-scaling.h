@@ -0,0 +1,75 @@
+#ifndef ISING_CORE_FINITE_SIZE_SCALING_H_
+#define ISING_CORE_FINITE_SIZE_SCALING_H_
+
+#include <vector>
+
+#include "core/adaptive-grid.h"
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Finite-size scaling of the cells of `Simulation`, see `Simulation::RunAnalysis()`.
+
+// Response functions (per site) of a cell with N sites:
+//   C_v = beta^2 N (<E^2> - <E>^2)                        specific heat
+//   chi = beta N (<m^2> - <|m|>^2)                        susceptibility
+//   U_4 = 1 - <m^4> / (3 <m^2>^2)                         Binder cumulant
+// Each repetition gives an estimate, and the error is the standard error of their mean
+//   (0 with a single repetition).
+struct CellResponse
+{
+    GridPoint specific_heat;
+    GridPoint susceptibility;
+    GridPoint binder_cumulant;
+};
+
+CellResponse EstimateResponse(const double & temperature, const std::vector<Observable> & results,
+    const double & sites);
+
+// The temperature where U_4 of a larger size drops below U_4 of a smaller one (the sizes
+//   order the other way in the disordered phase), by linear interpolation of both curves.
+// If the difference changes sign more than once (noise), the steepest crossing is taken.
+// The error is the error of the difference at the crossing over its slope.
+struct BinderCrossing
+{
+    double temperature;
+    double error;
+};
+
+// Curves sorted by temperature. False if they do not cross in their common range.
+bool FindBinderCrossing(const std::vector<GridPoint> & small, const std::vector<GridPoint> & large,
+    BinderCrossing & crossing);
+
+// Data collapse of y(T, L) = L^exponent f((T - Tc) L^(1 / nu)), e.g. exponent = 0 for U_4 and
+//   gamma / nu for chi. The quality of a collapse (Houdayer & Hartmann, PRB 70, 014418) is
+//   the mean of (y - Y)^2 / (dy^2 + dY^2) over the scaled points, where Y is the mean of the
+//   other sizes interpolated at the same scaled temperature. A floor of `kCollapseErrorFloor`
+//   of the scaled range is added to the errors, so that cells with a single repetition count.
+const double kCollapseErrorFloor = 1.0e-3;
+
+struct CollapseFit
+{
+    double critical_temperature = 0.0;
+    double nu                   = 1.0;
+    double exponent             = 0.0;
+    // Where the quality exceeds its minimum by 1 (0 for the fixed ones, or if not resolved).
+    double critical_temperature_error = 0.0;
+    double nu_error                   = 0.0;
+    double exponent_error             = 0.0;
+    double quality                    = 0.0;
+};
+
+// `curves[i]` of size `sizes[i]`, sorted by temperature. Large if the curves do not overlap.
+double CollapseQuality(const std::vector<size_t> & sizes,
+    const std::vector<std::vector<GridPoint>> & curves,
+    const double & critical_temperature, const double & nu, const double & exponent);
+
+// Least-squares collapse (Nelder-Mead) from `start`. Tc and nu are fitted if `fit_scaling`,
+//   and the exponent if `fit_exponent`.
+CollapseFit FitCollapse(const std::vector<size_t> & sizes,
+    const std::vector<std::vector<GridPoint>> & curves, const CollapseFit & start,
+    const bool & fit_scaling, const bool & fit_exponent);
+
+ISING_NAMESPACE_END
+
+#endif
@@ -24,7 +24,6 @@ string InformationSeparator()
 void PrintProgress(const size_t & total, const size_t & progress)
 {
     const size_t     kProgressBarWidth = 40;
-#ifndef ISING_PARALLEL
     const streamsize kPrecision        = 2;
     const streamsize kDefaultPrecision = cerr.precision();
     size_t width = kProgressBarWidth * progress / total;
@@ -36,13 +35,6 @@ void PrintProgress(const size_t & total, const size_t & progress)
          << "%\r"
          << skipws << setprecision(kDefaultPrecision) << defaultfloat;
     cerr.flush();
-#else
-    if (total < kProgressBarWidth)
-        cerr << "=";
-    else
-        if ((progress + 1) % (total / kProgressBarWidth) == 0)
-            cerr << "=";
-#endif
 }
 
 ISING_TOOLKIT_NAMESPACE_END
@@ -8,6 +8,7 @@
 ISING_TOOLKIT_NAMESPACE_BEGIN
 
 std::string InformationSeparator();
+// For serial loops only, use `Progress` (see "core/progress.h") for parallel ones.
 void PrintProgress(const size_t & total, const size_t & progress);
 
 ISING_TOOLKIT_NAMESPACE_END
@@ -0,0 +1,231 @@
+#include "core/ising-2d-disordered.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/counters.h"
+#include "core/evaluate.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+#include "core/metropolis.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+// Bits of the bonds of a site (see "core/ising-2d-disordered.h").
+const int kLeftBond  = 0;
+const int kRightBond = 1;
+const int kUpBond    = 2;
+const int kDownBond  = 3;
+const int kVacantSite      = 1 << 4;
+const int kFieldClassShift = 5;
+
+// J * spin for the bond `bond` of a site, i.e. -spin if the bit is set (two's complement).
+inline int _Coupled(const signed char & spin, const uint8_t & site, const int & bond)
+{
+    int negate = -((site >> bond) & 1);
+    return (spin ^ negate) - negate;
+}
+
+// Uniform in [0, 1), the same on all platforms (unlike `std::uniform_real_distribution`).
+inline double _Uniform(mt19937 & engine)
+{
+    return (static_cast<double>(engine()) + 0.5) / 4294967296.0;
+}
+
+// Metropolis step of the site `y` of `row`, with the neighbors `left` and `right` in the row.
+ISING_ALWAYS_INLINE void _DisorderedStep(const signed char * up, signed char * row,
+    const signed char * down, const uint8_t * site, const size_t & y,
+    const size_t & left, const size_t & right, const DisorderTable & table,
+    KernelCounters & counters)
+{
+    const auto kSite = site[y];
+    if (kSite & kVacantSite)
+        return;
+    _MetropolisStep(row[y], _Coupled(row[left], kSite, kLeftBond)
+                          + _Coupled(row[right], kSite, kRightBond)
+                          + _Coupled(up[y], kSite, kUpBond)
+                          + _Coupled(down[y], kSite, kDownBond),
+        table[kSite >> kFieldClassShift], counters);
+}
+
+Ising2DDisordered::Ising2DDisordered(const size_t & size) :
+    size_(size) {}
+
+Ising2DDisordered::Ising2DDisordered(const LatticeSize & size) : Ising2DDisordered(size.x) {}
+
+void Ising2DDisordered::Quench(const Disorder & disorder, const unsigned int & seed)
+{
+    disorder_ = disorder;
+    disorder_.field_classes = min(max(disorder_.field_classes, size_t(2)), kMaxFieldClasses);
+
+    // Each bond is drawn once, by the site on its left or above.
+    const auto L = size_;
+    mt19937 engine(seed);
+    sites_.assign(L * L, 0);
+    for (size_t x = 0; x != L; ++x)
+        for (size_t y = 0; y != L; ++y)
+        {
+            auto i = x * L + y;
+            if (_Uniform(engine) < disorder_.bond_probability)
+            {
+                sites_[i] |= 1 << kRightBond;
+                sites_[x * L + (y == L - 1 ? 0 : y + 1)] |= 1 << kLeftBond;
+            }
+            if (_Uniform(engine) < disorder_.bond_probability)
+            {
+                sites_[i] |= 1 << kDownBond;
+                sites_[(x == L - 1 ? 0 : x + 1) * L + y] |= 1 << kUpBond;
+            }
+            if (_Uniform(engine) < disorder_.dilution)
+                sites_[i] |= kVacantSite;
+            if (disorder_.random_field != 0.0)
+                sites_[i] |= static_cast<uint8_t>(engine() % disorder_.field_classes) << kFieldClassShift;
+        }
+    Initialize();
+}
+
+void Ising2DDisordered::Initialize()
+{
+    counters_ = KernelCounters(ExpArray().size());
+    if (sites_.size() != size_ * size_)
+        sites_.assign(size_ * size_, 0);
+    lattice_.assign(size_ * size_, 1);
+    occupied_count_ = 0;
+    for (size_t i = 0; i != lattice_.size(); ++i)
+    {
+        if (sites_[i] & kVacantSite)
+            lattice_[i] = 0;
+        else
+            occupied_count_ += 1;
+    }
+}
+
+double Ising2DDisordered::RandomField(const size_t & field_class) const
+{
+    if (disorder_.random_field == 0.0)
+        return 0.0;
+    return disorder_.random_field
+        * (2.0 * field_class / static_cast<double>(disorder_.field_classes - 1) - 1.0);
+}
+
+DisorderTable Ising2DDisordered::Table(const double & beta, const double & magnetic_h) const
+{
+    DisorderTable table;
+    for (size_t c = 0; c != kMaxFieldClasses; ++c)
+        table[c] = InitializeExpArray(beta, magnetic_h + RandomField(c));
+    return table;
+}
+
+void Ising2DDisordered::Sweep(const double & beta, const double & magnetic_h)
+{
+    Sweep(Table(beta, magnetic_h));
+}
+
+void Ising2DDisordered::Sweep(const DisorderTable & table)
+{
+    // Row after row as `Ising2D`, so that the clean model gives the same results as
+    //   `Ising2D_PBC` with the same random numbers.
+    const auto L = size_;
+    for (size_t x = 0; x != L; ++x)
+    {
+        auto up   = lattice_.data() + (x == 0 ? L - 1 : x - 1) * L;
+        auto row  = lattice_.data() + x * L;
+        auto down = lattice_.data() + (x == L - 1 ? 0 : x + 1) * L;
+        auto site = sites_.data() + x * L;
+        // Only the first and last columns wrap around.
+        if (L < 3)
+        {
+            for (size_t y = 0; y != L; ++y)
+                _DisorderedStep(up, row, down, site, y, y == 0 ? L - 1 : y - 1,
+                    y == L - 1 ? 0 : y + 1, table, counters_);
+            continue;
+        }
+        _DisorderedStep(up, row, down, site, 0, L - 1, 1, table, counters_);
+        for (size_t y = 1; y != L - 1; ++y)
+            _DisorderedStep(up, row, down, site, y, y - 1, y + 1, table, counters_);
+        _DisorderedStep(up, row, down, site, L - 1, L - 2, 0, table, counters_);
+    }
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += occupied_count_);
+}
+
+Observable Ising2DDisordered::Analysis(const double & magnetic_h) const
+{
+    if (occupied_count_ == 0)
+        return Observable();
+
+    // The bonds to the right and below, counted twice as `Ising2D` does.
+    const auto L = size_;
+    array<double, kMaxFieldClasses> fields;
+    for (size_t c = 0; c != kMaxFieldClasses; ++c)
+        fields[c] = RandomField(c);
+    long long spin_total = 0, bond_total = 0;
+    double field_total = 0.0;
+    for (size_t x = 0; x != L; ++x)
+    {
+        auto row  = lattice_.data() + x * L;
+        auto down = lattice_.data() + (x == L - 1 ? 0 : x + 1) * L;
+        auto site = sites_.data() + x * L;
+        for (size_t y = 0; y != L; ++y)
+        {
+            spin_total  += row[y];
+            bond_total  += row[y] * (_Coupled(row[y == L - 1 ? 0 : y + 1], site[y], kRightBond)
+                                   + _Coupled(down[y], site[y], kDownBond));
+            field_total += fields[site[y] >> kFieldClassShift] * row[y];
+        }
+    }
+
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -2.0 * bond_total - magnetic_h * spin_total - field_total;
+    auto scale = static_cast<double>(occupied_count_);
+    observable.magnetic_dipole /= scale;
+    observable.energy          /= scale;
+    observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    return observable;
+}
+
+Observable Ising2DDisordered::Evaluate(const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
+{
+    return _Evaluate(*this, counters_, beta, magnetic_h, iterations, n_ensemble, n_delta,
+        block_spin, correlation);
+}
+
+LatticeInfo Ising2DDisordered::EvaluateLatticeData(const double & beta,
+    const double & magnetic_h, const size_t & iterations)
+{
+    return _EvaluateLatticeData(*this, beta, magnetic_h, iterations);
+}
+
+Lattice2D Ising2DDisordered::Lattice() const
+{
+    Lattice2D lattice(size_, vector<int>(size_));
+    for (size_t i = 0; i != size_; ++i)
+        for (size_t j = 0; j != size_; ++j)
+            lattice[i][j] = lattice_[i * size_ + j];
+    return lattice;
+}
+
+string Ising2DDisordered::ShowRow(const size_t & row) const
+{
+    string result;
+    for (size_t j = 0; j != size_; ++j)
+        result += to_string(static_cast<int>(lattice_[row * size_ + j])) + " ";
+    return result;
+}
+
+ISING_NAMESPACE_END
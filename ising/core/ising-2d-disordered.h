@@ -0,0 +1,100 @@
+#ifndef ISING_CORE_ISING_2D_DISORDERED_H_
+#define ISING_CORE_ISING_2D_DISORDERED_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+#include "core/metropolis.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Metropolis function values of `Ising2DDisordered`: an `ExpArray` (see "core/metropolis.h")
+//   for each random field class.
+typedef std::array<ExpArray, kMaxFieldClasses> DisorderTable;
+
+// 2D Ising model with quenched disorder (see `Disorder`) and periodic boundary condition,
+//   H = -sum_<ij> J_ij s_i s_j - sum_i (h + h_i) s_i.
+// The disorder of a site is a byte next to its spin:
+//   bits 0 - 3  J = -1 to the left, right, upper and lower neighbor
+//   bit  4      vacant (the spin is 0 and never updated)
+//   bits 5 - 7  class of the random field h_i
+// so the nearest sum sum_j J_ij s_j is still in [-4, 4] and the Metropolis step is drawn from
+//   a table, as for the clean model.
+// Each `Quench()` draws a disorder sample, which only depends on the seed.
+// `Analysis()` is per occupied site. It has the same interface as `Ising2D`.
+class Ising2DDisordered
+{
+public:
+    static const size_t kNeighbors = 4;
+
+    Ising2DDisordered() = default;
+    Ising2DDisordered(const LatticeSize & size);
+    Ising2DDisordered(const size_t & size);
+
+    // Draw the disorder (the clean model before), and initialize.
+    void Quench(const Disorder & disorder, const unsigned int & seed);
+
+    // Initialize all the occupied spins to be +1.
+    void Initialize();
+
+    // Sweep through the lattice once using Metropolis algorithm.
+    void Sweep(const double & beta, const double & magnetic_h);
+    void Sweep(const DisorderTable & table);
+    DisorderTable Table(const double & beta, const double & magnetic_h) const;
+
+    // Calculate physical quantities.
+    Observable Analysis(const double & magnetic_h) const;
+
+    // A complete evaluation process. Should be initialized before!
+    // The blocked lattices and the correlations are measured along with the lattice if
+    //   `block_spin` and `correlation` are not null.
+    Observable Evaluate(const double & beta, const double & magnetic_h,
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1,
+        BlockSpinMeasurement * block_spin = nullptr,
+        CorrelationMeasurement * correlation = nullptr);
+
+    // For lattice data generating and convergence analysis.
+    LatticeInfo EvaluateLatticeData(const double & beta, const double & magnetic_h,
+        const size_t & iterations);
+
+    // The spins (0 for vacancies).
+    Lattice2D Lattice() const;
+    std::string ShowRow(const size_t & row) const;
+
+    // Number of sites (including vacancies).
+    size_t SiteCount() const { return size_ * size_; }
+
+    // Performance counters since the last `Initialize()`, classified as `ExpArray`.
+    const KernelCounters & Counters() const { return counters_; }
+
+private:
+    const size_t size_;
+
+    Disorder                  disorder_;
+    // Row after row.
+    std::vector<signed char>  lattice_;
+    std::vector<uint8_t>      sites_;
+    size_t                    occupied_count_;
+
+    KernelCounters counters_;
+
+    // Field of the random field class `field_class`.
+    double RandomField(const size_t & field_class) const;
+};
+
+// Table of `Ising2DDisordered::Sweep()`, see `InitializeSweepTable()` in "core/evaluate.h".
+inline DisorderTable InitializeSweepTable(const Ising2DDisordered & lattice, const double & beta,
+    const double & magnetic_h)
+{
+    return lattice.Table(beta, magnetic_h);
+}
+
+ISING_NAMESPACE_END
+
+#endif
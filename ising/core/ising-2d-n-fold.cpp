@@ -0,0 +1,196 @@
+#include "core/ising-2d-n-fold.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/counters.h"
+#include "core/evaluate.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+#include "core/metropolis.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+// Uniform in (0, 1).
+inline double _OpenUniform(mt19937 & engine)
+{
+    return (static_cast<double>(engine()) + 0.5) / 4294967296.0;
+}
+
+const size_t Ising2DNFold::kClassCount;
+
+Ising2DNFold::Ising2DNFold(const size_t & size) :
+    size_(size) {}
+
+Ising2DNFold::Ising2DNFold(const LatticeSize & size) : Ising2DNFold(size.x) {}
+
+void Ising2DNFold::Initialize()
+{
+    counters_ = KernelCounters(kClassCount);
+    engine_.seed((FastRand() << 16) ^ FastRand());
+
+    // All the sites in the class (+1, 4).
+    const auto kSites = size_ * size_;
+    const auto kClass = _MetropolisIndex<kNeighbors>(static_cast<int>(kNeighbors), 1);
+    lattice_.assign(kSites, 1);
+    classes_.assign(kSites, static_cast<uint8_t>(kClass));
+    buckets_.resize(kSites);
+    positions_.resize(kSites);
+    for (size_t i = 0; i != kSites; ++i)
+        buckets_[i] = positions_[i] = static_cast<uint32_t>(i);
+    for (size_t c = 0; c != kClassCount + 1; ++c)
+        begin_[c] = c <= static_cast<size_t>(kClass) ? 0 : kSites;
+}
+
+void Ising2DNFold::Move(const size_t & site, const int & shift)
+{
+    auto from = static_cast<size_t>(classes_[site]);
+    auto to   = static_cast<size_t>(static_cast<int>(from) + shift);
+    auto swap_to = [this, &site](const size_t & position)
+    {
+        auto other = buckets_[position];
+        buckets_[positions_[site]] = other;
+        positions_[other] = positions_[site];
+        buckets_[position] = static_cast<uint32_t>(site);
+        positions_[site]   = static_cast<uint32_t>(position);
+    };
+    // One swap per bucket boundary on the way: to the last (first) place of the bucket, which
+    //   then shrinks by one and the next (previous) bucket grows.
+    for (; from < to; ++from)
+        swap_to(--begin_[from + 1]);
+    for (; from > to; --from)
+        swap_to(begin_[from]++);
+    classes_[site] = static_cast<uint8_t>(to);
+}
+
+void Ising2DNFold::Flip(const size_t & site)
+{
+    // The class of the site moves to the other spin, and the nearest sums of the neighbors
+    //   change by -2 spin (twice for a neighbor on both sides, if L = 2).
+    const int kSumCount = 2 * kNeighbors + 1;
+    const auto L = size_;
+    auto x = site / L, y = site % L;
+    auto row = site - y;
+    int spin = lattice_[site];
+    lattice_[site] = static_cast<signed char>(-spin);
+    Move(site, spin * kSumCount);
+    Move(row + (y == 0 ? L - 1 : y - 1), -2 * spin);
+    Move(row + (y == L - 1 ? 0 : y + 1), -2 * spin);
+    Move((x == 0 ? L - 1 : x - 1) * L + y, -2 * spin);
+    Move((x == L - 1 ? 0 : x + 1) * L + y, -2 * spin);
+}
+
+void Ising2DNFold::Sweep(const double & beta, const double & magnetic_h)
+{
+    Sweep(InitializeExpArray(beta, magnetic_h));
+}
+
+void Ising2DNFold::Sweep(const ExpArray & exp_array)
+{
+    // The exponential waiting time has no memory, so each sweep starts afresh.
+    array<double, kClassCount> rates;
+    double time = 1.0;
+    while (true)
+    {
+        double total = 0.0;
+        for (size_t c = 0; c != kClassCount; ++c)
+        {
+            rates[c] = static_cast<double>(begin_[c + 1] - begin_[c]) * exp_array[c];
+            total += rates[c];
+        }
+        // Frozen (zero temperature).
+        if (total == 0.0)
+            break;
+        time += log(_OpenUniform(engine_)) / total;
+        ISING_COUNT(counters_.rand_draws += 1);
+        if (time < 0.0)
+            break;
+
+        // The class, and the site from what is left of the same random number.
+        auto x = _OpenUniform(engine_) * total;
+        size_t c = kClassCount;
+        for (size_t k = 0; k != kClassCount; ++k)
+            if (rates[k] != 0.0)
+            {
+                c = k;
+                if (x < rates[k])
+                    break;
+                x -= rates[k];
+            }
+        auto count  = begin_[c + 1] - begin_[c];
+        auto offset = min(static_cast<size_t>(x / exp_array[c]), count - 1);
+        Flip(buckets_[begin_[c] + offset]);
+        ISING_COUNT(counters_.rand_draws += 1);
+        ISING_COUNT(counters_.attempted_by_class[c] += 1);
+        ISING_COUNT(counters_.accepted_by_class[c] += 1);
+    }
+    ISING_COUNT(counters_.sweeps += 1);
+}
+
+Observable Ising2DNFold::Analysis(const double & magnetic_h) const
+{
+    // Each class has a single spin and nearest sum.
+    const int kSumCount = 2 * kNeighbors + 1;
+    long long spin_total = 0, energy_total = 0;
+    for (size_t c = 0; c != kClassCount; ++c)
+    {
+        auto count = static_cast<long long>(begin_[c + 1] - begin_[c]);
+        int spin = c < static_cast<size_t>(kSumCount) ? 1 : -1;
+        int spin_sum = static_cast<int>(c) % kSumCount - static_cast<int>(kNeighbors);
+        spin_total   += count * spin;
+        energy_total += count * spin * spin_sum;
+    }
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -static_cast<double>(energy_total) - magnetic_h * spin_total;
+    auto scale = static_cast<double>(size_ * size_);
+    observable.magnetic_dipole /= scale;
+    observable.energy          /= scale;
+    observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    return observable;
+}
+
+Observable Ising2DNFold::Evaluate(const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
+{
+    return _Evaluate(*this, counters_, beta, magnetic_h, iterations, n_ensemble, n_delta,
+        block_spin, correlation);
+}
+
+LatticeInfo Ising2DNFold::EvaluateLatticeData(const double & beta, const double & magnetic_h,
+    const size_t & iterations)
+{
+    return _EvaluateLatticeData(*this, beta, magnetic_h, iterations);
+}
+
+Lattice2D Ising2DNFold::Lattice() const
+{
+    Lattice2D lattice(size_, vector<int>(size_));
+    for (size_t i = 0; i != size_; ++i)
+        for (size_t j = 0; j != size_; ++j)
+            lattice[i][j] = lattice_[i * size_ + j];
+    return lattice;
+}
+
+string Ising2DNFold::ShowRow(const size_t & row) const
+{
+    string result;
+    for (size_t j = 0; j != size_; ++j)
+        result += to_string(static_cast<int>(lattice_[row * size_ + j])) + " ";
+    return result;
+}
+
+ISING_NAMESPACE_END
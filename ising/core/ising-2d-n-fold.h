@@ -0,0 +1,96 @@
+#ifndef ISING_CORE_ISING_2D_N_FOLD_H_
+#define ISING_CORE_ISING_2D_N_FOLD_H_
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+#include "core/metropolis.h"
+
+ISING_NAMESPACE_BEGIN
+
+// 2D Ising model with periodic boundary condition, simulated by the n-fold way (Bortz,
+//   Kalos & Lebowitz, J. Comput. Phys. 17, 10): a rejection-free, continuous-time version of
+//   the Metropolis algorithm for low temperatures, where most proposals of `Ising2D` fail.
+// The sites are kept in buckets by their class (spin, nearest sum), i.e. the index of
+//   `ExpArray`. A site of class c flips with rate p_c = `ExpArray[c]` per sweep (one attempt
+//   per site), so the next flip comes after an exponential time of rate R = sum_c n_c p_c,
+//   in a class drawn with the weights n_c p_c and at a uniform site of its bucket.
+// `Sweep()` advances the time by one sweep, so that it replaces `Ising2D_PBC::Sweep()` in
+//   `Evaluate()` with the same equilibrium (but fewer flips per sweep at low temperatures).
+// Nothing is allocated after `Initialize()`. Its random numbers are seeded by `FastRand()`.
+// Counters: the flips are counted as attempted and accepted.
+class Ising2DNFold
+{
+public:
+    static const size_t kNeighbors = 4;
+
+    Ising2DNFold() = default;
+    Ising2DNFold(const LatticeSize & size);
+    Ising2DNFold(const size_t & size);
+
+    // Initialize all the spins to be +1.
+    void Initialize();
+
+    // Advance the time by one sweep.
+    void Sweep(const double & beta, const double & magnetic_h);
+    void Sweep(const ExpArray & exp_array);
+
+    // Calculate physical quantities (from the bucket sizes).
+    Observable Analysis(const double & magnetic_h) const;
+
+    // A complete evaluation process. Should be initialized before!
+    // The blocked lattices and the correlations are measured along with the lattice if
+    //   `block_spin` and `correlation` are not null.
+    Observable Evaluate(const double & beta, const double & magnetic_h,
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1,
+        BlockSpinMeasurement * block_spin = nullptr,
+        CorrelationMeasurement * correlation = nullptr);
+
+    // For lattice data generating and convergence analysis.
+    LatticeInfo EvaluateLatticeData(const double & beta, const double & magnetic_h,
+        const size_t & iterations);
+
+    Lattice2D Lattice() const;
+    std::string ShowRow(const size_t & row) const;
+
+    // Number of spins.
+    size_t SiteCount() const { return size_ * size_; }
+
+    // Performance counters since the last `Initialize()`.
+    const KernelCounters & Counters() const { return counters_; }
+
+private:
+    static const size_t kClassCount = 2 * (2 * kNeighbors + 1);
+
+    const size_t size_;
+
+    // Row after row.
+    std::vector<signed char>   lattice_;
+    // Class of each site.
+    std::vector<uint8_t>       classes_;
+    // Sites ordered by class, the bucket of class c being [begin_[c], begin_[c + 1]), and the
+    //   position of each site in `buckets_`.
+    std::vector<uint32_t>      buckets_;
+    std::vector<uint32_t>      positions_;
+    std::array<size_t, kClassCount + 1> begin_;
+
+    std::mt19937 engine_;
+
+    KernelCounters counters_;
+
+    // Flip `site` and move it and its neighbors to their new buckets.
+    void Flip(const size_t & site);
+    // Move `site` by `shift` classes.
+    void Move(const size_t & site, const int & shift);
+};
+
+ISING_NAMESPACE_END
+
+#endif
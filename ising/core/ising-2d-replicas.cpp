@@ -0,0 +1,257 @@
+#include "core/ising-2d-replicas.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/cpu-dispatch.h"
+#include "core/evaluate.h"
+#include "core/ising.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+// The nearest sum of 4 spins is even, so (spin * nearest sum, spin) takes 10 values.
+const size_t kReplicaClassCount = 10;
+
+// Class of a spin with the nearest sum `spin_sum`: (spin * spin_sum + 4) / 2 for spin = +1,
+//   and 5 more for spin = -1 (without branches, so that it vectorizes).
+ISING_ALWAYS_INLINE int _ReplicaClass(const int & spin, const int & spin_sum)
+{
+    return ((spin * spin_sum + 4) >> 1) + (5 & (spin >> 1));
+}
+
+// Metropolis sweep of all the lanes, a site after another. Compiled for each instruction set,
+//   see "core/cpu-dispatch.h".
+template <size_t kLanes>
+struct ReplicaKernels
+{
+    typedef void (*Sweep)(signed char *, const size_t &, const uint32_t *, uint32_t *);
+};
+
+template <size_t kLanes>
+ISING_ALWAYS_INLINE void _SweepReplicas(signed char * lattice, const size_t & size,
+    const uint32_t * thresholds, uint32_t * streams)
+{
+    const auto L = size;
+    auto s0 = streams, s1 = streams + kLanes, s2 = streams + 2 * kLanes, s3 = streams + 3 * kLanes;
+    for (size_t x = 0; x != L; ++x)
+    {
+        auto up   = lattice + (x == 0 ? L - 1 : x - 1) * L * kLanes;
+        auto row  = lattice + x * L * kLanes;
+        auto down = lattice + (x == L - 1 ? 0 : x + 1) * L * kLanes;
+        for (size_t y = 0; y != L; ++y)
+        {
+            auto site  = row + y * kLanes;
+            auto left  = row + (y == 0 ? L - 1 : y - 1) * kLanes;
+            auto right = row + (y == L - 1 ? 0 : y + 1) * kLanes;
+            auto u = up + y * kLanes, d = down + y * kLanes;
+            ISING_IVDEP
+            for (size_t r = 0; r != kLanes; ++r)
+            {
+                int spin = site[r];
+                auto index = _ReplicaClass(spin, left[r] + right[r] + u[r] + d[r]);
+                uint32_t threshold = 0;
+                for (size_t c = 0; c != kReplicaClassCount; ++c)
+                    threshold |= (0u - static_cast<uint32_t>(index == static_cast<int>(c)))
+                               & thresholds[c * kLanes + r];
+                // xorshift128 (Marsaglia).
+                uint32_t t = s0[r] ^ (s0[r] << 11);
+                s0[r] = s1[r];
+                s1[r] = s2[r];
+                s2[r] = s3[r];
+                s3[r] = s3[r] ^ (s3[r] >> 19) ^ t ^ (t >> 8);
+                site[r] = static_cast<signed char>((s3[r] >> 1) < threshold ? -spin : spin);
+            }
+        }
+    }
+}
+
+template <size_t kLanes>
+ISING_TARGET_SSE2 void _SweepReplicasSse2(signed char * lattice, const size_t & size,
+    const uint32_t * thresholds, uint32_t * streams)
+{
+    _SweepReplicas<kLanes>(lattice, size, thresholds, streams);
+}
+
+template <size_t kLanes>
+ISING_TARGET_AVX2 void _SweepReplicasAvx2(signed char * lattice, const size_t & size,
+    const uint32_t * thresholds, uint32_t * streams)
+{
+    _SweepReplicas<kLanes>(lattice, size, thresholds, streams);
+}
+
+template <size_t kLanes>
+ISING_TARGET_AVX512 void _SweepReplicasAvx512(signed char * lattice, const size_t & size,
+    const uint32_t * thresholds, uint32_t * streams)
+{
+    _SweepReplicas<kLanes>(lattice, size, thresholds, streams);
+}
+
+template <size_t kLanes>
+typename ReplicaKernels<kLanes>::Sweep _SelectSweepReplicas()
+{
+    switch (ActiveCpuPath())
+    {
+    case kCpuAvx512:
+        return _SweepReplicasAvx512<kLanes>;
+    case kCpuAvx2:
+        return _SweepReplicasAvx2<kLanes>;
+    default:
+        return _SweepReplicasSse2<kLanes>;
+    }
+}
+
+template <size_t kLanes>
+Ising2DReplicas<kLanes>::Ising2DReplicas(const size_t & size) :
+    size_(size) {}
+
+template <size_t kLanes>
+Ising2DReplicas<kLanes>::Ising2DReplicas(const LatticeSize & size) : Ising2DReplicas(size.x) {}
+
+template <size_t kLanes>
+void Ising2DReplicas<kLanes>::Initialize(const vector<ReplicaLane> & lanes)
+{
+    counters_ = KernelCounters();
+    lanes_.assign(lanes.begin(), lanes.begin() + min(lanes.size(), kLanes));
+    lattice_.assign(size_ * size_ * kLanes, 1);
+
+    // Thresholds of min(1, exp(-beta dE)) with dE = 2 (spin * nearest sum + spin * h), and
+    //   0 for the unused lanes.
+    const double kScale = 2147483648.0;
+    thresholds_.assign(kReplicaClassCount * kLanes, 0);
+    streams_.assign(4 * kLanes, 0);
+    for (size_t r = 0; r != lanes_.size(); ++r)
+    {
+        auto & lane = lanes_[r];
+        for (size_t c = 0; c != kReplicaClassCount; ++c)
+        {
+            double spin = c < kReplicaClassCount / 2 ? 1.0 : -1.0;
+            double product = 2.0 * static_cast<double>(c % (kReplicaClassCount / 2)) - 4.0;
+            auto probability = exp(-2.0 * lane.beta * (product + spin * lane.magnetic_h));
+            thresholds_[c * kLanes + r] = probability >= 1.0 ?
+                static_cast<uint32_t>(kScale) : static_cast<uint32_t>(probability * kScale);
+        }
+        seed_seq sequence{ lane.seed };
+        uint32_t state[4];
+        sequence.generate(state, state + 4);
+        // The state should not be all zero.
+        if ((state[0] | state[1] | state[2] | state[3]) == 0)
+            state[3] = 1;
+        for (size_t k = 0; k != 4; ++k)
+            streams_[k * kLanes + r] = state[k];
+    }
+}
+
+template <size_t kLanes>
+void Ising2DReplicas<kLanes>::Sweep()
+{
+    auto sweep = _SelectSweepReplicas<kLanes>();
+    sweep(lattice_.data(), size_, thresholds_.data(), streams_.data());
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += size_ * size_ * lanes_.size());
+}
+
+template <size_t kLanes>
+vector<Observable> Ising2DReplicas<kLanes>::Analysis() const
+{
+    // The bonds to the right and below, counted twice as `Ising2D` does.
+    const auto L = size_;
+    vector<long long> spin_total(kLanes, 0), bond_total(kLanes, 0);
+    for (size_t x = 0; x != L; ++x)
+    {
+        auto row  = lattice_.data() + x * L * kLanes;
+        auto down = lattice_.data() + (x == L - 1 ? 0 : x + 1) * L * kLanes;
+        int spin_sum[kLanes] = {}, bond_sum[kLanes] = {};
+        for (size_t y = 0; y != L; ++y)
+        {
+            auto site  = row + y * kLanes;
+            auto right = row + (y == L - 1 ? 0 : y + 1) * kLanes;
+            auto d     = down + y * kLanes;
+            ISING_IVDEP
+            for (size_t r = 0; r != kLanes; ++r)
+            {
+                spin_sum[r] += site[r];
+                bond_sum[r] += site[r] * (right[r] + d[r]);
+            }
+        }
+        for (size_t r = 0; r != kLanes; ++r)
+        {
+            spin_total[r] += spin_sum[r];
+            bond_total[r] += bond_sum[r];
+        }
+    }
+
+    vector<Observable> observables(lanes_.size());
+    auto scale = static_cast<double>(L * L);
+    for (size_t r = 0; r != lanes_.size(); ++r)
+    {
+        auto & observable = observables[r];
+        observable.magnetic_dipole = static_cast<double>(spin_total[r]);
+        observable.energy          = -2.0 * bond_total[r] - lanes_[r].magnetic_h * spin_total[r];
+        observable.magnetic_dipole /= scale;
+        observable.energy          /= scale;
+        observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+        observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+        observable.energy_square          = pow(observable.energy, 2);
+        observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+        observable.energy_fourth          = pow(observable.energy_square, 2);
+    }
+    return observables;
+}
+
+template <size_t kLanes>
+vector<Observable> Ising2DReplicas<kLanes>::Evaluate(const size_t & iterations,
+    const size_t & n_ensemble, const size_t & n_delta,
+    const vector<BlockSpinMeasurement *> & block_spin,
+    const vector<CorrelationMeasurement *> & correlation)
+{
+    vector<Observable> observables(lanes_.size());
+    auto analyses = _EvaluateSchedule(counters_, iterations, n_ensemble, n_delta,
+        [this]() { Sweep(); }, [&]()
+    {
+        auto analysis = Analysis();
+        for (size_t r = 0; r != lanes_.size(); ++r)
+        {
+            observables[r] += analysis[r];
+            auto lane_block_spin  = r < block_spin.size()  ? block_spin[r]  : nullptr;
+            auto lane_correlation = r < correlation.size() ? correlation[r] : nullptr;
+            if (lane_block_spin || lane_correlation)
+            {
+                auto spins = Lattice(r);
+                if (lane_block_spin)
+                    lane_block_spin->Measure(spins, lanes_[r].magnetic_h);
+                if (lane_correlation)
+                    lane_correlation->Measure(spins);
+            }
+        }
+        ISING_COUNT(counters_.analyses += lanes_.size());
+    });
+    // Normalize.
+    for (auto & observable : observables)
+        observable = observable / static_cast<double>(analyses);
+    return observables;
+}
+
+template <size_t kLanes>
+Lattice2D Ising2DReplicas<kLanes>::Lattice(const size_t & lane) const
+{
+    Lattice2D lattice(size_, vector<int>(size_));
+    for (size_t i = 0; i != size_; ++i)
+        for (size_t j = 0; j != size_; ++j)
+            lattice[i][j] = lattice_[(i * size_ + j) * kLanes + lane];
+    return lattice;
+}
+
+template class Ising2DReplicas<16>;
+template class Ising2DReplicas<32>;
+template class Ising2DReplicas<64>;
+
+ISING_NAMESPACE_END
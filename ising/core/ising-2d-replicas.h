@@ -0,0 +1,84 @@
+#ifndef ISING_CORE_ISING_2D_REPLICAS_H_
+#define ISING_CORE_ISING_2D_REPLICAS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// A lattice of `Ising2DReplicas`, with its own temperature, field and random stream.
+struct ReplicaLane
+{
+    double       beta;
+    double       magnetic_h;
+    unsigned int seed;
+};
+
+// `kLanes` independent 2D Ising models (periodic, L * L) swept in lockstep by Metropolis,
+//   e.g. the cells of a size at different temperatures and their repetitions.
+// The spins are stored site after site, with the `kLanes` lanes of a site next to each
+//   other, so the update of a site is the same for all the lanes and vectorizes over them.
+// Each lane has its own acceptance thresholds (in 1 / 2^31), by (spin * nearest sum, spin),
+//   and its own xorshift128 random stream, seeded by `ReplicaLane::seed`. The thresholds are
+//   selected with masks rather than indexed, which would need a gather.
+// Unused lanes never flip. The classes of the flips are not counted.
+// Instantiated for 16, 32 and 64 lanes (fewer lanes do not fill a vector).
+template <size_t kLanes>
+class Ising2DReplicas
+{
+public:
+    Ising2DReplicas(const LatticeSize & size);
+    Ising2DReplicas(const size_t & size);
+
+    // Initialize all the spins of up to `kLanes` lanes to be +1.
+    void Initialize(const std::vector<ReplicaLane> & lanes);
+
+    // Sweep through the lattices once.
+    void Sweep();
+
+    // Calculate physical quantities of each lane.
+    std::vector<Observable> Analysis() const;
+
+    // A complete evaluation process of each lane (see `Ising2D::Evaluate()`). Should be
+    //   initialized before!
+    // `block_spin` and `correlation` are empty, or have a measurement (or null) per lane.
+    std::vector<Observable> Evaluate(const size_t & iterations, const size_t & n_ensemble,
+        const size_t & n_delta = 1,
+        const std::vector<BlockSpinMeasurement *> & block_spin = std::vector<BlockSpinMeasurement *>(),
+        const std::vector<CorrelationMeasurement *> & correlation = std::vector<CorrelationMeasurement *>());
+
+    // The spins of a lane.
+    Lattice2D Lattice(const size_t & lane) const;
+    // The spins of all the lanes in place, `kLanes` per site (see above), until the next
+    //   `Initialize()`.
+    const signed char * Spins() const { return lattice_.data(); }
+
+    size_t LaneCount() const { return lanes_.size(); }
+    // Number of spins of a lane.
+    size_t SiteCount() const { return size_ * size_; }
+
+    // Performance counters of all the lanes since the last `Initialize()`.
+    const KernelCounters & Counters() const { return counters_; }
+
+private:
+    const size_t size_;
+
+    std::vector<ReplicaLane>   lanes_;
+    // `kLanes` spins per site, site after site.
+    std::vector<signed char>   lattice_;
+    // `kLanes` thresholds per class (spin * nearest sum, spin), see `_ReplicaClass()`.
+    std::vector<std::uint32_t> thresholds_;
+    // The 4 words of the xorshift128 state, `kLanes` each.
+    std::vector<std::uint32_t> streams_;
+
+    KernelCounters counters_;
+};
+
+ISING_NAMESPACE_END
+
+#endif
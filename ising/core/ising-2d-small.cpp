@@ -0,0 +1,190 @@
+#include "core/ising-2d-small.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "core/counters.h"
+#include "core/evaluate.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+// Loops with fixed trip counts are fully unrolled.
+#if defined __GNUC__ && !defined __clang__ && __GNUC__ >= 8
+#define ISING_UNROLL _Pragma("GCC unroll 32")
+#elif defined __clang__
+#define ISING_UNROLL _Pragma("unroll")
+#else
+#define ISING_UNROLL
+#endif
+
+ISING_NAMESPACE_BEGIN
+
+// The acceptance of a flip against 4 equal neighbors at T = 2.75 (h = 0), above which the sweep
+//   flips without a branch (measured on x86-64, the two are even from about T = 2.75 to 3).
+const double kBranchFreeAcceptance = exp(-8.0 / 2.75);
+
+inline int _PopCount(const uint64_t & x)
+{
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(x));
+#else
+    return __builtin_popcountll(x);
+#endif
+}
+
+inline int _Bit(const uint64_t & x, const size_t & i)
+{
+    return static_cast<int>((x >> i) & 1);
+}
+
+template <size_t L>
+const typename Ising2DSmall<L>::Word Ising2DSmall<L>::kRowMask;
+
+template <size_t L>
+Ising2DSmall<L>::Ising2DSmall(const LatticeSize &) {}
+
+template <size_t L>
+Ising2DSmall<L>::Ising2DSmall(const size_t &) {}
+
+template <size_t L>
+void Ising2DSmall<L>::Initialize()
+{
+    counters_ = KernelCounters(ExpArray().size());
+    words_.fill(0);
+    for (size_t i = 0; i != L; ++i)
+        SetRow(i, kRowMask);
+}
+
+template <size_t L>
+void Ising2DSmall<L>::Sweep(const double & beta, const double & magnetic_h)
+{
+    Sweep(InitializeExpArray(beta, magnetic_h));
+}
+
+template <size_t L>
+void Ising2DSmall<L>::Sweep(const ExpArray & exp_array)
+{
+    // Indices 8 and 9 are the flips against 4 equal neighbors (of spin +1 and -1).
+    if (max(exp_array[8], exp_array[9]) > kBranchFreeAcceptance)
+        SweepRows<true>(exp_array);
+    else
+        SweepRows<false>(exp_array);
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += L * L);
+}
+
+template <size_t L>
+template <bool kBranchFree>
+void Ising2DSmall<L>::SweepRows(const ExpArray & exp_array)
+{
+    // Visit the sites row by row as `Ising2D` does. With n the number of +1 nearest
+    // spins, the nearest sum is 2n - 4, so the index of `exp_array` is 2n for spin +1
+    // and 2n + 9 for spin -1.
+    for (size_t i = 0; i != L; ++i)
+    {
+        // The rows above and below do not change while sweeping this row.
+        auto up   = Row(i == 0 ? L - 1 : i - 1);
+        auto down = Row(i == L - 1 ? 0 : i + 1);
+        auto row  = Row(i);
+        ISING_UNROLL
+        for (size_t j = 0; j != L; ++j)
+        {
+            auto up_count = _Bit(up, j) + _Bit(down, j)
+                          + _Bit(row, j == 0 ? L - 1 : j - 1) + _Bit(row, j == L - 1 ? 0 : j + 1);
+            auto exp_array_index = 2 * up_count + (_Bit(row, j) ? 0 : 9);
+            Word flip = FastRandUniform() < exp_array[exp_array_index];
+            if (kBranchFree)
+                row ^= flip << j;
+            else if (flip)
+                row ^= Word(1) << j;
+            ISING_COUNT(counters_.attempted_by_class[exp_array_index] += 1);
+            ISING_COUNT(counters_.accepted_by_class[exp_array_index] += flip);
+        }
+        SetRow(i, row);
+    }
+}
+
+template <size_t L>
+Observable Ising2DSmall<L>::Analysis(const double & magnetic_h) const
+{
+    // A bond contributes +1 to the energy sum if the two spins are equal and -1 otherwise,
+    // i.e. L - 2 * popcount(a ^ b) for the L bonds between rows (or shifted rows) a and b.
+    long long up_total = 0, bond_total = 0;
+    ISING_UNROLL
+    for (size_t i = 0; i != L; ++i)
+    {
+        auto row  = Row(i);
+        auto down = Row(i == L - 1 ? 0 : i + 1);
+        up_total   += _PopCount(row);
+        bond_total += 2 * static_cast<long long>(L) - 2 * _PopCount(row ^ RotateLeft(row))
+                    - 2 * _PopCount(row ^ down);
+    }
+    // Sum of (spin * nearest sum) counts each bond twice.
+    auto spin_total   = 2 * up_total - static_cast<long long>(L * L);
+    auto energy_total = 2 * bond_total;
+
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -static_cast<double>(energy_total) - magnetic_h * spin_total;
+    auto scale = static_cast<double>(L * L);
+    observable.magnetic_dipole /= scale;
+    observable.energy          /= scale;
+    observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    return observable;
+}
+
+template <size_t L>
+Observable Ising2DSmall<L>::Evaluate(const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
+{
+    return _Evaluate(*this, counters_, beta, magnetic_h, iterations, n_ensemble, n_delta,
+        block_spin, correlation);
+}
+
+template <size_t L>
+LatticeInfo Ising2DSmall<L>::EvaluateLatticeData(const double & beta,
+    const double & magnetic_h, const size_t & iterations)
+{
+    return _EvaluateLatticeData(*this, beta, magnetic_h, iterations);
+}
+
+template <size_t L>
+Lattice2D Ising2DSmall<L>::Lattice() const
+{
+    Lattice2D lattice(L, vector<int>(L));
+    for (size_t i = 0; i != L; ++i)
+        for (size_t j = 0; j != L; ++j)
+            lattice[i][j] = 2 * _Bit(Row(i), j) - 1;
+    return lattice;
+}
+
+template <size_t L>
+string Ising2DSmall<L>::ShowRow(const size_t & row) const
+{
+    string result;
+    for (size_t j = 0; j != L; ++j)
+        result += to_string(2 * _Bit(Row(row), j) - 1) + " ";
+    return result;
+}
+
+template class Ising2DSmall<4>;
+template class Ising2DSmall<8>;
+template class Ising2DSmall<16>;
+template class Ising2DSmall<32>;
+
+ISING_NAMESPACE_END
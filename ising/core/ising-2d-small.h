@@ -0,0 +1,131 @@
+#ifndef ISING_CORE_ISING_2D_SMALL_H_
+#define ISING_CORE_ISING_2D_SMALL_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+
+ISING_NAMESPACE_BEGIN
+
+// 2D Ising model with periodic boundary condition and the size L * L fixed at compile time,
+//   for the small lattices where the loop overhead of `Ising2D` dominates.
+// The spins are packed into bits (1 for +1) row after row, so the whole lattice takes
+//   L^2 / 64 words (one for L = 8, and a quarter of one for L = 4). A row being swept and
+//   its two neighbor rows stay in registers, and `Analysis()` counts the bonds of a whole
+//   row with a popcount of the row against its rotation.
+// A row is swept site by site, and each flip changes the neighbors of the next site. The flip
+//   takes a branch at low temperatures, where nearly all the flips are rejected and the branch
+//   is predicted, and none at high temperatures (above about T = 2.75), where it is not.
+// It has the same interface as `Ising2D`, and gives the same results as `Ising2D_PBC`
+//   with the same random numbers. Instantiated for L = 4, 8, 16 and 32.
+template <size_t L>
+class Ising2DSmall
+{
+public:
+    static const size_t kNeighbors = 4;
+
+    Ising2DSmall() = default;
+    // `size` should be L, it is accepted for compatibility with `Ising2D`.
+    Ising2DSmall(const LatticeSize & size);
+    Ising2DSmall(const size_t & size);
+
+    // Initialize all the spins to be +1.
+    void Initialize();
+
+    // Sweep through the lattice once using Metropolis algorithm.
+    // Both use the pre-evaluated Metropolis function values.
+    void Sweep(const double & beta, const double & magnetic_h);
+    void Sweep(const ExpArray & exp_array);
+
+    // Calculate physical quantities.
+    Observable Analysis(const double & magnetic_h) const;
+
+    // A complete evaluation process. Should be initialized before!
+    // The blocked lattices and the correlations are measured along with the lattice if
+    //   `block_spin` and `correlation` are not null.
+    Observable Evaluate(const double & beta, const double & magnetic_h,
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1,
+        BlockSpinMeasurement * block_spin = nullptr,
+        CorrelationMeasurement * correlation = nullptr);
+
+    // For lattice data generating and convergence analysis.
+    LatticeInfo EvaluateLatticeData(const double & beta, const double & magnetic_h,
+        const size_t & iterations);
+
+    // The spins.
+    Lattice2D Lattice() const;
+    std::string ShowRow(const size_t & row) const;
+
+    // Number of spins.
+    size_t SiteCount() const { return L * L; }
+
+    // Performance counters since the last `Initialize()`.
+    const KernelCounters & Counters() const { return counters_; }
+
+private:
+    static_assert(L == 4 || L == 8 || L == 16 || L == 32, "L should be 4, 8, 16 or 32.");
+
+    typedef std::uint64_t Word;
+
+    static const size_t kWordBits = 64;
+    // A row never crosses two words since L divides 64.
+    static const size_t kWordCount = (L * L + kWordBits - 1) / kWordBits;
+    static const Word   kRowMask   = (Word(1) << L) - 1;
+
+    std::array<Word, kWordCount> words_;
+
+    KernelCounters counters_;
+
+    template <bool kBranchFree>
+    void SweepRows(const ExpArray & exp_array);
+
+    inline Word Row(const size_t & row) const
+    {
+        return (words_[row * L / kWordBits] >> (row * L % kWordBits)) & kRowMask;
+    }
+    inline void SetRow(const size_t & row, const Word & value)
+    {
+        auto & word = words_[row * L / kWordBits];
+        auto shift = row * L % kWordBits;
+        word = (word & ~(kRowMask << shift)) | (value << shift);
+    }
+    // Bit j of the result is bit (j - 1) (mod L) of `row`, i.e. the left neighbor.
+    static inline Word RotateLeft(const Word & row)
+    {
+        return ((row << 1) | (row >> (L - 1))) & kRowMask;
+    }
+};
+
+// Calls `runner.template Run<Lattice>()` with the periodic 2D engine of `size`: the
+//   `Ising2DSmall` of that size if there is one, otherwise `Ising2D_PBC`.
+template <typename Runner>
+void RunPeriodic2D(const size_t & size, Runner & runner)
+{
+    switch (size)
+    {
+    case 4:
+        runner.template Run<Ising2DSmall<4>>();
+        break;
+    case 8:
+        runner.template Run<Ising2DSmall<8>>();
+        break;
+    case 16:
+        runner.template Run<Ising2DSmall<16>>();
+        break;
+    case 32:
+        runner.template Run<Ising2DSmall<32>>();
+        break;
+    default:
+        runner.template Run<Ising2D_PBC>();
+    }
+}
+
+ISING_NAMESPACE_END
+
+#endif
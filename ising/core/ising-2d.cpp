@@ -6,8 +6,12 @@
 #include <string>
 #include <vector>
 
+#include "core/counters.h"
+#include "core/cpu-dispatch.h"
+#include "core/evaluate.h"
 #include "core/fast-rand.h"
 #include "core/ising.h"
+#include "core/metropolis.h"
 
 using namespace std;
 using namespace ising::toolkit;
@@ -20,224 +24,303 @@ inline double _MetropolisFunction(const double & energy, const double & beta)
     return boltzmann_probability < 1.0 ? boltzmann_probability : 1.0;
 }
 
+// Index of `ExpArray` (see "core/metropolis.h").
+inline int _ExpArrayIndex(const int & spin_sum, const int & spin_value)
+{
+    return _MetropolisIndex<4>(spin_sum, spin_value);
+}
+
 inline bool _IsFlip(const int & spin_sum, const int & spin_value,
     const double & magnetic_h, const double & beta)
 {
     auto energy_difference = 2 * (spin_sum + magnetic_h) * spin_value;
     auto flip_probability = _MetropolisFunction(energy_difference, beta);
-    return (static_cast<double>(FastRand()) / RAND_MAX) < flip_probability;
+    return FastRandUniform() < flip_probability;
+}
+
+string BoundaryConditionName(const BoundaryCondition & boundary_condition)
+{
+    switch (boundary_condition)
+    {
+    case kFree:
+        return "Free";
+    case kAntiperiodic:
+        return "Antiperiodic";
+    default:
+        return "Periodic";
+    }
+}
+
+// Row kernels over `count` interior sites, whose nearest sites are inside the lattice
+//   (or the zero padding) for any boundary condition, so no `NearestSum()` is needed.
+// `up`, `row` and `down` point to the first of these sites in three successive rows.
+// They are compiled for each instruction set, see "core/cpu-dispatch.h".
+template <typename Spin>
+struct RowKernels
+{
+    typedef void (*SweepRow)(const Spin *, Spin *, const Spin *, const size_t &,
+        const ExpArray &, KernelCounters &);
+    typedef void (*AnalysisRow)(const Spin *, const Spin *, const Spin *, const size_t &,
+        long long &, long long &);
+};
+
+template <typename Spin>
+ISING_ALWAYS_INLINE void _SweepRow(const Spin * up, Spin * row, const Spin * down,
+    const size_t & count, const ExpArray & exp_array, KernelCounters & counters)
+{
+    for (size_t j = 0; j != count; ++j)
+        _MetropolisStep(row[j], row[j - 1] + row[j + 1] + up[j] + down[j], exp_array, counters);
+}
+
+// Sum of spins and sum of (spin * nearest sum).
+template <typename Spin>
+ISING_ALWAYS_INLINE void _AnalysisRow(const Spin * up, const Spin * row, const Spin * down,
+    const size_t & count, long long & spin_total, long long & energy_total)
+{
+    int spin_sum = 0, energy_sum = 0;
+    for (size_t j = 0; j != count; ++j)
+    {
+        spin_sum   += row[j];
+        energy_sum += row[j] * (row[j - 1] + row[j + 1] + up[j] + down[j]);
+    }
+    spin_total   += spin_sum;
+    energy_total += energy_sum;
+}
+
+template <typename Spin>
+ISING_TARGET_SSE2 void _SweepRowSse2(const Spin * up, Spin * row, const Spin * down,
+    const size_t & count, const ExpArray & exp_array, KernelCounters & counters)
+{
+    _SweepRow(up, row, down, count, exp_array, counters);
+}
+
+template <typename Spin>
+ISING_TARGET_AVX2 void _SweepRowAvx2(const Spin * up, Spin * row, const Spin * down,
+    const size_t & count, const ExpArray & exp_array, KernelCounters & counters)
+{
+    _SweepRow(up, row, down, count, exp_array, counters);
 }
 
-Ising2D::Ising2D(const size_t & size) : Ising2D(size, size) {}
+template <typename Spin>
+ISING_TARGET_AVX512 void _SweepRowAvx512(const Spin * up, Spin * row, const Spin * down,
+    const size_t & count, const ExpArray & exp_array, KernelCounters & counters)
+{
+    _SweepRow(up, row, down, count, exp_array, counters);
+}
+
+template <typename Spin>
+ISING_TARGET_SSE2 void _AnalysisRowSse2(const Spin * up, const Spin * row, const Spin * down,
+    const size_t & count, long long & spin_total, long long & energy_total)
+{
+    _AnalysisRow(up, row, down, count, spin_total, energy_total);
+}
+
+template <typename Spin>
+ISING_TARGET_AVX2 void _AnalysisRowAvx2(const Spin * up, const Spin * row, const Spin * down,
+    const size_t & count, long long & spin_total, long long & energy_total)
+{
+    _AnalysisRow(up, row, down, count, spin_total, energy_total);
+}
+
+template <typename Spin>
+ISING_TARGET_AVX512 void _AnalysisRowAvx512(const Spin * up, const Spin * row, const Spin * down,
+    const size_t & count, long long & spin_total, long long & energy_total)
+{
+    _AnalysisRow(up, row, down, count, spin_total, energy_total);
+}
+
+template <typename Spin>
+typename RowKernels<Spin>::SweepRow _SelectSweepRow()
+{
+    switch (ActiveCpuPath())
+    {
+    case kCpuAvx512:
+        return _SweepRowAvx512<Spin>;
+    case kCpuAvx2:
+        return _SweepRowAvx2<Spin>;
+    default:
+        return _SweepRowSse2<Spin>;
+    }
+}
+
+template <typename Spin>
+typename RowKernels<Spin>::AnalysisRow _SelectAnalysisRow()
+{
+    switch (ActiveCpuPath())
+    {
+    case kCpuAvx512:
+        return _AnalysisRowAvx512<Spin>;
+    case kCpuAvx2:
+        return _AnalysisRowAvx2<Spin>;
+    default:
+        return _AnalysisRowSse2<Spin>;
+    }
+}
 
-Ising2D::Ising2D(const size_t & x_size, const size_t & y_size) :
+template <typename Boundary, typename Spin>
+Ising2D<Boundary, Spin>::Ising2D(const size_t & size) : Ising2D(size, size) {}
+
+template <typename Boundary, typename Spin>
+Ising2D<Boundary, Spin>::Ising2D(const size_t & x_size, const size_t & y_size) :
     x_size_(x_size), y_size_(y_size) {}
 
-Ising2D::Ising2D(const LatticeSize & size) : Ising2D(size.x, size.y) {}
+template <typename Boundary, typename Spin>
+Ising2D<Boundary, Spin>::Ising2D(const LatticeSize & size) : Ising2D(size.x, size.y) {}
 
-void Ising2D::Sweep(const double & beta, const double & magnetic_h)
+template <typename Boundary, typename Spin>
+void Ising2D<Boundary, Spin>::Initialize()
 {
-    for (size_t i = x_begin_index_; i != x_end_index_; ++i)
-        for (size_t j = y_begin_index_; j != y_end_index_; ++j)
+    counters_ = KernelCounters(ExpArray().size());
+    // Add zero padding (if any) to the original lattice.
+    lattice_.assign(x_size_ + 2 * kPadding, vector<Spin>(y_size_ + 2 * kPadding, 0));
+    for (size_t i = kPadding; i != x_size_ + kPadding; ++i)
+        for (size_t j = kPadding; j != y_size_ + kPadding; ++j)
+            lattice_[i][j] = 1;
+}
+
+template <typename Boundary, typename Spin>
+void Ising2D<Boundary, Spin>::Sweep(const double & beta, const double & magnetic_h)
+{
+    for (size_t i = kPadding; i != x_size_ + kPadding; ++i)
+        for (size_t j = kPadding; j != y_size_ + kPadding; ++j)
         {
             auto & spin = lattice_[i][j];
             auto spin_sum = NearestSum(i, j);
+            ISING_COUNT(auto class_index = _ExpArrayIndex(spin_sum, spin));
+            ISING_COUNT(counters_.attempted_by_class[class_index] += 1);
             if (_IsFlip(spin_sum, spin, magnetic_h, beta))
-                spin *= -1;
+            {
+                spin = -spin;
+                ISING_COUNT(counters_.accepted_by_class[class_index] += 1);
+            }
         }
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += x_size_ * y_size_);
 }
 
-void Ising2D::Sweep(const ExpArray & exp_array)
+template <typename Boundary, typename Spin>
+void Ising2D<Boundary, Spin>::Sweep(const ExpArray & exp_array)
 {
     // For Ising model, the spin and nearest sum can only take a limited number 
     // of values. So it's unnecessary to evaluate the `exp()` every time. We
     // evaluate the values previously and put them into `exp_array`.
-    for (size_t i = x_begin_index_; i != x_end_index_; ++i)
-        for (size_t j = y_begin_index_; j != y_end_index_; ++j)
+    // The sites are visited in the same order as a plain double loop: the first and last
+    // rows and columns go through the boundary condition, and the interior of the other
+    // rows uses the row kernel.
+    const size_t kBegin = kPadding;
+    const size_t kXEnd  = x_size_ + kPadding;
+    const size_t kYEnd  = y_size_ + kPadding;
+    auto sweep_row = _SelectSweepRow<Spin>();
+    for (size_t i = kBegin; i != kXEnd; ++i)
+    {
+        if (i == kBegin || i + 1 == kXEnd || y_size_ < 3)
         {
-            auto & spin = lattice_[i][j];
-            auto spin_sum = NearestSum(i, j);
-            // For the map:
-            // spin           spin_sum           ->            index
-            //  +1    -4 -3 -2 -1 0 +1 +2 +3 +4  ->  0  1  2  3  4  5  6  7  8
-            //  -1    -4 -3 -2 -1 0 +1 +2 +3 +4  ->  9 10 11 12 13 14 15 16 17
-            auto exp_array_index = spin_sum + 4 - 9 * (spin - 1) / 2;
-            auto flip_probability = exp_array[exp_array_index];
-            if (static_cast<double>(FastRand()) / RAND_MAX < flip_probability)
-                spin *= -1;
+            for (size_t j = kBegin; j != kYEnd; ++j)
+                _MetropolisStep(lattice_[i][j], NearestSum(i, j), exp_array, counters_);
+            continue;
         }
+        auto first = kBegin, last = kYEnd - 1;
+        _MetropolisStep(lattice_[i][first], NearestSum(i, first), exp_array, counters_);
+        sweep_row(&lattice_[i - 1][first + 1], &lattice_[i][first + 1], &lattice_[i + 1][first + 1],
+            y_size_ - 2, exp_array, counters_);
+        _MetropolisStep(lattice_[i][last], NearestSum(i, last), exp_array, counters_);
+    }
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += x_size_ * y_size_);
 }
 
-Observable Ising2D::Analysis(const double & magnetic_h) const
+template <typename Boundary, typename Spin>
+Observable Ising2D<Boundary, Spin>::Analysis(const double & magnetic_h) const
 {
-    Observable observable;
-    for (size_t i = x_begin_index_; i != x_end_index_; ++i)
-        for (size_t j = y_begin_index_; j != y_end_index_; ++j)
+    // Same partition into boundary sites and row interiors as `Sweep()`.
+    const size_t kBegin = kPadding;
+    const size_t kXEnd  = x_size_ + kPadding;
+    const size_t kYEnd  = y_size_ + kPadding;
+    auto analysis_row = _SelectAnalysisRow<Spin>();
+    long long spin_total = 0, energy_total = 0;
+    for (size_t i = kBegin; i != kXEnd; ++i)
+    {
+        if (i == kBegin || i + 1 == kXEnd || y_size_ < 3)
         {
-            auto spin = lattice_[i][j];
-            auto spin_sum = NearestSum(i, j);
-            observable.magnetic_dipole += spin;
-            observable.energy          -= (spin_sum + magnetic_h) * spin;
+            for (size_t j = kBegin; j != kYEnd; ++j)
+            {
+                spin_total   += lattice_[i][j];
+                energy_total += lattice_[i][j] * NearestSum(i, j);
+            }
+            continue;
         }
+        auto first = kBegin, last = kYEnd - 1;
+        spin_total   += lattice_[i][first] + lattice_[i][last];
+        energy_total += lattice_[i][first] * NearestSum(i, first)
+                      + lattice_[i][last]  * NearestSum(i, last);
+        analysis_row(&lattice_[i - 1][first + 1], &lattice_[i][first + 1], &lattice_[i + 1][first + 1],
+            y_size_ - 2, spin_total, energy_total);
+    }
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -static_cast<double>(energy_total) - magnetic_h * spin_total;
     auto scale = static_cast<double>(x_size_ * y_size_);
     observable.magnetic_dipole /= scale;
     observable.energy          /= scale;
     observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
     observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
     observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
     return observable;
 }
 
-Observable Ising2D::Evaluate(const double & beta, const double & magnetic_h,
-    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta)
+template <typename Boundary, typename Spin>
+Observable Ising2D<Boundary, Spin>::Evaluate(const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
 {
-#ifdef ISING_FAST_EXP
-    auto exp_array = InitializeExpArray(beta, magnetic_h);
-#endif
-
-    // Sweep.
-    for (size_t i = 0; i != iterations - n_ensemble; ++i)
-#ifdef ISING_FAST_EXP
-        Sweep(exp_array);
-#else
-        Sweep(beta, magnetic_h);
-#endif
-
-    // Sweep and analysis.
-    // `n_delta` is used to avoid correlation between successive configurations.
-    size_t count = 0;
-    Observable observable;
-    for (size_t i = iterations - n_ensemble - 1; i != iterations; ++i)
-    {
-#ifdef ISING_FAST_EXP
-        Sweep(exp_array);
-#else
-        Sweep(beta, magnetic_h);
-#endif
-        if (count == n_delta)
-        {
-            observable += Analysis(magnetic_h);
-            count = 0;
-        }
-        count += 1;
-    }
-    // Normalize.
-    return observable / static_cast<double>(n_ensemble / n_delta);
+    return _Evaluate(*this, counters_, beta, magnetic_h, iterations, n_ensemble, n_delta,
+        block_spin, correlation);
 }
 
-LatticeInfo Ising2D::EvaluateLatticeData(const double & beta, const double & magnetic_h,
-    const size_t & iterations)
+template <typename Boundary, typename Spin>
+LatticeInfo Ising2D<Boundary, Spin>::EvaluateLatticeData(const double & beta,
+    const double & magnetic_h, const size_t & iterations)
 {
-#ifdef ISING_FAST_EXP
-    auto exp_array = InitializeExpArray(beta, magnetic_h);
-#endif
-    vector<Observable> result;
-    for (size_t i = 0; i != iterations; ++i)
-    {
-#ifdef ISING_FAST_EXP
-        Sweep(exp_array);
-#else
-        Sweep(beta, magnetic_h);
-#endif
-        result.push_back(Analysis(magnetic_h));
-    }
-    return { lattice_, result };
+    return _EvaluateLatticeData(*this, beta, magnetic_h, iterations);
 }
 
-/*
-vector<int> Ising2D::Renormalize(const size_t & x_scale, const size_t & y_scale)
+template <typename Boundary, typename Spin>
+Lattice2D Ising2D<Boundary, Spin>::Lattice() const
 {
-    size_t x_size_renormalized = x_size_ / x_scale;
-    size_t y_size_renormalized = y_size_ / y_scale;
-
-    vector<int> result;
-    result.resize(x_size_renormalized * y_size_renormalized);
-
-    vector<vector<int>> local_lattice;
-    local_lattice.resize(x_scale);
-    for (auto i = local_lattice.begin(); i != local_lattice.end(); ++i)
-        i->resize(y_scale);
-
-    for (auto i = 0; i != x_size_renormalized; ++i)
-        for (auto j = 0; j != y_size_renormalized; ++j)
-        {
-            vector<int> local_lattice;
-            local_lattice.resize(x_scale * y_scale);
-            for (auto k = 0; k != x_scale; ++k)
-                for (auto l = 0; l != y_scale; ++l)
-                    // Use "+1" to skip the boundary.
-                    local_lattice[y_scale * k + l]
-                    = lattice_[x_scale * i + k + 1][y_scale * j + l + 1];
-
-            for (auto t = 0; t != x_scale * y_scale; ++t)
-                result[y_size_renormalized * i + j]
-                += (local_lattice[t] + 1) / 2 * static_cast<int>(pow(2, t));
-        }
-
-    return result;
+    Lattice2D lattice(x_size_, vector<int>(y_size_));
+    for (size_t i = 0; i != x_size_; ++i)
+        for (size_t j = 0; j != y_size_; ++j)
+            lattice[i][j] = lattice_[i + kPadding][j + kPadding];
+    return lattice;
 }
-*/
 
-void Ising2D::Show() const
+template <typename Boundary, typename Spin>
+void Ising2D<Boundary, Spin>::Show() const
 {
     for (auto i = lattice_.begin(); i != lattice_.end(); ++i)
     {
         for (auto j = i->begin(); j != i->end(); ++j)
-            cout << *j << " ";
+            cout << static_cast<int>(*j) << " ";
         cout << endl;
     }
 }
 
-string Ising2D::ShowRow(const size_t & row) const
+template <typename Boundary, typename Spin>
+string Ising2D<Boundary, Spin>::ShowRow(const size_t & row) const
 {
     string result;
     for (auto i : lattice_[row])
-        result += to_string(i) + " ";
+        result += to_string(static_cast<int>(i)) + " ";
     return result;
 }
 
-Ising2D_PBC::Ising2D_PBC(const LatticeSize & size) : Ising2D_PBC(size.x, size.y) {}
-Ising2D_PBC::Ising2D_PBC(const size_t & size) : Ising2D_PBC(size, size) {}
-Ising2D_PBC::Ising2D_PBC(const size_t & x_size, const size_t & y_size) :
-    Ising2D(x_size, y_size)
-{
-    x_begin_index_ = 0;
-    y_begin_index_ = 0;
-    x_end_index_ = x_size;
-    y_end_index_ = y_size;
-}
-
-Ising2D_FBC::Ising2D_FBC(const LatticeSize & size) : Ising2D_FBC(size.x, size.y) {}
-Ising2D_FBC::Ising2D_FBC(const size_t & size) : Ising2D_FBC(size, size) {}
-Ising2D_FBC::Ising2D_FBC(const size_t & x_size, const size_t & y_size) :
-    Ising2D(x_size, y_size)
-{
-    x_begin_index_ = 1;
-    y_begin_index_ = 1;
-    x_end_index_ = x_size + 1;
-    y_end_index_ = y_size + 1;
-}
-
-void Ising2D_PBC::Initialize()
-{
-    lattice_.resize(x_size_);
-    for (size_t i = 0; i != x_size_; ++i)
-    {
-        lattice_[i].resize(y_size_);
-        for (size_t j = 0; j != y_size_; ++j)
-            lattice_[i][j] = 1;
-    }
-}
-
-void Ising2D_FBC::Initialize()
-{
-    // Add zero padding to the original lattice.
-    lattice_.resize(x_size_ + 2);
-    for (auto i = lattice_.begin(); i != lattice_.end(); ++i)
-        i->resize(y_size_ + 2);
-    for (size_t i = 1; i != x_size_ + 1; ++i)
-        for (size_t j = 1; j != y_size_ + 1; ++j)
-            lattice_[i][j] = 1;
-}
+template class Ising2D<PeriodicBoundary, int>;
+template class Ising2D<FreeBoundary, int>;
+template class Ising2D<AntiperiodicBoundary, int>;
+template class Ising2D<PeriodicBoundary, signed char>;
+template class Ising2D<FreeBoundary, signed char>;
+template class Ising2D<AntiperiodicBoundary, signed char>;
 
 ISING_NAMESPACE_END
@@ -1,27 +1,92 @@
 #ifndef ISING_CORE_ISING_2D_H_
 #define ISING_CORE_ISING_2D_H_
 
-#include <cmath>
 #include <iostream>
 #include <string>
 #include <vector>
 
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
 #include "core/ising.h"
+#include "core/metropolis.h"
 
 ISING_NAMESPACE_BEGIN
 
-// Abstract base class for general 2D Ising model.
-// May not be used directly.
+// Pre-evaluate the Metropolis function values (`exp()`).
+inline ExpArray InitializeExpArray(const double & beta, const double & magnetic_h)
+{
+    return InitializeMetropolisTable<4>(beta, magnetic_h);
+}
+
+// Boundary condition policies of `Ising2D`.
+// `kPadding` is the width of the zero padding around the lattice, and `NearestSum()`
+//   sums over the nearest spins of the site (x, y), where x and y include the padding.
+// They are resolved at compile time, so `NearestSum()` is inlined into the sweep.
+
+// Periodic in both directions.
+struct PeriodicBoundary
+{
+    static const size_t kPadding = 0;
+    static const BoundaryCondition kType = kPeriodic;
+
+    template <typename Lattice>
+    static inline int NearestSum(const Lattice & lattice, const size_t & x, const size_t & y,
+        const size_t & x_size, const size_t & y_size)
+    {
+        return lattice[x][y == 0 ? y_size - 1 : y - 1] + lattice[x][y == y_size - 1 ? 0 : y + 1]
+             + lattice[x == 0 ? x_size - 1 : x - 1][y] + lattice[x == x_size - 1 ? 0 : x + 1][y];
+    }
+};
+
+// Free boundary, i.e. the spins outside are zero.
+struct FreeBoundary
+{
+    static const size_t kPadding = 1;
+    static const BoundaryCondition kType = kFree;
+
+    template <typename Lattice>
+    static inline int NearestSum(const Lattice & lattice, const size_t & x, const size_t & y,
+        const size_t &, const size_t &)
+    {
+        return lattice[x][y - 1] + lattice[x][y + 1]
+             + lattice[x - 1][y] + lattice[x + 1][y];
+    }
+};
+
+// Periodic in y and antiperiodic in x, i.e. the bonds across the x boundary are
+//   antiferromagnetic. It forces an interface into the ordered phase.
+struct AntiperiodicBoundary
+{
+    static const size_t kPadding = 0;
+    static const BoundaryCondition kType = kAntiperiodic;
+
+    template <typename Lattice>
+    static inline int NearestSum(const Lattice & lattice, const size_t & x, const size_t & y,
+        const size_t & x_size, const size_t & y_size)
+    {
+        return lattice[x][y == 0 ? y_size - 1 : y - 1] + lattice[x][y == y_size - 1 ? 0 : y + 1]
+             + (x == 0 ? -lattice[x_size - 1][y] : lattice[x - 1][y])
+             + (x == x_size - 1 ? -lattice[0][y] : lattice[x + 1][y]);
+    }
+};
+
+// 2D Ising model with the boundary condition `Boundary` (see above).
+// `Spin` is the storage type of a spin, e.g. `signed char` for large lattices.
+// Instantiated for all the boundary conditions above with `int` and `signed char`.
+template <typename Boundary, typename Spin = int>
 class Ising2D
 {
 public:
+    static const size_t kNeighbors = 4;
+
     Ising2D() = default;
     Ising2D(const LatticeSize & size);
     Ising2D(const size_t & size);
     Ising2D(const size_t & x_size, const size_t & y_size);
 
     // Initialize all the spins to be +1.
-    virtual void Initialize() = 0;
+    void Initialize();
 
     // Sweep through the lattice once using Metropolis algorithm.
     void Sweep(const double & beta, const double & magnetic_h);
@@ -31,112 +96,55 @@ public:
     Observable Analysis(const double & magnetic_h) const;
 
     // A complete evaluation process. Should be initialized before!
+    // The blocked lattices and the correlations are measured along with the lattice if
+    //   `block_spin` and `correlation` are not null.
     Observable Evaluate(const double & beta, const double & magnetic_h,
-        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1);
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1,
+        BlockSpinMeasurement * block_spin = nullptr,
+        CorrelationMeasurement * correlation = nullptr);
 
     // For lattice data generating and convergence analysis.
     LatticeInfo EvaluateLatticeData(const double & beta, const double & magnetic_h,
         const size_t & iterations);
 
-    // Reshape the lattice to be a 1D vector.
-    // std::vector<int> Renormalize(const size_t & x_scale, const size_t & y_scale);
+    // The spins (excluding zero padding).
+    Lattice2D Lattice() const;
 
     // Show lattice (including zero padding if existing).
     void Show() const;
     std::string ShowRow(const size_t & row) const;
 
-protected:
-    const size_t x_size_;
-    const size_t y_size_;
-
-    // Used for loops concerning boundary conditions.
-    // They cannot be initialized directly. Use non-const type to be set value afterwards.
-    size_t x_begin_index_;
-    size_t x_end_index_;
-    size_t y_begin_index_;
-    size_t y_end_index_;
+    // Number of spins.
+    size_t SiteCount() const { return x_size_ * y_size_; }
 
-    Lattice2D lattice_;
-
-    // Sum over the nearest spins.
-    // It's pure virtual because of the different boundary conditions.
-    virtual int NearestSum(const size_t & x, const size_t & y) const = 0;
+    // Performance counters since the last `Initialize()`.
+    const KernelCounters & Counters() const { return counters_; }
 
 private:
-    // Pre-evaluate the Metropolis function values (`exp()`).
-    inline ExpArray InitializeExpArray(const double & beta, const double & magnetic_h)
-    {
-        ExpArray exp_array =
-        {
-            // spin = +1
-            std::exp(-2 * beta * (-4.0 + magnetic_h)),
-            std::exp(-2 * beta * (-3.0 + magnetic_h)),
-            std::exp(-2 * beta * (-2.0 + magnetic_h)),
-            std::exp(-2 * beta * (-1.0 + magnetic_h)),
-            std::exp(-2 * beta * ( 0.0 + magnetic_h)),
-            std::exp(-2 * beta * ( 1.0 + magnetic_h)),
-            std::exp(-2 * beta * ( 2.0 + magnetic_h)),
-            std::exp(-2 * beta * ( 3.0 + magnetic_h)),
-            std::exp(-2 * beta * ( 4.0 + magnetic_h)),
-            // spin = -1
-            std::exp( 2 * beta * (-4.0 + magnetic_h)),
-            std::exp( 2 * beta * (-3.0 + magnetic_h)),
-            std::exp( 2 * beta * (-2.0 + magnetic_h)),
-            std::exp( 2 * beta * (-1.0 + magnetic_h)),
-            std::exp( 2 * beta * ( 0.0 + magnetic_h)),
-            std::exp( 2 * beta * ( 1.0 + magnetic_h)),
-            std::exp( 2 * beta * ( 2.0 + magnetic_h)),
-            std::exp( 2 * beta * ( 3.0 + magnetic_h)),
-            std::exp( 2 * beta * ( 4.0 + magnetic_h))
-        };
-        for (auto & i : exp_array)
-            i = i < 1.0 ? i : 1.0;
-        return exp_array;
-    }
-};
+    static const size_t kPadding = Boundary::kPadding;
 
-// 2D Ising model with periodic boundary condition.
-class Ising2D_PBC : public Ising2D
-{
-public:
-    using Ising2D::Ising2D;
-    Ising2D_PBC(const LatticeSize & size);
-    Ising2D_PBC(const size_t & size);
-    Ising2D_PBC(const size_t & x_size, const size_t & y_size);
+    const size_t x_size_;
+    const size_t y_size_;
 
-    void Initialize() override;
+    std::vector<std::vector<Spin>> lattice_;
 
-private:
-    inline size_t XPlusOne (const size_t & x) const { return (x == x_size_ - 1 ? 0 : x + 1); }
-    inline size_t XMinusOne(const size_t & x) const { return (x == 0 ? x_size_ - 1 : x - 1); }
-    inline size_t YPlusOne (const size_t & y) const { return (y == y_size_ - 1 ? 0 : y + 1); }
-    inline size_t YMinusOne(const size_t & y) const { return (y == 0 ? y_size_ - 1 : y - 1); }
+    KernelCounters counters_;
 
-    inline int NearestSum(const size_t & x, const size_t & y) const override
+    // Sum over the nearest spins (indices including zero padding).
+    inline int NearestSum(const size_t & x, const size_t & y) const
     {
-        return lattice_[x][YMinusOne(y)] + lattice_[x][YPlusOne(y)]
-             + lattice_[XMinusOne(x)][y] + lattice_[XPlusOne(x)][y];
+        return Boundary::NearestSum(lattice_, x, y, x_size_, y_size_);
     }
 };
 
+// 2D Ising model with periodic boundary condition.
+typedef Ising2D<PeriodicBoundary>     Ising2D_PBC;
 // 2D Ising model with free boundary condition (with zero padding).
-class Ising2D_FBC : public Ising2D
-{
-public:
-    using Ising2D::Ising2D;
-    Ising2D_FBC(const LatticeSize & size);
-    Ising2D_FBC(const size_t & size);
-    Ising2D_FBC(const size_t & x_size, const size_t & y_size);
+typedef Ising2D<FreeBoundary>         Ising2D_FBC;
+// 2D Ising model with antiperiodic boundary condition in x.
+typedef Ising2D<AntiperiodicBoundary> Ising2D_APBC;
 
-    void Initialize() override;
-
-private:
-    inline int NearestSum(const size_t & x, const size_t & y) const override
-    {
-        return lattice_[x][y - 1] + lattice_[x][y + 1]
-             + lattice_[x - 1][y] + lattice_[x + 1][y];
-    }
-};
+std::string BoundaryConditionName(const BoundaryCondition & boundary_condition);
 
 ISING_NAMESPACE_END
 
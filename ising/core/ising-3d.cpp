@@ -0,0 +1,225 @@
+#include "core/ising-3d.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "core/counters.h"
+#include "core/cpu-dispatch.h"
+#include "core/evaluate.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+#include "core/metropolis.h"
+
+using namespace std;
+using namespace ising::toolkit;
+
+ISING_NAMESPACE_BEGIN
+
+// Sweep the sites `first`, `first + 2`, ... of a row along z.
+// `x_prev`, `x_next`, `y_prev` and `y_next` point to the four neighbor rows.
+// The random numbers make the sweep sequential, so it is not dispatched by instruction set.
+template <typename Spin>
+ISING_ALWAYS_INLINE void _SweepRow3D(Spin * row,
+    const Spin * x_prev, const Spin * x_next, const Spin * y_prev, const Spin * y_next,
+    const size_t & first, const size_t & size, const ExpArray3D & exp_array,
+    KernelCounters & counters)
+{
+    auto plane_sum = [&](const size_t & z)
+    {
+        return x_prev[z] + x_next[z] + y_prev[z] + y_next[z];
+    };
+    auto wrapped_sum = [&](const size_t & z)
+    {
+        return plane_sum(z) + row[z == 0 ? size - 1 : z - 1] + row[z + 1 == size ? 0 : z + 1];
+    };
+
+    auto z = first;
+    if (z == 0)
+    {
+        _MetropolisStep(row[0], wrapped_sum(0), exp_array, counters);
+        z = 2;
+    }
+    for (; z + 1 < size; z += 2)
+        _MetropolisStep(row[z], plane_sum(z) + row[z - 1] + row[z + 1], exp_array, counters);
+    if (z + 1 == size)
+        _MetropolisStep(row[z], wrapped_sum(z), exp_array, counters);
+}
+
+// Sum of spins and sum of (spin * forward nearest sum), i.e. the bonds to +x, +y and +z.
+template <typename Spin>
+ISING_ALWAYS_INLINE void _AnalysisRow3D(const Spin * row, const Spin * x_next, const Spin * y_next,
+    const size_t & size, long long & spin_total, long long & bond_total)
+{
+    int spin_sum = 0, bond_sum = 0;
+    for (size_t z = 0; z + 1 < size; ++z)
+    {
+        spin_sum += row[z];
+        bond_sum += row[z] * (x_next[z] + y_next[z] + row[z + 1]);
+    }
+    auto last = size - 1;
+    spin_sum += row[last];
+    bond_sum += row[last] * (x_next[last] + y_next[last] + row[0]);
+    spin_total += spin_sum;
+    bond_total += bond_sum;
+}
+
+template <typename Spin>
+ISING_TARGET_SSE2 void _AnalysisRow3DSse2(const Spin * row, const Spin * x_next,
+    const Spin * y_next, const size_t & size, long long & spin_total, long long & bond_total)
+{
+    _AnalysisRow3D(row, x_next, y_next, size, spin_total, bond_total);
+}
+
+template <typename Spin>
+ISING_TARGET_AVX2 void _AnalysisRow3DAvx2(const Spin * row, const Spin * x_next,
+    const Spin * y_next, const size_t & size, long long & spin_total, long long & bond_total)
+{
+    _AnalysisRow3D(row, x_next, y_next, size, spin_total, bond_total);
+}
+
+template <typename Spin>
+ISING_TARGET_AVX512 void _AnalysisRow3DAvx512(const Spin * row, const Spin * x_next,
+    const Spin * y_next, const size_t & size, long long & spin_total, long long & bond_total)
+{
+    _AnalysisRow3D(row, x_next, y_next, size, spin_total, bond_total);
+}
+
+template <typename Spin>
+using AnalysisRow3D = void (*)(const Spin *, const Spin *, const Spin *, const size_t &,
+    long long &, long long &);
+
+template <typename Spin>
+AnalysisRow3D<Spin> _SelectAnalysisRow3D()
+{
+    switch (ActiveCpuPath())
+    {
+    case kCpuAvx512:
+        return _AnalysisRow3DAvx512<Spin>;
+    case kCpuAvx2:
+        return _AnalysisRow3DAvx2<Spin>;
+    default:
+        return _AnalysisRow3DSse2<Spin>;
+    }
+}
+
+template <typename Spin>
+Ising3D<Spin>::Ising3D(const size_t & size) : size_(size) {}
+
+template <typename Spin>
+Ising3D<Spin>::Ising3D(const LatticeSize & size) : Ising3D(size.x) {}
+
+template <typename Spin>
+void Ising3D<Spin>::Initialize()
+{
+    counters_ = KernelCounters(ExpArray3D().size());
+    lattice_.assign(size_ * size_ * size_, 1);
+}
+
+template <typename Spin>
+void Ising3D<Spin>::Sweep(const double & beta, const double & magnetic_h)
+{
+    Sweep(InitializeMetropolisTable<kNeighbors>(beta, magnetic_h));
+}
+
+template <typename Spin>
+void Ising3D<Spin>::Sweep(const ExpArray3D & exp_array)
+{
+    for (size_t parity = 0; parity != 2; ++parity)
+        for (size_t x = 0; x != size_; ++x)
+        {
+            auto x_prev = x == 0 ? size_ - 1 : x - 1;
+            auto x_next = x == size_ - 1 ? 0 : x + 1;
+            for (size_t y = 0; y != size_; ++y)
+            {
+                auto y_prev = y == 0 ? size_ - 1 : y - 1;
+                auto y_next = y == size_ - 1 ? 0 : y + 1;
+                _SweepRow3D(&lattice_[Index(x, y, 0)],
+                    &lattice_[Index(x_prev, y, 0)], &lattice_[Index(x_next, y, 0)],
+                    &lattice_[Index(x, y_prev, 0)], &lattice_[Index(x, y_next, 0)],
+                    (x + y + parity) % 2, size_, exp_array, counters_);
+            }
+        }
+    ISING_COUNT(counters_.sweeps += 1);
+    ISING_COUNT(counters_.rand_draws += lattice_.size());
+}
+
+template <typename Spin>
+Observable Ising3D<Spin>::Analysis(const double & magnetic_h) const
+{
+    auto analysis_row = _SelectAnalysisRow3D<Spin>();
+    long long spin_total = 0, bond_total = 0;
+    for (size_t x = 0; x != size_; ++x)
+    {
+        auto x_next = x == size_ - 1 ? 0 : x + 1;
+        for (size_t y = 0; y != size_; ++y)
+        {
+            auto y_next = y == size_ - 1 ? 0 : y + 1;
+            analysis_row(&lattice_[Index(x, y, 0)], &lattice_[Index(x_next, y, 0)],
+                &lattice_[Index(x, y_next, 0)], size_, spin_total, bond_total);
+        }
+    }
+    // Sum of (spin * nearest sum) counts each bond twice, as in `Ising2D::Analysis()`.
+    auto energy_total = 2 * bond_total;
+
+    Observable observable;
+    observable.magnetic_dipole = static_cast<double>(spin_total);
+    observable.energy          = -static_cast<double>(energy_total) - magnetic_h * spin_total;
+    auto scale = static_cast<double>(lattice_.size());
+    observable.magnetic_dipole /= scale;
+    observable.energy          /= scale;
+    observable.magnetic_dipole_abs    = abs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    return observable;
+}
+
+template <typename Spin>
+Observable Ising3D<Spin>::Evaluate(const double & beta, const double & magnetic_h,
+    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+    BlockSpinMeasurement * block_spin, CorrelationMeasurement * correlation)
+{
+    return _Evaluate(*this, counters_, beta, magnetic_h, iterations, n_ensemble, n_delta,
+        block_spin, correlation);
+}
+
+template <typename Spin>
+LatticeInfo Ising3D<Spin>::EvaluateLatticeData(const double & beta,
+    const double & magnetic_h, const size_t & iterations)
+{
+    return _EvaluateLatticeData(*this, beta, magnetic_h, iterations);
+}
+
+template <typename Spin>
+Lattice2D Ising3D<Spin>::Lattice() const
+{
+    Lattice2D lattice(size_ * size_, vector<int>(size_));
+    for (size_t i = 0; i != size_ * size_; ++i)
+        for (size_t z = 0; z != size_; ++z)
+            lattice[i][z] = lattice_[i * size_ + z];
+    return lattice;
+}
+
+template <typename Spin>
+void Ising3D<Spin>::Show() const
+{
+    for (size_t i = 0; i != size_ * size_; ++i)
+        cout << ShowRow(i) << endl;
+}
+
+template <typename Spin>
+string Ising3D<Spin>::ShowRow(const size_t & row) const
+{
+    string result;
+    for (size_t z = 0; z != size_; ++z)
+        result += to_string(static_cast<int>(lattice_[row * size_ + z])) + " ";
+    return result;
+}
+
+template class Ising3D<int>;
+template class Ising3D<signed char>;
+
+ISING_NAMESPACE_END
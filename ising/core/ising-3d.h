@@ -0,0 +1,83 @@
+#ifndef ISING_CORE_ISING_3D_H_
+#define ISING_CORE_ISING_3D_H_
+
+#include <string>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
+#include "core/ising.h"
+#include "core/metropolis.h"
+
+ISING_NAMESPACE_BEGIN
+
+// 3D Ising model on an L * L * L cubic lattice with periodic boundary condition.
+// The spins are stored in a flat array (x, y, z with z the fastest), so a 256^3 lattice
+//   takes 16 MB with the default `signed char` spins.
+// The sweep is a checkerboard update: the sites with (x + y + z) even first and then the
+//   odd ones, so each half sweep only reads the other sublattice (for even L). The
+//   Metropolis step, the random numbers and the counters are shared with `Ising2D`, see
+//   "core/metropolis.h".
+// It has the same interface as `Ising2D`. Instantiated with `int` and `signed char`.
+template <typename Spin = signed char>
+class Ising3D
+{
+public:
+    static const size_t kNeighbors = 6;
+
+    Ising3D() = default;
+    Ising3D(const LatticeSize & size);
+    Ising3D(const size_t & size);
+
+    // Initialize all the spins to be +1.
+    void Initialize();
+
+    // Sweep through the lattice once using Metropolis algorithm.
+    void Sweep(const double & beta, const double & magnetic_h);
+    void Sweep(const ExpArray3D & exp_array);
+
+    // Calculate physical quantities.
+    Observable Analysis(const double & magnetic_h) const;
+
+    // A complete evaluation process. Should be initialized before!
+    // The blocked lattices and the correlations are measured along with the lattice if
+    //   `block_spin` and `correlation` are not null.
+    Observable Evaluate(const double & beta, const double & magnetic_h,
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta = 1,
+        BlockSpinMeasurement * block_spin = nullptr,
+        CorrelationMeasurement * correlation = nullptr);
+
+    // For lattice data generating and convergence analysis.
+    LatticeInfo EvaluateLatticeData(const double & beta, const double & magnetic_h,
+        const size_t & iterations);
+
+    // The spins as (L * L) rows of L spins, row x * L + y holding the spins (x, y, 0 .. L - 1).
+    Lattice2D Lattice() const;
+
+    // Show lattice (rows as in `Lattice()`).
+    void Show() const;
+    std::string ShowRow(const size_t & row) const;
+
+    // Number of spins.
+    size_t SiteCount() const { return size_ * size_ * size_; }
+
+    // Performance counters since the last `Initialize()`.
+    const KernelCounters & Counters() const { return counters_; }
+
+private:
+    const size_t size_;
+
+    std::vector<Spin> lattice_;
+
+    KernelCounters counters_;
+
+    inline size_t Index(const size_t & x, const size_t & y, const size_t & z) const
+    {
+        return (x * size_ + y) * size_ + z;
+    }
+};
+
+ISING_NAMESPACE_END
+
+#endif
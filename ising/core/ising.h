@@ -2,6 +2,7 @@
 #define ISING_CORE_ISING_H_
 
 #include <array>
+#include <cstddef>
 #include <string>
 #include <vector>
 
@@ -25,11 +26,49 @@ ISING_NAMESPACE_BEGIN
 // See https://stackoverflow.com/q/17794569/8479490.
 typedef std::vector<std::vector<int>> Lattice2D;
 
-// Store pre-evaluated Metropolis function values.
+// Store pre-evaluated Metropolis function values for a lattice with `kNeighbors` nearest spins,
+//   i.e. (kNeighbors * 2 + 1) * 2 possible values of (nearest sum, spin).
+template <std::size_t kNeighbors>
+using MetropolisTable = std::array<double, (kNeighbors * 2 + 1) * 2>;
 // 18 = (4 * 2 + 1) * 2 is the number of all the possible values of nearest sum.
-typedef std::array<double, 18> ExpArray;
+typedef MetropolisTable<4> ExpArray;
+// 26 = (6 * 2 + 1) * 2 for the cubic lattice.
+typedef MetropolisTable<6> ExpArray3D;
 
-enum BoundaryCondition { kPeriodic, kFree };
+enum BoundaryCondition { kPeriodic, kFree, kAntiperiodic };
+
+// Block-spin transforms, see "core/block-spin.h".
+enum BlockRule { kMajority, kDecimation };
+
+// Output of lattice data: JSON (stdout), or NumPy files with `int8` spins or bits packed
+//   into `uint8` (as `np.packbits(axis=-1)`).
+enum LatticeDataFormat { kJson, kNpy, kNpyPacked };
+
+// Exact results of `Exact`: the specific heat of L * L tori at h = 0 (Kaufman), or all the
+//   observables at any field by the transfer matrix of L * M tori or L * infinity strips (see
+//   "core/transfer-matrix.h").
+enum ExactMethod { kExactKaufman, kExactTorus, kExactStrip };
+
+// Random field classes of `Disorder`, at most.
+const std::size_t kMaxFieldClasses = 8;
+
+// Quenched disorder of the 2D lattice, see "core/ising-2d-disordered.h":
+//   * each bond is antiferromagnetic (J = -1) with probability `bond_probability`,
+//   * each site is vacant with probability `dilution`, and
+//   * each site has a random field, one of `field_classes` equally likely values evenly
+//     spaced in [-random_field, random_field] (+-random_field for 2 classes).
+struct Disorder
+{
+    double      bond_probability = 0.0;
+    double      dilution         = 0.0;
+    double      random_field     = 0.0;
+    std::size_t field_classes    = 2;
+
+    bool Enabled() const
+    {
+        return bond_probability > 0.0 || dilution > 0.0 || random_field != 0.0;
+    }
+};
 
 struct LatticeSize
 {
@@ -53,13 +92,18 @@ struct Observable
         energy(0.0),
         magnetic_dipole_abs(0.0),
         magnetic_dipole_square(0.0),
-        energy_square(0.0) {}
+        energy_square(0.0),
+        magnetic_dipole_fourth(0.0),
+        energy_fourth(0.0) {}
 
     double magnetic_dipole;
     double energy;
     double magnetic_dipole_abs;
     double magnetic_dipole_square;
     double energy_square;
+    // For Binder cumulants and kurtosis.
+    double magnetic_dipole_fourth;
+    double energy_fourth;
 
     Observable & operator/=(const double & scale)
     {
@@ -68,6 +112,8 @@ struct Observable
         magnetic_dipole_abs    /= scale;
         magnetic_dipole_square /= scale;
         energy_square          /= scale;
+        magnetic_dipole_fourth /= scale;
+        energy_fourth          /= scale;
         return *this;
     }
 
@@ -78,6 +124,8 @@ struct Observable
         magnetic_dipole_abs    += observable.magnetic_dipole_abs;
         magnetic_dipole_square += observable.magnetic_dipole_square;
         energy_square          += observable.energy_square;
+        magnetic_dipole_fourth += observable.magnetic_dipole_fourth;
+        energy_fourth          += observable.energy_fourth;
         return *this;
     }
 
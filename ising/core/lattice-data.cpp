@@ -1,16 +1,24 @@
 #include "core/lattice-data.h"
 
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <include/rapidjson/document.h>
 #include <include/rapidjson/writer.h>
 
+#include "core/async-writer.h"
+#include "core/cpu-dispatch.h"
 #include "core/info.h"
 #include "core/ising.h"
 #include "core/ising-2d.h"
+#include "core/ising-2d-small.h"
+#include "core/ising-3d.h"
+#include "core/npy.h"
 #include "core/parameter.h"
+#include "core/progress.h"
 
 // "Windows.h" should be put after "rapidjson/document.h".
 // See https://github.com/Tencent/rapidjson/issues/766
@@ -22,18 +30,33 @@ using namespace ising::toolkit;
 
 ISING_NAMESPACE_BEGIN
 
-LatticeDataUnit::LatticeDataUnit(const size_t & repetitions, const size_t & lattice_size) :
-    eval_list_(repetitions, lattice_size) {}
+LatticeDataUnit::LatticeDataUnit(const size_t & repetitions, const size_t & lattice_size,
+    const vector<size_t> & block_spin_scales, const BlockRule & block_spin_rule) :
+    repetitions_(repetitions),
+    lattice_size_(lattice_size),
+    block_spin_scales_(block_spin_scales),
+    block_spin_rule_(block_spin_rule) {}
 
+template <typename Lattice>
 void LatticeDataUnit::Run(const double & temperature, const double & magnetic_h,
-    const size_t & iterations)
+    const size_t & iterations, Progress * progress)
 {
     Lattice2D result;
-    for (auto & cell : eval_list_)
+    for (size_t i = 0; i != repetitions_; ++i)
     {
+        Lattice cell(lattice_size_);
         cell.Initialize();
-        result = cell.EvaluateLatticeData(1.0 / temperature, magnetic_h, iterations).lattice_data;
+        auto info = cell.EvaluateLatticeData(1.0 / temperature, magnetic_h, iterations);
+        result = info.lattice_data;
         result_list_.push_back(result);
+        observable_list_.push_back(info.observables.empty() ? Observable() : info.observables.back());
+        // Coarse-grained lattices of the same configuration.
+        vector<Lattice2D> block_spin_result;
+        for (auto scale : block_spin_scales_)
+            block_spin_result.push_back(BlockSpin(result, scale, block_spin_rule_));
+        block_spin_result_list_.push_back(block_spin_result);
+        if (progress)
+            progress->Advance(iterations, iterations * cell.SiteCount());
     }
 }
 
@@ -43,38 +66,117 @@ LatticeData::LatticeData(const Parameter & param) :
     magnetic_h_list_(param.magnetic_h_list),
     iterations_(param.iterations),
     repetitions_(param.repetitions),
+    dimension_(param.dimension),
+    boundary_condition_(param.boundary_condition),
+    status_file_(param.status_file),
+    block_spin_scales_(param.block_spin_scales),
+    block_spin_rule_(param.block_spin_rule),
+    format_(param.lattice_data_format),
+    prefix_(param.lattice_data_prefix),
     size_list_size_(size_list_.size()),
     eval_cell_num_(temperature_list_.size() * magnetic_h_list_.size()),
     // Initialize `eval_list_` and `result_list_` with correct dimensions.
     eval_list_(size_list_size_, vector<LatticeDataUnit>(eval_cell_num_)),
     result_list_(size_list_size_,
-        vector<vector<Lattice2D>>(eval_cell_num_, vector<Lattice2D>(repetitions_)))
+        vector<vector<Lattice2D>>(eval_cell_num_, vector<Lattice2D>(repetitions_))),
+    observable_list_(size_list_size_, vector<vector<Observable>>(eval_cell_num_)),
+    block_spin_result_list_(size_list_size_, vector<vector<vector<Lattice2D>>>(eval_cell_num_))
 {
     // Initialize `eval_list_` with correct `size` parameter.
     for (size_t i = 0; i != size_list_size_; ++i)
         for (size_t j = 0; j != eval_cell_num_; ++j)
-            eval_list_[i][j] = LatticeDataUnit(repetitions_, size_list_[i]);
+            eval_list_[i][j] = LatticeDataUnit(repetitions_, size_list_[i],
+                block_spin_scales_, block_spin_rule_);
 }
 
 int LatticeData::Run()
 {
     PrintParameters(cerr);
+    // Cells are written by the output thread as soon as they are completed.
+    if (format_ == kJson)
+        json_output_.reset(new JsonArrayStream(cout));
+    else
+        npy_files_.resize(size_list_size_);
     Simulate();
-    PrintResults(cout);
+    if (format_ == kJson)
+        json_output_->Close();
+    else if (!FinishNpyResults(cout))
+        return 1;
 
     return 0;
 }
 
 void LatticeData::Simulate()
+{
+    AsyncWriter output;
+    if (dimension_ == 3)
+    {
+        Simulate<Ising3D<>>(output);
+        return;
+    }
+    switch (boundary_condition_)
+    {
+    case kFree:
+        Simulate<Ising2D_FBC>(output);
+        break;
+    case kAntiperiodic:
+        Simulate<Ising2D_APBC>(output);
+        break;
+    default:
+        Simulate<Ising2D_PBC>(output);
+    }
+}
+
+template <typename Lattice>
+void LatticeData::RunUnit(LatticeDataUnit & unit, const size_t &,
+    const double & temperature, const double & magnetic_h, Progress & progress)
+{
+    unit.Run<Lattice>(temperature, magnetic_h, iterations_, &progress);
+}
+
+// Runs a unit with the engine chosen by `RunPeriodic2D()`.
+struct _UnitRunner
+{
+    LatticeDataUnit & unit;
+    double            temperature;
+    double            magnetic_h;
+    size_t            iterations;
+    Progress *        progress;
+
+    template <typename Lattice>
+    void Run()
+    {
+        unit.Run<Lattice>(temperature, magnetic_h, iterations, progress);
+    }
+};
+
+// Small periodic lattices use the bit-packed engines of fixed size.
+template <>
+void LatticeData::RunUnit<Ising2D_PBC>(LatticeDataUnit & unit, const size_t & size,
+    const double & temperature, const double & magnetic_h, Progress & progress)
+{
+    _UnitRunner runner{ unit, temperature, magnetic_h, iterations_, &progress };
+    RunPeriodic2D(size, runner);
+}
+
+template <typename Lattice>
+void LatticeData::Simulate(AsyncWriter & output)
 {
     const auto kTemperatureListSize = temperature_list_.size();
     Timing run_clock;
 
+    // The cost of a cell is proportional to (sweeps * L^d).
+    size_t total_work = 0;
+    for (auto size : size_list_)
+        total_work += eval_cell_num_ * repetitions_ * iterations_
+                    * (dimension_ == 3 ? size * size * size : size * size);
+    Progress progress(size_list_size_ * eval_cell_num_, total_work, status_file_);
+
+    cerr << "Running..." << endl;
+    run_clock.TimingBegin();
+    progress.Start();
     for (size_t i = 0; i != size_list_size_; ++i)
     {
-        cerr << "Running on size " << size_list_[i] << "..." << endl;
-
-        run_clock.TimingBegin();
 #ifdef ISING_PARALLEL
 #pragma omp parallel for
 #endif
@@ -84,17 +186,22 @@ void LatticeData::Simulate()
             auto & eval = eval_list_[i][j];
             auto t = temperature_list_[j % kTemperatureListSize];
             auto h = magnetic_h_list_[j / kTemperatureListSize];
-            eval.Run(t, h, iterations_);
+            RunUnit<Lattice>(eval, size_list_[i], t, h, progress);
             result_list_[i][j] = eval.Result();
+            observable_list_[i][j] = eval.ObservableResult();
+            block_spin_result_list_[i][j] = eval.BlockSpinResult();
 
-            PrintProgress(eval_cell_num_, j + 1);
+            progress.Complete();
+            output.Push([this, i, j] { WriteCell(i, static_cast<size_t>(j)); });
         }
-        run_clock.TimingEnd();
-        cerr << endl
-             << "Running time: " << run_clock.GetRunningTime() << "s." << endl << endl;
     }
+    // The tail of the output.
+    output.Finish();
+    progress.Stop();
+    run_clock.TimingEnd();
 
-    cerr << "Finished!" << endl;
+    cerr << "Finished!" << endl
+         << "Running time: " << run_clock.GetRunningTime() << "s." << endl << endl;
 }
 
 void LatticeData::PrintParameters(std::ostream & os)
@@ -105,10 +212,10 @@ void LatticeData::PrintParameters(std::ostream & os)
        << "*" << endl
        << "* Parameters:" << endl;
 
+    os << "*   Dimension:          "
+       << dimension_ << endl;
     os << "*   Boundary condition: "
-       // TODO: use only Periodic boundary condition now.
-       // << (param.boundary_condition == kPeriodic ? "Periodic" : "Free") << endl
-       << "Periodic" << endl;
+       << BoundaryConditionName(boundary_condition_) << endl;
 
     os << "*   Size list:" << endl
        << "*     ";
@@ -124,6 +231,19 @@ void LatticeData::PrintParameters(std::ostream & os)
        << "*     "
        << magnetic_h_list_.front() << " -- " << magnetic_h_list_.back() << endl;
 
+    if (block_spin_scales_.empty() == false)
+    {
+        os << "*   Block-spin scales (" << BlockRuleName(block_spin_rule_) << "):" << endl
+           << "*     ";
+        for (auto i : block_spin_scales_)
+            os << i << " ";
+        os << endl;
+    }
+
+    if (format_ != kJson)
+        os << "*   Output:             "
+           << prefix_ << "-L*.npy" << (format_ == kNpyPacked ? " (packed)" : "") << endl;
+
     os << "*   Iterations:         "
        << iterations_ << endl
        << "*   Repetitions:        "
@@ -140,61 +260,251 @@ void LatticeData::PrintParameters(std::ostream & os)
 #else
        << "Off" << endl
 #endif
+       << "*   Instruction set:    "
+       << CpuPathName(ActiveCpuPath()) << endl
        << InformationSeparator() << endl << endl;
 }
 
-void LatticeData::PrintResults(ostream & os)
+// JSON array of the rows of `lattice`.
+rapidjson::Value _LatticeValue(const Lattice2D & lattice,
+    rapidjson::Document::AllocatorType & allocator)
+{
+    rapidjson::Value lattice_val(rapidjson::Type::kArrayType);
+    for (auto & row : lattice)
+    {
+        rapidjson::Value row_val(rapidjson::Type::kArrayType);
+        for (auto spin : row)
+            row_val.PushBack(spin, allocator);
+        lattice_val.PushBack(row_val, allocator);
+    }
+    return lattice_val;
+}
+
+void LatticeData::WriteCell(const size_t & i, const size_t & j)
+{
+    if (format_ == kJson)
+        WriteJsonCell(i, j);
+    else
+        WriteNpyCell(i, j);
+
+    // The cell is never used again.
+    eval_list_[i][j] = LatticeDataUnit();
+    vector<Lattice2D>().swap(result_list_[i][j]);
+    vector<Observable>().swap(observable_list_[i][j]);
+    vector<vector<Lattice2D>>().swap(block_spin_result_list_[i][j]);
+}
+
+void LatticeData::WriteJsonCell(const size_t & i, const size_t & j)
 {
     const auto kTemperatureListSize = temperature_list_.size();
 
-    rapidjson::Document doc(rapidjson::Type::kArrayType);
+    rapidjson::Document doc;
     auto & doc_allocator = doc.GetAllocator();
 
-    for (size_t i = 0; i != size_list_size_; ++i)
-        for (size_t j = 0; j != eval_cell_num_; ++j)
+    rapidjson::Value cell_val(rapidjson::Type::kObjectType);
+
+    // Parameters.
+    cell_val.AddMember("size", size_list_[i], doc_allocator);
+    cell_val.AddMember("temperature",
+        temperature_list_[j % kTemperatureListSize], doc_allocator);
+    cell_val.AddMember("externalMagneticField ",
+        magnetic_h_list_[j / kTemperatureListSize], doc_allocator);
+
+    // Lattice data.
+    // 1st dimension:      repetition
+    // 2nd, 3rd dimension: lattice
+    rapidjson::Value lattice_data_val(rapidjson::Type::kArrayType);
+    for (auto & lattice : result_list_[i][j])
+        lattice_data_val.PushBack(_LatticeValue(lattice, doc_allocator), doc_allocator);
+
+    cell_val.AddMember("latticeData", lattice_data_val, doc_allocator);
+
+    // Blocked lattice data.
+    // 1st dimension:      block-spin scale
+    // 2nd dimension:      repetition
+    // 3rd, 4th dimension: lattice
+    if (block_spin_scales_.empty() == false)
+    {
+        rapidjson::Value block_spin_val(rapidjson::Type::kArrayType);
+        for (size_t k = 0; k != block_spin_scales_.size(); ++k)
         {
-            rapidjson::Value cell_val(rapidjson::Type::kObjectType);
-
-            // Parameters.
-            cell_val.AddMember("size", size_list_[i], doc_allocator);
-            cell_val.AddMember("temperature",
-                temperature_list_[j % kTemperatureListSize], doc_allocator);
-            cell_val.AddMember("externalMagneticField ",
-                magnetic_h_list_[j / kTemperatureListSize], doc_allocator);
-
-            // Lattice data.
-            // 1st dimension:      repetition
-            // 2nd, 3rd dimension: lattice
-            rapidjson::Value lattice_data_val(rapidjson::Type::kArrayType);
-            rapidjson::Value lattice_val(rapidjson::Type::kArrayType);
-            rapidjson::Value row_val(rapidjson::Type::kArrayType);
-
-            for (auto lattice : result_list_[i][j])
-            {
-                lattice_val.SetArray();
-                for (auto row : lattice)
-                {
-                    row_val.SetArray();
-                    // `result` is a 2D lattice.
-                    for (auto spin : row)
-                        row_val.PushBack(spin, doc_allocator);
-                    lattice_val.PushBack(row_val, doc_allocator);
-                }
-                lattice_data_val.PushBack(lattice_val, doc_allocator);
-            }
-            
-            cell_val.AddMember("latticeData", lattice_data_val, doc_allocator);
-
-            // Add to the outer array.
-            doc.PushBack(cell_val, doc_allocator);
+            rapidjson::Value scale_val(rapidjson::Type::kObjectType);
+            rapidjson::Value scale_data_val(rapidjson::Type::kArrayType);
+            for (auto & result : block_spin_result_list_[i][j])
+                scale_data_val.PushBack(_LatticeValue(result[k], doc_allocator), doc_allocator);
+            scale_val.AddMember("scale", block_spin_scales_[k], doc_allocator);
+            scale_val.AddMember("latticeData", scale_data_val, doc_allocator);
+            block_spin_val.PushBack(scale_val, doc_allocator);
         }
+        cell_val.AddMember("blockSpin", block_spin_val, doc_allocator);
+    }
 
     rapidjson::StringBuffer buffer;
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
+    cell_val.Accept(writer);
+    json_output_->Put(i * eval_cell_num_ + j, buffer.GetString());
+}
+
+// Shape of `count` lattices like `lattice` (L * L, or L^2 * L for 3D, see `Ising3D::Lattice()`).
+// The last axis is packed into bytes for `kNpyPacked`.
+vector<size_t> _NpyLatticeShape(const size_t & count, const Lattice2D & lattice,
+    const size_t & dimension, const LatticeDataFormat & format)
+{
+    auto columns = lattice.empty() ? 0 : lattice[0].size();
+    vector<size_t> shape = { count };
+    if (dimension == 3)
+        shape.insert(shape.end(), { columns, columns });
+    else
+        shape.push_back(lattice.size());
+    shape.push_back(format == kNpyPacked ? (columns + 7) / 8 : columns);
+    return shape;
+}
+
+// Append the spins of `lattice` to `bytes`, as `int8` or packed bits (+1 to 1, first spin
+//   in the highest bit).
+void _NpyLatticeBytes(const Lattice2D & lattice, const LatticeDataFormat & format,
+    vector<uint8_t> & bytes)
+{
+    for (auto & row : lattice)
+    {
+        if (format != kNpyPacked)
+        {
+            for (auto spin : row)
+                bytes.push_back(static_cast<uint8_t>(static_cast<int8_t>(spin)));
+            continue;
+        }
+        for (size_t j = 0; j < row.size(); j += 8)
+        {
+            uint8_t byte = 0;
+            for (size_t k = 0; k != 8 && j + k != row.size(); ++k)
+                byte |= (row[j + k] > 0 ? 1 : 0) << (7 - k);
+            bytes.push_back(byte);
+        }
+    }
+}
+
+// Files of each size (`prefix_` = "ising-data", size = 16):
+//   ising-data-L16.npy                   lattices, [N, L, L] (or [N, L, L, L] for 3D)
+//   ising-data-L16-b2.npy                blocked lattices (scale 2), [N, L / 2, L / 2]
+//   ising-data-L16-temperature.npy       float64 [N]
+//   ising-data-L16-field.npy             float64 [N]
+//   ising-data-L16-size.npy              int64 [N]
+//   ising-data-L16-energy.npy            float64 [N], energy per site
+//   ising-data-L16-magnetization.npy     float64 [N], magnetization per site
+// with N = (T * B) * repetitions, repetitions being the fastest.
+//
+// The cells are written in place as they are completed (in any order), cell `j` taking the
+//   entries [j * repetitions, (j + 1) * repetitions).
+void LatticeData::WriteNpyCell(const size_t & i, const size_t & j)
+{
+    const auto kTemperatureListSize = temperature_list_.size();
+    const auto kCount = eval_cell_num_ * repetitions_;
+    const auto kFirst = j * repetitions_;
+    const auto & kLattices = result_list_[i][j];
+    const auto & kBlockSpinLattices = block_spin_result_list_[i][j];
+    if (kLattices.empty())
+        return;
+
+    auto & files = npy_files_[i];
+    if (!files.lattices)
+    {
+        const string kDescr = format_ == kNpyPacked ? "|u1" : "|i1";
+        const auto kFilePrefix = prefix_ + "-L" + to_string(size_list_[i]);
+        files.lattices.reset(new NpyWriter(kFilePrefix + ".npy", kDescr,
+            _NpyLatticeShape(kCount, kLattices.front(), dimension_, format_)));
+        for (size_t l = 0; l != block_spin_scales_.size(); ++l)
+            files.block_spin.emplace_back(new NpyWriter(
+                kFilePrefix + "-b" + to_string(block_spin_scales_[l]) + ".npy", kDescr,
+                _NpyLatticeShape(kCount, kBlockSpinLattices.front()[l], 2, format_)));
+        files.temperature.reset(new NpyWriter(kFilePrefix + "-temperature.npy", "<f8", { kCount }));
+        files.magnetic_h.reset(new NpyWriter(kFilePrefix + "-field.npy", "<f8", { kCount }));
+        files.size.reset(new NpyWriter(kFilePrefix + "-size.npy", "<i8", { kCount }));
+        files.energy.reset(new NpyWriter(kFilePrefix + "-energy.npy", "<f8", { kCount }));
+        files.magnetization.reset(new NpyWriter(kFilePrefix + "-magnetization.npy", "<f8",
+            { kCount }));
+    }
 
-    string json_str(buffer.GetString());
-    os << json_str << endl;
+    // The whole cell in one write.
+    vector<uint8_t> bytes;
+    for (auto & lattice : kLattices)
+        _NpyLatticeBytes(lattice, format_, bytes);
+    files.lattices->Seek(kFirst * (bytes.size() / repetitions_));
+    files.lattices->Write(bytes);
+    for (size_t l = 0; l != block_spin_scales_.size(); ++l)
+    {
+        bytes.clear();
+        for (auto & result : kBlockSpinLattices)
+            _NpyLatticeBytes(result[l], format_, bytes);
+        files.block_spin[l]->Seek(kFirst * (bytes.size() / repetitions_));
+        files.block_spin[l]->Write(bytes);
+    }
+
+    vector<double> temperature(repetitions_, temperature_list_[j % kTemperatureListSize]);
+    vector<double> magnetic_h(repetitions_, magnetic_h_list_[j / kTemperatureListSize]);
+    vector<int64_t> size(repetitions_, static_cast<int64_t>(size_list_[i]));
+    vector<double> energy, magnetization;
+    for (auto & observable : observable_list_[i][j])
+    {
+        energy.push_back(observable.energy);
+        magnetization.push_back(observable.magnetic_dipole);
+    }
+    files.temperature->Seek(kFirst * sizeof(double));
+    files.temperature->Write(temperature);
+    files.magnetic_h->Seek(kFirst * sizeof(double));
+    files.magnetic_h->Write(magnetic_h);
+    files.size->Seek(kFirst * sizeof(int64_t));
+    files.size->Write(size);
+    files.energy->Seek(kFirst * sizeof(double));
+    files.energy->Write(energy);
+    files.magnetization->Seek(kFirst * sizeof(double));
+    files.magnetization->Write(magnetization);
+}
+
+bool LatticeData::FinishNpyResults(ostream & os)
+{
+    const auto kCount = eval_cell_num_ * repetitions_;
+
+    bool good = true;
+    rapidjson::Document doc(rapidjson::Type::kArrayType);
+    auto & doc_allocator = doc.GetAllocator();
+
+    for (size_t i = 0; i != size_list_size_; ++i)
+    {
+        if (kCount == 0)
+            break;
+        const auto kSize = size_list_[i];
+        const auto kFilePrefix = prefix_ + "-L" + to_string(kSize);
+
+        auto & files = npy_files_[i];
+        good = good && files.lattices && files.lattices->Good()
+            && files.temperature->Good() && files.magnetic_h->Good() && files.size->Good()
+            && files.energy->Good() && files.magnetization->Good();
+        for (auto & writer : files.block_spin)
+            good = good && writer->Good();
+        files = NpyFiles();
+
+        rapidjson::Value size_val(rapidjson::Type::kObjectType);
+        size_val.AddMember("size", kSize, doc_allocator);
+        size_val.AddMember("count", kCount, doc_allocator);
+        size_val.AddMember("prefix", rapidjson::Value(kFilePrefix.c_str(), doc_allocator),
+            doc_allocator);
+
+        rapidjson::Value block_spin_val(rapidjson::Type::kArrayType);
+        for (auto scale : block_spin_scales_)
+            block_spin_val.PushBack(scale, doc_allocator);
+        size_val.AddMember("blockSpinScales", block_spin_val, doc_allocator);
+
+        doc.PushBack(size_val, doc_allocator);
+    }
+
+    if (!good)
+        cerr << "Failed to write the NumPy files " << prefix_ << "-L*.npy." << endl;
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> json_writer(buffer);
+    doc.Accept(json_writer);
+    os << buffer.GetString() << endl;
+    return good;
 }
 
 int RunLatticeData(const Parameter & param)
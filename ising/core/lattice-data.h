@@ -1,9 +1,18 @@
 #ifndef ISING_CORE_LATTICE_DATA_H_
 #define ISING_CORE_LATTICE_DATA_H_
 
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/async-writer.h"
+#include "core/block-spin.h"
 #include "core/ising.h"
 #include "core/ising-2d.h"
+#include "core/npy.h"
 #include "core/parameter.h"
+#include "core/progress.h"
 
 // "Windows.h" should be put after "rapidjson/document.h".
 // See https://github.com/Tencent/rapidjson/issues/766
@@ -16,15 +25,32 @@ class LatticeDataUnit
 {
 public:
     LatticeDataUnit() = default;
-    LatticeDataUnit(const size_t & repetitions, const size_t & lattice_size);
+    LatticeDataUnit(const size_t & repetitions, const size_t & lattice_size,
+        const std::vector<size_t> & block_spin_scales = std::vector<size_t>(),
+        const BlockRule & block_spin_rule = kMajority);
 
+    // `Lattice` is an `Ising2D`, `Ising2DSmall` or `Ising3D` instantiation, which fixes the
+    //   dimension and the boundary condition.
+    // `progress` (if not null) is advanced after each repetition.
+    template <typename Lattice>
     void Run(const double & temperature, const double & magnetic_h,
-        const size_t & iterations);
+        const size_t & iterations,
+        toolkit::Progress * progress = nullptr);
     inline std::vector<Lattice2D> Result() { return result_list_; }
+    // Observables of the lattices in `Result()`.
+    inline std::vector<Observable> ObservableResult() { return observable_list_; }
+    // 1st dimension: repetition
+    // 2nd dimension: block-spin scale
+    inline std::vector<std::vector<Lattice2D>> BlockSpinResult() { return block_spin_result_list_; }
 
 private:
-    std::vector<Ising2D_PBC> eval_list_;
+    size_t                   repetitions_;
+    size_t                   lattice_size_;
+    std::vector<size_t>      block_spin_scales_;
+    BlockRule                block_spin_rule_;
     std::vector<Lattice2D>   result_list_;
+    std::vector<Observable>  observable_list_;
+    std::vector<std::vector<Lattice2D>> block_spin_result_list_;
 };
 
 // TODO: This class almost has the same structure as `Simulation`.
@@ -44,6 +70,13 @@ private:
     const std::vector<double> magnetic_h_list_;
     const size_t              iterations_;
     const size_t              repetitions_;
+    const size_t              dimension_;
+    const BoundaryCondition   boundary_condition_;
+    const std::string         status_file_;
+    const std::vector<size_t> block_spin_scales_;
+    const BlockRule           block_spin_rule_;
+    const LatticeDataFormat   format_;
+    const std::string         prefix_;
 
     // The size (length) of `size_list_`
     const size_t size_list_size_;
@@ -59,10 +92,53 @@ private:
     // 2nd dimension: T * B
     // 3rd dimension: repetition
     std::vector<std::vector<std::vector<Lattice2D>>> result_list_;
-    
+
+    // 1st dimension: size
+    // 2nd dimension: T * B
+    // 3rd dimension: repetition
+    std::vector<std::vector<std::vector<Observable>>> observable_list_;
+
+    // 1st dimension: size
+    // 2nd dimension: T * B
+    // 3rd dimension: repetition
+    // 4th dimension: block-spin scale
+    std::vector<std::vector<std::vector<std::vector<Lattice2D>>>> block_spin_result_list_;
+
+    // NumPy files of a size, opened with its first completed cell.
+    struct NpyFiles
+    {
+        std::unique_ptr<toolkit::NpyWriter> lattices;
+        // 1st dimension: block-spin scale
+        std::vector<std::unique_ptr<toolkit::NpyWriter>> block_spin;
+        std::unique_ptr<toolkit::NpyWriter> temperature;
+        std::unique_ptr<toolkit::NpyWriter> magnetic_h;
+        std::unique_ptr<toolkit::NpyWriter> size;
+        std::unique_ptr<toolkit::NpyWriter> energy;
+        std::unique_ptr<toolkit::NpyWriter> magnetization;
+    };
+
+    // Output, written by the output thread as the cells are completed.
+    // The cells (JSON) in order, on `cout`.
+    std::unique_ptr<toolkit::JsonArrayStream> json_output_;
+    // 1st dimension: size
+    std::vector<NpyFiles> npy_files_;
+
+    // Dispatch on `dimension_` and `boundary_condition_` once per run.
     void Simulate();
+    // Completed cells are handed to `output`.
+    template <typename Lattice>
+    void Simulate(toolkit::AsyncWriter & output);
+    // Run a cell of size `size` with `Lattice`, see the specialization for `Ising2D_PBC`.
+    template <typename Lattice>
+    void RunUnit(LatticeDataUnit & unit, const size_t & size,
+        const double & temperature, const double & magnetic_h, toolkit::Progress & progress);
     void PrintParameters(std::ostream & os);
-    void PrintResults(std::ostream & os);
+    // Write the cell (size `i`, T * B `j`) and release its lattices, on the output thread.
+    void WriteCell(const size_t & i, const size_t & j);
+    void WriteJsonCell(const size_t & i, const size_t & j);
+    void WriteNpyCell(const size_t & i, const size_t & j);
+    // Close the NumPy files and print their list (JSON). Return false if any write fails.
+    bool FinishNpyResults(std::ostream & os);
 };
 
 // Interface.
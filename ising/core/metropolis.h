@@ -0,0 +1,67 @@
+#ifndef ISING_CORE_METROPOLIS_H_
+#define ISING_CORE_METROPOLIS_H_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+
+#include "core/counters.h"
+#include "core/cpu-dispatch.h"
+#include "core/fast-rand.h"
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Metropolis steps with pre-evaluated `exp()`, shared by the lattice engines.
+// A site with `kNeighbors` nearest spins has the nearest sum in [-kNeighbors, kNeighbors].
+// For the map (kNeighbors = 4):
+// spin           spin_sum           ->            index
+//  +1    -4 -3 -2 -1 0 +1 +2 +3 +4  ->  0  1  2  3  4  5  6  7  8
+//  -1    -4 -3 -2 -1 0 +1 +2 +3 +4  ->  9 10 11 12 13 14 15 16 17
+
+// Pre-evaluate the Metropolis function values (`exp()`).
+template <std::size_t kNeighbors>
+inline MetropolisTable<kNeighbors> InitializeMetropolisTable(const double & beta,
+    const double & magnetic_h)
+{
+    const int kSumCount = 2 * kNeighbors + 1;
+    MetropolisTable<kNeighbors> table;
+    for (int i = 0; i != kSumCount; ++i)
+    {
+        auto spin_sum = static_cast<double>(i - static_cast<int>(kNeighbors));
+        // spin = +1
+        table[i]             = std::exp(-2 * beta * (spin_sum + magnetic_h));
+        // spin = -1
+        table[i + kSumCount] = std::exp( 2 * beta * (spin_sum + magnetic_h));
+    }
+    for (auto & i : table)
+        i = i < 1.0 ? i : 1.0;
+    return table;
+}
+
+// Index of the table (see above).
+template <std::size_t kNeighbors>
+inline int _MetropolisIndex(const int & spin_sum, const int & spin_value)
+{
+    return spin_sum + static_cast<int>(kNeighbors)
+         - static_cast<int>(2 * kNeighbors + 1) * (spin_value - 1) / 2;
+}
+
+// One Metropolis step of `spin` with the nearest sum `spin_sum`.
+template <std::size_t kTableSize, typename Spin>
+ISING_ALWAYS_INLINE void _MetropolisStep(Spin & spin, const int & spin_sum,
+    const std::array<double, kTableSize> & table, KernelCounters & counters)
+{
+    auto index = _MetropolisIndex<(kTableSize / 2 - 1) / 2>(spin_sum, spin);
+    ISING_COUNT(counters.attempted_by_class[index] += 1);
+    if (toolkit::FastRandUniform() < table[index])
+    {
+        spin = -spin;
+        ISING_COUNT(counters.accepted_by_class[index] += 1);
+    }
+}
+
+ISING_NAMESPACE_END
+
+#endif
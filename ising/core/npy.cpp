@@ -0,0 +1,61 @@
+#include "core/npy.h"
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// The data start at a multiple of 64 bytes, as NumPy writes it.
+const size_t kNpyAlignment  = 64;
+const size_t kNpyBufferSize = 1 << 20;
+
+NpyWriter::NpyWriter(const string & file_name, const string & descr, const vector<size_t> & shape) :
+    buffer_(kNpyBufferSize),
+    data_begin_(0)
+{
+    // The buffer must be set before opening.
+    file_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+    file_.open(file_name, ios::binary);
+
+    // Python literal of the shape, e.g. "(10,)" and "(10, 8, 8)".
+    string shape_str = "(";
+    for (size_t i = 0; i != shape.size(); ++i)
+        shape_str += (i == 0 ? "" : ", ") + to_string(shape[i]);
+    shape_str += shape.size() == 1 ? ",)" : ")";
+
+    string header = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': "
+                  + shape_str + ", }";
+    // Magic string (6), version (2) and header length (2) come before the header.
+    const size_t kPreambleSize = 10;
+    auto padding = kNpyAlignment - (kPreambleSize + header.size() + 1) % kNpyAlignment;
+    header += string(padding % kNpyAlignment, ' ') + "\n";
+
+    const char kMagic[] = "\x93NUMPY\x01\x00";
+    file_.write(kMagic, 8);
+    auto header_size = header.size();
+    char header_size_bytes[2] =
+    {
+        static_cast<char>(header_size & 0xff),
+        static_cast<char>((header_size >> 8) & 0xff)
+    };
+    file_.write(header_size_bytes, 2);
+    file_.write(header.data(), header.size());
+    data_begin_ = file_.tellp();
+}
+
+void NpyWriter::Seek(const size_t & offset)
+{
+    file_.seekp(data_begin_ + static_cast<streamoff>(offset));
+}
+
+void NpyWriter::Write(const void * data, const size_t & bytes)
+{
+    file_.write(static_cast<const char *>(data), bytes);
+}
+
+ISING_TOOLKIT_NAMESPACE_END
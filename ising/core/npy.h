@@ -0,0 +1,57 @@
+#ifndef ISING_CORE_NPY_H_
+#define ISING_CORE_NPY_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Writer of NumPy ".npy" files (format version 1.0), which can be loaded with
+//   `np.load(file_name, mmap_mode='r')`.
+// See https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html.
+// The header declares the whole shape, and the data (C order) are appended piece by piece,
+//   so a dataset never has to be held in memory. With `Seek()`, the pieces can also be
+//   written out of order, e.g. as the cells of a parallel run are completed.
+// Multi-byte types are written in the native byte order, which should be little-endian
+//   ("<" in `descr`).
+class NpyWriter
+{
+public:
+    // `descr` is the NumPy type string, e.g. "|i1", "|u1", "<f8" and "<i8".
+    NpyWriter(const std::string & file_name, const std::string & descr,
+        const std::vector<size_t> & shape);
+
+    inline bool Good() const { return file_.good(); }
+
+    // Move to the byte `offset` of the data (after the header).
+    void Seek(const size_t & offset);
+    void Write(const void * data, const size_t & bytes);
+    template <typename T>
+    void Write(const std::vector<T> & data)
+    {
+        Write(data.data(), data.size() * sizeof(T));
+    }
+
+private:
+    // Large writes rather than many small ones. Outlives `file_`.
+    std::vector<char> buffer_;
+    std::ofstream     file_;
+    std::streamoff    data_begin_;
+};
+
+// Write a 1D array.
+template <typename T>
+bool WriteNpy(const std::string & file_name, const std::string & descr,
+    const std::vector<T> & data)
+{
+    NpyWriter writer(file_name, descr, { data.size() });
+    writer.Write(data);
+    return writer.Good();
+}
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
@@ -1,8 +1,10 @@
 #include "core/parameter.h"
 
+#include <algorithm>
 #include <cmath>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <typeinfo>
 #include <vector>
@@ -30,24 +32,34 @@ void Parameter::ReadFromFile(const char * file_name)
     file.close();
 }
 
+bool Parameter::IsValid() const
+{
+    return !json_doc_.HasParseError() && json_doc_.IsObject();
+}
+
 void Parameter::Parse()
 {
+    ParseDimension();
     ParseBoundaryCondition();
     ParseLatticeSizeList();
     ParseTemperatureList();
     ParseMagneticFieldList();
+    ParseAdaptiveGrid();
     ParseIterations();
     ParseEnsembleCount();
     ParseEnsembleInterval();
     ParseRepetitions();
-}
-
-void Parameter::ParseBoundaryCondition()
-{
-    if (json_doc_.HasMember("boundary") && strcmp(json_doc_["boundary"].GetString(), "free") == 0)
-        boundary_condition = kFree;
-    else
-        boundary_condition = kPeriodic;
+    ParseResultStore();
+    ParseExactSurrogate();
+    ParseProgress();
+    ParseBlockSpin();
+    ParseDisorder();
+    // After `ParseDisorder()`, which may make the lattices periodic.
+    ParseCorrelation();
+    ParseNFoldWay();
+    ParseReplicas();
+    ParseLatticeDataOutput();
+    ParseServer();
 }
 
 template <typename T>
@@ -59,24 +71,53 @@ bool _LessEqual(const T & a, const T & b, const double & tolerance)
         return a <= b;
 }
 
+// rapidjson asserts on a value of another type, which would abort the program (or `libising`),
+//   so the types are checked first.
+void _CheckType(const bool & is_valid, const string & key, const string & type)
+{
+    if (!is_valid)
+        throw invalid_argument("\"" + key + "\" should be " + type + ".");
+}
+
+template <typename T>
+string _TypeName()
+{
+    return typeid(T) == typeid(double) ? "real number" : "non-negative integer";
+}
+
+template <typename T>
+T _GetMember(const rapidjson::Value & span, const string & key, const char * member)
+{
+    auto iter = span.FindMember(member);
+    _CheckType(iter != span.MemberEnd() && iter->value.Is<T>(), key + "\".\"" + member,
+        "a " + _TypeName<T>());
+    return iter->value.Get<T>();
+}
+
 template <typename T>
-vector<T> _SpanToVector(const rapidjson::Value & span, const double & tolerance)
+vector<T> _SpanToVector(const rapidjson::Value & span, const string & key, const double & tolerance)
 {
+    _CheckType(span.IsObject(), key, "an object");
     vector<T> v;
-    auto v_begin = span["begin"].Get<T>();
-    auto v_end   = span["end"].Get<T>();
-    auto v_step  = span["step"].Get<T>();
+    auto v_begin = _GetMember<T>(span, key, "begin");
+    auto v_end   = _GetMember<T>(span, key, "end");
+    auto v_step  = _GetMember<T>(span, key, "step");
+    _CheckType(v_step > 0, key + "\".\"step", "positive");
     for (auto i = v_begin; _LessEqual(i, v_end, tolerance); i += v_step)
         v.push_back(i);
     return v;
 }
 
 template <typename T>
-vector<T> _GetVector(const rapidjson::Value & array)
+vector<T> _GetVector(const rapidjson::Value & array, const string & key)
 {
+    _CheckType(array.IsArray(), key, "an array");
     vector<T> v;
     for (auto & i : array.GetArray())
+    {
+        _CheckType(i.Is<T>(), key, "an array of " + _TypeName<T>() + "s");
         v.push_back(i.Get<T>());
+    }
     return v;
 }
 
@@ -89,10 +130,10 @@ vector<T> _ParseList(const rapidjson::Document & doc, const string & key, const
 {
     auto span_iter = doc.FindMember((key + ".span").c_str());
     if (span_iter != doc.MemberEnd())
-        return _SpanToVector<T>(span_iter->value, tolerance);
+        return _SpanToVector<T>(span_iter->value, key + ".span", tolerance);
     auto list_iter = doc.FindMember((key + ".list").c_str());
     if (list_iter != doc.MemberEnd())
-        return _GetVector<T>(list_iter->value);
+        return _GetVector<T>(list_iter->value, key + ".list");
     // The program should never go here.
     return vector<T>();
 }
@@ -125,11 +166,85 @@ size_t _ParseSizeT(const rapidjson::Document & doc, const char * key, const size
 {
     auto iter = doc.FindMember(key);
     if (iter != doc.MemberEnd())
+    {
+        _CheckType(iter->value.IsInt() && iter->value.GetInt() >= 0, key,
+            "a " + _TypeName<size_t>());
         return static_cast<size_t>(iter->value.GetInt());
+    }
+    else
+        return default_value;
+}
+
+// Helper function for getting an `int` value.
+int _ParseInt(const rapidjson::Document & doc, const char * key, const int & default_value)
+{
+    auto iter = doc.FindMember(key);
+    if (iter != doc.MemberEnd())
+    {
+        _CheckType(iter->value.IsInt(), key, "an integer");
+        return iter->value.GetInt();
+    }
+    else
+        return default_value;
+}
+
+// Helper function for getting a `double` value.
+double _ParseDouble(const rapidjson::Document & doc, const char * key, const double & default_value)
+{
+    auto iter = doc.FindMember(key);
+    if (iter != doc.MemberEnd())
+    {
+        _CheckType(iter->value.IsNumber(), key, "a real number");
+        return iter->value.GetDouble();
+    }
+    else
+        return default_value;
+}
+
+// Helper function for getting a `bool` value.
+bool _ParseBool(const rapidjson::Document & doc, const char * key, const bool & default_value)
+{
+    auto iter = doc.FindMember(key);
+    if (iter != doc.MemberEnd())
+    {
+        _CheckType(iter->value.IsBool(), key, "a boolean");
+        return iter->value.GetBool();
+    }
+    else
+        return default_value;
+}
+
+// Helper function for getting a string value.
+string _ParseString(const rapidjson::Document & doc, const char * key, const string & default_value)
+{
+    auto iter = doc.FindMember(key);
+    if (iter != doc.MemberEnd())
+    {
+        _CheckType(iter->value.IsString(), key, "a string");
+        return iter->value.GetString();
+    }
     else
         return default_value;
 }
 
+void Parameter::ParseDimension()
+{
+    dimension = _ParseSizeT(json_doc_, "dimension", kDefaultDimension) == 3 ? 3 : 2;
+}
+
+void Parameter::ParseBoundaryCondition()
+{
+    auto boundary = _ParseString(json_doc_, "boundary", "periodic");
+    if (boundary == "free")
+        boundary_condition = kFree;
+    else if (boundary == "antiperiodic")
+        boundary_condition = kAntiperiodic;
+    else
+        boundary_condition = kPeriodic;
+    if (dimension == 3)
+        boundary_condition = kPeriodic;
+}
+
 void Parameter::ParseIterations()
 {
     iterations = _ParseSizeT(json_doc_, "iterations", kDefaultIterations);
@@ -151,4 +266,111 @@ void Parameter::ParseRepetitions()
     repetitions = _ParseSizeT(json_doc_, "repetitions", kDefaultRepetitions);
 }
 
+void Parameter::ParseResultStore()
+{
+    seed         = _ParseInt(json_doc_, "seed", 0);
+    result_store = _ParseString(json_doc_, "resultStore.file", "");
+}
+
+void Parameter::ParseExactSurrogate()
+{
+    exact_tolerance = _ParseDouble(json_doc_, "exact.surrogateTolerance", kDefaultExactTolerance);
+    exact_cache     = _ParseString(json_doc_, "exact.surrogateCache", "");
+    exact_asymptotic_tolerance = _ParseDouble(json_doc_, "exact.asymptoticTolerance",
+        kDefaultAsymptoticTolerance);
+    auto method = _ParseString(json_doc_, "exact.method", "kaufman");
+    if (method == "torus")
+        exact_method = kExactTorus;
+    else if (method == "strip")
+        exact_method = kExactStrip;
+    else
+        exact_method = kExactKaufman;
+    exact_length = _ParseSizeT(json_doc_, "exact.length", 0);
+}
+
+void Parameter::ParseProgress()
+{
+    status_file = _ParseString(json_doc_, "progress.statusFile", "");
+}
+
+void Parameter::ParseAdaptiveGrid()
+{
+    adaptive_max_count = _ParseSizeT(json_doc_, "temperature.adaptive.maxCount", 0);
+    adaptive_tolerance = _ParseDouble(json_doc_, "temperature.adaptive.tolerance",
+        kDefaultAdaptiveTolerance);
+    adaptive_min_step  = _ParseDouble(json_doc_, "temperature.adaptive.minStep",
+        kDefaultAdaptiveMinStep);
+}
+
+void Parameter::ParseBlockSpin()
+{
+    block_spin_scales.clear();
+    if (dimension == 2)
+        for (auto scale : _ParseList<size_t>(json_doc_, "blockSpin.scale"))
+            if (scale >= 2)
+                block_spin_scales.push_back(scale);
+    auto rule = _ParseString(json_doc_, "blockSpin.rule", "majority");
+    block_spin_rule = rule == "decimation" ? kDecimation : kMajority;
+}
+
+void Parameter::ParseCorrelation()
+{
+    // The FFTs of "core/correlation.h" assume a periodic lattice.
+    correlation = dimension == 2 && boundary_condition == kPeriodic
+        && _ParseBool(json_doc_, "correlation", false);
+}
+
+void Parameter::ParseDisorder()
+{
+    disorder = Disorder();
+    if (dimension != 2)
+        return;
+    disorder.bond_probability = _ParseDouble(json_doc_, "disorder.bondProbability", 0.0);
+    disorder.dilution         = _ParseDouble(json_doc_, "disorder.dilution", 0.0);
+    disorder.random_field     = _ParseDouble(json_doc_, "disorder.randomField", 0.0);
+    disorder.field_classes    = _ParseSizeT(json_doc_, "disorder.fieldClasses", 2);
+    disorder.bond_probability = min(max(disorder.bond_probability, 0.0), 1.0);
+    disorder.dilution         = min(max(disorder.dilution, 0.0), 1.0);
+    disorder.field_classes    = min(max(disorder.field_classes, size_t(2)), kMaxFieldClasses);
+    if (disorder.Enabled())
+        boundary_condition = kPeriodic;
+}
+
+void Parameter::ParseNFoldWay()
+{
+    n_fold_temperature = _ParseDouble(json_doc_, "nFoldWay.temperature", kDefaultNFoldTemperature);
+}
+
+void Parameter::ParseReplicas()
+{
+    replica_lanes = _ParseSizeT(json_doc_, "replicas.lanes", kDefaultReplicaLanes);
+}
+
+void Parameter::ParseLatticeDataOutput()
+{
+    auto format = _ParseString(json_doc_, "latticeData.format", "json");
+    if (format == "npy")
+        lattice_data_format = kNpy;
+    else if (format == "npy.packed")
+        lattice_data_format = kNpyPacked;
+    else
+        lattice_data_format = kJson;
+    lattice_data_prefix = _ParseString(json_doc_, "latticeData.prefix", "ising-data");
+}
+
+void Parameter::ParseServer()
+{
+    server_temperature_count = _ParseSizeT(json_doc_, "server.temperatureCount",
+        kDefaultServerTemperatureCount);
+    if (server_temperature_count < 2)
+        server_temperature_count = 2;
+    server_sample_sweeps = _ParseSizeT(json_doc_, "server.sweepsBetweenSamples",
+        kDefaultServerSampleSweeps);
+    server_max_size = _ParseSizeT(json_doc_, "server.maxSize", kDefaultServerMaxSize);
+    server_max_chains = _ParseSizeT(json_doc_, "server.maxChains", kDefaultServerMaxChains);
+    // A request cycles through all its chains, which should stay in memory.
+    if (server_max_chains < server_temperature_count)
+        server_max_chains = server_temperature_count;
+}
+
 ISING_NAMESPACE_END
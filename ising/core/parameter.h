@@ -10,19 +10,63 @@
 ISING_NAMESPACE_BEGIN
 
 // The settings file (JSON) may have the following keys:
-//   * "boundary"                       string ("periodic", "free")
+//   * "dimension"                      integer (2, 3)
+//   * "boundary"                       string ("periodic", "free", "antiperiodic")
 //     "size.list"                      integer array
 //     "temperature.list"               real-number array
 //     "externalMagneticField.list"     real-number array
 //     "size.span"                      object
 //     "temperature.span"               object
 //     "externalMagneticField.span"     object
+//   * "temperature.adaptive.maxCount"  integer
+//   * "temperature.adaptive.tolerance" real-number
+//   * "temperature.adaptive.minStep"   real-number
 //   * "iterations"                     integer
 //   * "analysisEnsembleCount"          integer
 //   * "analysisEnsembleInterval"       integer
 //   * "repetitions"                    integer
+//   * "seed"                           integer
+//   * "resultStore.file"               string
+//   * "exact.surrogateTolerance"       real-number
+//   * "exact.surrogateCache"           string
+//   * "exact.asymptoticTolerance"      real-number
+//   * "exact.method"                   string ("kaufman", "torus", "strip")
+//   * "exact.length"                   integer
+//   * "progress.statusFile"            string
+//   * "blockSpin.scale.list"           integer array
+//   * "blockSpin.scale.span"           object
+//   * "blockSpin.rule"                 string ("majority", "decimation")
+//   * "correlation"                    boolean
+//   * "disorder.bondProbability"       real-number
+//   * "disorder.dilution"              real-number
+//   * "disorder.randomField"           real-number
+//   * "disorder.fieldClasses"          integer
+//   * "nFoldWay.temperature"           real-number
+//   * "replicas.lanes"                 integer
+//   * "latticeData.format"             string ("json", "npy", "npy.packed")
+//   * "latticeData.prefix"             string
+//   * "server.temperatureCount"        integer
+//   * "server.sweepsBetweenSamples"    integer
+//   * "server.maxSize"                 integer
+//   * "server.maxChains"               integer
 //
 // Keys with * have default values.
+// 3D lattices (cubic, L * L * L) are always periodic, i.e. "boundary" is ignored.
+// Block-spin scales (2D only) smaller than 2 are ignored.
+// "correlation" adds G(r), S(k) and the second-moment correlation length to the output of
+//   `Simulation` (see "core/correlation.h"). It is ignored for 3D lattices and for the free
+//   and antiperiodic boundaries, since the FFTs assume a periodic lattice.
+// Quenched disorder (2D only, always periodic) is simulated by `Simulation`, with each
+//   repetition a disorder sample (see `Disorder` and "core/ising-2d-disordered.h").
+// Below "nFoldWay.temperature", the clean periodic 2D cells of `Simulation` are evaluated with
+//   the rejection-free n-fold way (see "core/ising-2d-n-fold.h"). 0 to disable.
+// Above it, the repetitions of the cells of a size run in lockstep, up to "replicas.lanes"
+//   (at most 64) of them (see "core/ising-2d-replicas.h"). 0 to disable.
+// "exact.method" other than "kaufman" evaluates the sizes L of `Exact` by the transfer matrix,
+//   on L * "exact.length" tori (0 for L * L) or L * infinity strips, at each field.
+// With "temperature.adaptive.maxCount" > 0, the temperatures are the initial (coarse) grid of
+//   `Simulation`, refined around the specific heat and susceptibility peaks up to that many
+//   temperatures per size and field (see "core/adaptive-grid.h").
 //
 // A "span" object may have the following values:
 //   "begin"    real-number / integer
@@ -39,36 +83,106 @@ public:
     void ReadFromFile(const std::string & file_name);
     void ReadFromFile(const char * file_name);
 
+    // Whether the settings read are a JSON object, without which `Parse()` fails.
+    bool IsValid() const;
+
+    // Throws `std::invalid_argument` for a value of a wrong type, e.g. `"iterations": 1.5`.
     void Parse();
 
+    // 2 (square lattice) or 3 (cubic lattice).
+    size_t              dimension;
     BoundaryCondition   boundary_condition;
     size_t              lattice_size;
     std::vector<size_t> lattice_size_list;
     std::vector<double> temperature_list;
     std::vector<double> magnetic_h_list;
+    // Adaptive temperature grid of `Simulation` (`adaptive_max_count` = 0 to disable).
+    size_t              adaptive_max_count;
+    double              adaptive_tolerance;
+    double              adaptive_min_step;
     size_t              iterations;
     size_t              n_ensemble;
     size_t              n_delta;
     size_t              repetitions;
+    // Seed of the random numbers of `Simulation`.
+    int                 seed;
+    // Result store of `Simulation` (empty to disable), see "core/result-store.h".
+    std::string         result_store;
+    // Absolute tolerance of the Chebyshev surrogate used by `Exact` (0 to disable).
+    double              exact_tolerance;
+    // Cache file of the Chebyshev surrogate (empty to disable).
+    std::string         exact_cache;
+    // Tolerance of the infinite lattice fast path used by `Exact` (0 to disable).
+    double              exact_asymptotic_tolerance;
+    // Method of `Exact`, and the length of its tori (0 for square).
+    ExactMethod         exact_method;
+    size_t              exact_length;
+    // File to which the progress of the run is written periodically (empty to disable).
+    std::string         status_file;
+    // Scale factors of the block-spin transforms applied to the output (empty to disable).
+    std::vector<size_t> block_spin_scales;
+    BlockRule           block_spin_rule;
+    // Measure the spin correlations along with the simulation.
+    bool                correlation;
+    // Quenched disorder of `Simulation` (2D).
+    Disorder            disorder;
+    // Temperature below which `Simulation` uses the n-fold way (2D, periodic).
+    double              n_fold_temperature;
+    // Lanes of the lockstep replicas of `Simulation` (2D, periodic).
+    size_t              replica_lanes;
+    // Output format of `LatticeData`, and the prefix of the NumPy files.
+    LatticeDataFormat   lattice_data_format;
+    std::string         lattice_data_prefix;
+    // Temperature points of a request and sweeps between two samples of `DatasetServer`.
+    size_t              server_temperature_count;
+    size_t              server_sample_sweeps;
+    // Largest lattice size of a request, and the most chains kept in memory by `DatasetServer`.
+    size_t              server_max_size;
+    size_t              server_max_chains;
 
 private:
+    const size_t kDefaultDimension               = 2;
     const size_t kDefaultIterations              = 1000;
     const size_t kDefaultIterationsEnsembleRatio = 10;
     const size_t kDefaultEnsembleInterval        = 1;
     const size_t kDefaultRepetitions             = 1;
+    const size_t kDefaultServerTemperatureCount  = 16;
+    const size_t kDefaultServerSampleSweeps      = 10;
+    // A chain of size L takes 16 L^2 bytes, i.e. 1 MiB at the largest default size.
+    const size_t kDefaultServerMaxSize           = 256;
+    const size_t kDefaultServerMaxChains         = 64;
+    const double kDefaultExactTolerance          = 0.0;
+    const double kDefaultAsymptoticTolerance     = 0.0;
+    const double kDefaultAdaptiveTolerance       = 0.05;
+    const double kDefaultAdaptiveMinStep         = 1.0e-3;
+    // About where the n-fold way overtakes `Ising2D_PBC` (L = 64).
+    const double kDefaultNFoldTemperature        = 1.6;
+    const size_t kDefaultReplicaLanes            = 64;
 
     const double kDoubleTolerance = 1.0e-6;
 
     rapidjson::Document json_doc_;
 
+    void ParseDimension();
     void ParseBoundaryCondition();
     void ParseLatticeSizeList();
     void ParseTemperatureList();
     void ParseMagneticFieldList();
+    void ParseAdaptiveGrid();
     void ParseIterations();
     void ParseEnsembleCount();
     void ParseEnsembleInterval();
     void ParseRepetitions();
+    void ParseResultStore();
+    void ParseExactSurrogate();
+    void ParseProgress();
+    void ParseBlockSpin();
+    void ParseCorrelation();
+    void ParseDisorder();
+    void ParseNFoldWay();
+    void ParseReplicas();
+    void ParseLatticeDataOutput();
+    void ParseServer();
 };
 
 const std::string kDefaultSettingsString =
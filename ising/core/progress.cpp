@@ -0,0 +1,169 @@
+#include "core/progress.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Format seconds as "1h02m03s".
+string _FormatDuration(const double & seconds)
+{
+    auto total = static_cast<long long>(seconds + 0.5);
+    ostringstream ss;
+    if (total >= 3600)
+        ss << total / 3600 << "h" << setw(2) << setfill('0');
+    if (total >= 60)
+        ss << total / 60 % 60 << "m" << setw(2) << setfill('0');
+    ss << total % 60 << "s";
+    return ss.str();
+}
+
+Progress::Progress(const size_t & total_cells, const size_t & total_work,
+    const string & status_file, ostream & os) :
+    total_cells_(total_cells),
+    total_work_(total_work),
+    status_file_(status_file),
+    os_(os),
+    cells_(0),
+    sweeps_(0),
+    work_(0),
+    stopped_(true) {}
+
+Progress::~Progress()
+{
+    Stop();
+}
+
+void Progress::Start()
+{
+    if (reporter_.joinable())
+        return;
+    cells_  = 0;
+    sweeps_ = 0;
+    work_   = 0;
+    stopped_    = false;
+    begin_time_ = chrono::steady_clock::now();
+    reporter_   = thread(&Progress::Report, this);
+}
+
+void Progress::Stop()
+{
+    if (!reporter_.joinable())
+        return;
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopped_ = true;
+    }
+    stop_condition_.notify_one();
+    reporter_.join();
+
+    // Final status, after all workers have finished.
+    auto status = Snapshot();
+    Render(status);
+    os_ << endl;
+    WriteStatus(status, true);
+}
+
+void Progress::Report()
+{
+    auto status_time = chrono::steady_clock::now();
+    unique_lock<mutex> lock(mutex_);
+    while (!stop_condition_.wait_for(lock, chrono::milliseconds(kRenderInterval),
+        [this] { return stopped_; }))
+    {
+        auto status = Snapshot();
+        Render(status);
+        auto now = chrono::steady_clock::now();
+        if (now - status_time >= chrono::milliseconds(kStatusInterval))
+        {
+            WriteStatus(status, false);
+            status_time = now;
+        }
+    }
+}
+
+Progress::Status Progress::Snapshot() const
+{
+    Status status;
+    status.cells   = cells_.load(memory_order_relaxed);
+    status.sweeps  = sweeps_.load(memory_order_relaxed);
+    status.work    = work_.load(memory_order_relaxed);
+    status.elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin_time_).count();
+    status.sweep_rate = status.elapsed > 0.0 ? status.sweeps / status.elapsed : 0.0;
+    // Unknown (negative) before any work has been done.
+    if (status.work == 0)
+        status.eta = -1.0;
+    else if (status.work >= total_work_)
+        status.eta = 0.0;
+    else
+        status.eta = status.elapsed * (total_work_ - status.work) / status.work;
+    return status;
+}
+
+void Progress::Render(const Status & status)
+{
+    const streamsize kPrecision        = 2;
+    const streamsize kDefaultPrecision = os_.precision();
+    auto fraction = total_work_ == 0 ? 1.0 : static_cast<double>(status.work) / total_work_;
+    auto width = static_cast<size_t>(kProgressBarWidth * fraction);
+    if (width > kProgressBarWidth)
+        width = kProgressBarWidth;
+
+    // Progress bar.
+    os_ << "[" << string(width, '=') << ">" << string(kProgressBarWidth - width, ' ') << "]";
+    // Percentage.
+    os_ << setw(5 + kPrecision) << setprecision(kPrecision) << fixed
+        << 100.0 * fraction << "%"
+        << setprecision(kDefaultPrecision) << defaultfloat;
+    // Cells, speed and ETA.
+    os_ << "  " << status.cells << "/" << total_cells_ << " cells";
+    if (status.sweeps != 0)
+        os_ << "  " << setprecision(3) << status.sweep_rate << " sweeps/s"
+            << setprecision(kDefaultPrecision);
+    os_ << "  ETA " << (status.eta < 0.0 ? "--" : _FormatDuration(status.eta))
+        << "    \r";
+    os_.flush();
+}
+
+void Progress::WriteStatus(const Status & status, const bool & finished)
+{
+    if (status_file_.empty())
+        return;
+
+    // Write to a temporary file first, so that readers never see a partial status.
+    auto temp_file = status_file_ + ".tmp";
+    {
+        ofstream fout(temp_file);
+        fout << setprecision(12)
+             << "{\"completedCells\":" << status.cells
+             << ",\"totalCells\":"     << total_cells_
+             << ",\"sweeps\":"         << status.sweeps
+             << ",\"sweepsPerSecond\":" << status.sweep_rate
+             << ",\"work\":"           << status.work
+             << ",\"totalWork\":"      << total_work_
+             << ",\"elapsed\":"        << status.elapsed
+             << ",\"eta\":"            << (finished ? 0.0 : status.eta)
+             << ",\"finished\":"       << (finished ? "true" : "false")
+             << "}" << endl;
+        if (!fout)
+            return;
+    }
+#ifdef _MSC_VER
+    // `rename` does not replace existing files on Windows.
+    remove(status_file_.c_str());
+#endif
+    rename(temp_file.c_str(), status_file_.c_str());
+}
+
+ISING_TOOLKIT_NAMESPACE_END
@@ -0,0 +1,91 @@
+#ifndef ISING_CORE_PROGRESS_H_
+#define ISING_CORE_PROGRESS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "core/ising.h"
+
+ISING_TOOLKIT_NAMESPACE_BEGIN
+
+// Live progress of a parallel run.
+// Worker threads only bump relaxed atomic counters, a single reporter thread renders
+//   completed / total cells, sweeps per second and the ETA to `os`, and optionally
+//   writes the same status (JSON) to `status_file` periodically.
+// The ETA is estimated from the "work" done, which should be proportional to the cost
+//   of a cell (e.g. sweeps * L^2), so that cells of different sizes are weighted properly.
+// Usage:
+//     Progress progress(total_cells, total_work);
+//     progress.Start();
+//     /* In the parallel loop. */
+//     progress.Advance(sweeps, work);
+//     progress.Complete();
+//     /* After the parallel loop. */
+//     progress.Stop();
+class Progress
+{
+public:
+    Progress(const size_t & total_cells, const size_t & total_work,
+        const std::string & status_file = "", std::ostream & os = std::cerr);
+    ~Progress();
+
+    Progress(const Progress &) = delete;
+    Progress & operator=(const Progress &) = delete;
+
+    void Start();
+    void Stop();
+
+    // Thread safe, called by the workers.
+    inline void Advance(const size_t & sweeps, const size_t & work)
+    {
+        sweeps_.fetch_add(sweeps, std::memory_order_relaxed);
+        work_.fetch_add(work, std::memory_order_relaxed);
+    }
+    inline void Complete() { cells_.fetch_add(1, std::memory_order_relaxed); }
+
+private:
+    const size_t kProgressBarWidth = 40;
+    // Intervals in milliseconds.
+    const int    kRenderInterval   = 500;
+    const int    kStatusInterval   = 2000;
+
+    struct Status
+    {
+        size_t cells;
+        size_t sweeps;
+        size_t work;
+        double elapsed;
+        double sweep_rate;
+        double eta;
+    };
+
+    const size_t        total_cells_;
+    const size_t        total_work_;
+    const std::string   status_file_;
+    std::ostream &      os_;
+
+    std::atomic<size_t> cells_;
+    std::atomic<size_t> sweeps_;
+    std::atomic<size_t> work_;
+
+    std::thread             reporter_;
+    std::mutex              mutex_;
+    std::condition_variable stop_condition_;
+    bool                    stopped_;
+
+    std::chrono::steady_clock::time_point begin_time_;
+
+    void Report();
+    Status Snapshot() const;
+    void Render(const Status & status);
+    void WriteStatus(const Status & status, const bool & finished);
+};
+
+ISING_TOOLKIT_NAMESPACE_END
+
+#endif
@@ -0,0 +1,174 @@
+#include "core/result-store.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "core/block-spin.h"
+#include "core/ising.h"
+#include "core/ising-2d.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+const string kKeySeparator = " | ";
+
+string CellKey::String() const
+{
+    ostringstream ss;
+    ss.precision(numeric_limits<double>::max_digits10);
+    ss << "v" << kResultStoreVersion
+       << " d=" << dimension
+       << " bc=" << BoundaryConditionName(boundary_condition)
+       << " L=" << size
+       << " T=" << temperature
+       << " H=" << magnetic_h
+       << " it=" << iterations
+       << " ens=" << n_ensemble
+       << " dt=" << n_delta
+       << " bs=";
+    for (size_t i = 0; i != block_spin_scales.size(); ++i)
+        ss << (i == 0 ? "" : ",") << block_spin_scales[i];
+    ss << " rule=" << BlockRuleName(block_spin_rule);
+    if (correlation)
+        ss << " corr";
+    if (disorder.Enabled())
+        ss << " dis=" << disorder.bond_probability << "," << disorder.dilution << ","
+           << disorder.random_field << "," << disorder.field_classes;
+    return ss.str();
+}
+
+// The key without the temperature, and the temperature.
+string _SplitTemperature(const string & key, double & temperature)
+{
+    auto begin = key.find(" T=");
+    auto end   = key.find(" H=");
+    if (begin == string::npos || end == string::npos || end < begin)
+        return key;
+    temperature = stod(key.substr(begin + 3, end - begin - 3));
+    return key.substr(0, begin) + key.substr(end);
+}
+
+void _WriteObservable(ostream & os, const Observable & o)
+{
+    os << " " << o.magnetic_dipole << " " << o.energy << " " << o.magnetic_dipole_abs
+       << " " << o.magnetic_dipole_square << " " << o.energy_square
+       << " " << o.magnetic_dipole_fourth << " " << o.energy_fourth;
+}
+
+bool _ReadObservable(istream & is, Observable & o)
+{
+    return static_cast<bool>(is >> o.magnetic_dipole >> o.energy >> o.magnetic_dipole_abs
+                                >> o.magnetic_dipole_square >> o.energy_square
+                                >> o.magnetic_dipole_fourth >> o.energy_fourth);
+}
+
+const string kCorrelationSeparator = " #";
+
+void _WriteValues(ostream & os, const vector<double> & values)
+{
+    os << " " << values.size();
+    for (auto value : values)
+        os << " " << value;
+}
+
+bool _ReadValues(istream & is, vector<double> & values)
+{
+    size_t count = 0;
+    is >> count;
+    values.resize(count);
+    for (auto & value : values)
+        is >> value;
+    return static_cast<bool>(is);
+}
+
+ResultStore::ResultStore(const string & file_name) :
+    file_name_(file_name)
+{
+    if (Enabled() == false)
+        return;
+
+    // A missing file is an empty store. Broken lines (e.g. of an interrupted run) are skipped.
+    ifstream file(file_name_);
+    string line;
+    while (getline(file, line))
+    {
+        auto separator = line.find(kKeySeparator);
+        if (separator == string::npos)
+            continue;
+        auto values = line.substr(separator + kKeySeparator.size());
+        auto correlation_separator = values.find(kCorrelationSeparator);
+        istringstream is(values.substr(0, correlation_separator));
+        StoredRepetition repetition;
+        if (!(is >> repetition.seed) || !_ReadObservable(is, repetition.result))
+            continue;
+        Observable block_spin;
+        while (_ReadObservable(is, block_spin))
+            repetition.block_spin_result.push_back(block_spin);
+        if (correlation_separator != string::npos)
+        {
+            istringstream cs(values.substr(correlation_separator + kCorrelationSeparator.size()));
+            auto & correlation = repetition.correlation;
+            if (!(cs >> correlation.length) || !_ReadValues(cs, correlation.function)
+                || !_ReadValues(cs, correlation.structure_factor))
+                continue;
+        }
+        entries_[line.substr(0, separator)].push_back(repetition);
+    }
+}
+
+const vector<StoredRepetition> & ResultStore::Find(const CellKey & key) const
+{
+    static const vector<StoredRepetition> kEmpty;
+    auto iter = entries_.find(key.String());
+    return iter == entries_.end() ? kEmpty : iter->second;
+}
+
+vector<double> ResultStore::Temperatures(const CellKey & key) const
+{
+    double temperature = 0.0;
+    const auto kKey = _SplitTemperature(key.String(), temperature);
+    vector<double> temperatures;
+    for (auto & entry : entries_)
+        if (_SplitTemperature(entry.first, temperature) == kKey)
+            temperatures.push_back(temperature);
+    sort(temperatures.begin(), temperatures.end());
+    return temperatures;
+}
+
+bool ResultStore::Append(const CellKey & key, const vector<StoredRepetition> & repetitions)
+{
+    if (Enabled() == false || repetitions.empty())
+        return true;
+
+    // All the lines of the cell in one write.
+    const auto kKey = key.String();
+    ostringstream ss;
+    ss.precision(numeric_limits<double>::max_digits10);
+    for (auto & repetition : repetitions)
+    {
+        ss << kKey << kKeySeparator << repetition.seed;
+        _WriteObservable(ss, repetition.result);
+        for (auto & block_spin : repetition.block_spin_result)
+            _WriteObservable(ss, block_spin);
+        if (repetition.correlation.function.empty() == false)
+        {
+            ss << kCorrelationSeparator << " " << repetition.correlation.length;
+            _WriteValues(ss, repetition.correlation.function);
+            _WriteValues(ss, repetition.correlation.structure_factor);
+        }
+        ss << "\n";
+    }
+
+    ofstream file(file_name_, ios::app);
+    file << ss.str();
+    file.close();
+    return file.good();
+}
+
+ISING_NAMESPACE_END
@@ -0,0 +1,84 @@
+#ifndef ISING_CORE_RESULT_STORE_H_
+#define ISING_CORE_RESULT_STORE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "core/correlation.h"
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Bump when a change of the engines or of `Observable` makes the stored results
+//   incomparable with new ones.
+const int kResultStoreVersion = 2;
+
+// Parameters which determine the results of a cell of `Simulation`.
+struct CellKey
+{
+    size_t              dimension;
+    BoundaryCondition   boundary_condition;
+    size_t              size;
+    double              temperature;
+    double              magnetic_h;
+    size_t              iterations;
+    size_t              n_ensemble;
+    size_t              n_delta;
+    std::vector<size_t> block_spin_scales;
+    BlockRule           block_spin_rule;
+    bool                correlation;
+    Disorder            disorder;
+
+    // Canonical text of the key (with `kResultStoreVersion`), e.g.
+    //   "v2 d=2 bc=periodic L=16 T=2.5 H=0 it=1000 ens=100 dt=1 bs= rule=majority"
+    std::string String() const;
+};
+
+// A repetition of a cell.
+struct StoredRepetition
+{
+    // Seed of the run that produced it.
+    int                     seed;
+    Observable              result;
+    // 1st dimension: block-spin scale
+    std::vector<Observable> block_spin_result;
+    // Empty if the correlations are not measured.
+    Correlation             correlation;
+};
+
+// Persistent store of the repetitions of `Simulation` cells, so that repeated and incremental
+//   campaigns only compute what is missing.
+// The store is a plain text file, one repetition per line:
+//   <key> | <seed> <observable> [<observable of each block-spin scale> ...] [# <correlation>]
+// with `<key>` from `CellKey::String()`, `<observable>` the 7 values of `Observable`
+//   (magnetic dipole, energy, |magnetic dipole|, magnetic dipole^2, energy^2,
+//   magnetic dipole^4, energy^4), and
+//   `<correlation>` the length, and the sizes and values of G(r) and S(k).
+// New repetitions are appended, so the repetitions of a cell accumulate across runs.
+class ResultStore
+{
+public:
+    // An empty `file_name` disables the store.
+    explicit ResultStore(const std::string & file_name = "");
+
+    inline bool Enabled() const { return file_name_.empty() == false; }
+    inline const std::string & FileName() const { return file_name_; }
+
+    // Thread safe for concurrent lookups. The repetitions of `key` (empty if none).
+    const std::vector<StoredRepetition> & Find(const CellKey & key) const;
+    // Stored temperatures (sorted) of the cells which only differ from `key` in temperature.
+    std::vector<double> Temperatures(const CellKey & key) const;
+    // Append the repetitions of `key` to the file. Return false if the write fails.
+    bool Append(const CellKey & key, const std::vector<StoredRepetition> & repetitions);
+
+private:
+    const std::string file_name_;
+
+    // Repetitions by key, read when the store is opened.
+    std::map<std::string, std::vector<StoredRepetition>> entries_;
+};
+
+ISING_NAMESPACE_END
+
+#endif
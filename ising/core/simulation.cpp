@@ -1,15 +1,41 @@
 #include "core/simulation.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <random>
 #include <string>
+#include <utility>
 #include <vector>
 #include <include/rapidjson/document.h>
 #include <include/rapidjson/writer.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
+#include "core/adaptive-grid.h"
+#include "core/async-writer.h"
+#include "core/counters.h"
+#include "core/cpu-dispatch.h"
+#include "core/fast-rand.h"
+#include "core/finite-size-scaling.h"
 #include "core/info.h"
 #include "core/ising.h"
 #include "core/ising-2d.h"
+#include "core/ising-2d-disordered.h"
+#include "core/ising-2d-n-fold.h"
+#include "core/ising-2d-replicas.h"
+#include "core/ising-2d-small.h"
+#include "core/ising-3d.h"
 #include "core/parameter.h"
+#include "core/progress.h"
+#include "core/result-store.h"
 
 // "Windows.h" should be put after "rapidjson/document.h".
 // See https://github.com/Tencent/rapidjson/issues/766
@@ -21,19 +47,158 @@ using namespace ising::toolkit;
 
 ISING_NAMESPACE_BEGIN
 
-SimulationUnit::SimulationUnit(const size_t & repetitions, const size_t & lattice_size) :
-    eval_list_(repetitions, lattice_size) {}
+SimulationUnit::SimulationUnit(const size_t & repetitions, const size_t & lattice_size,
+    const vector<size_t> & block_spin_scales, const BlockRule & block_spin_rule,
+    const bool & correlation, const Disorder & disorder, const int & seed) :
+    repetitions_(repetitions),
+    lattice_size_(lattice_size),
+    block_spin_scales_(block_spin_scales),
+    block_spin_rule_(block_spin_rule),
+    correlation_(correlation),
+    disorder_(disorder),
+    seed_(seed) {}
+
+// Draw the disorder of a repetition, only for `Ising2DDisordered`.
+template <typename Lattice>
+inline void _Quench(Lattice &, const Disorder &, const unsigned int &) {}
+
+inline void _Quench(Ising2DDisordered & lattice, const Disorder & disorder, const unsigned int & seed)
+{
+    lattice.Quench(disorder, seed);
+}
+
+// Seed of the disorder of the `index`-th repetition (the same on all platforms).
+unsigned int _DisorderSeed(const int & seed, const size_t & size, const size_t & index)
+{
+    seed_seq sequence{ static_cast<unsigned int>(seed), static_cast<unsigned int>(size),
+        static_cast<unsigned int>(index) };
+    unsigned int disorder_seed = 0;
+    sequence.generate(&disorder_seed, &disorder_seed + 1);
+    return disorder_seed;
+}
+
+size_t SimulationUnit::Allocate()
+{
+    auto first = result_list_.size();
+    if (first < repetitions_)
+    {
+        result_list_.resize(repetitions_);
+        block_spin_result_list_.resize(repetitions_);
+        if (correlation_)
+            correlation_list_.resize(repetitions_);
+    }
+    return first;
+}
+
+template <typename Lattice>
+void SimulationUnit::RunRepetition(const size_t & index, const double & temperature,
+    const double & magnetic_h, const size_t & iterations, const size_t & n_ensemble,
+    const size_t & n_delta, Progress * progress)
+{
+    Lattice cell(lattice_size_);
+    cell.Initialize();
+    _Quench(cell, disorder_, _DisorderSeed(seed_, lattice_size_, index));
+    BlockSpinMeasurement block_spin(block_spin_scales_, block_spin_rule_);
+    CorrelationMeasurement correlation;
+    result_list_[index] = cell.Evaluate(1.0 / temperature, magnetic_h, iterations, n_ensemble,
+        n_delta, block_spin.Empty() ? nullptr : &block_spin, correlation_ ? &correlation : nullptr);
+    block_spin_result_list_[index] = block_spin.Result();
+    if (correlation_)
+        correlation_list_[index] = correlation.Result();
+#ifdef ISING_PARALLEL
+#pragma omp critical
+#endif
+    ISING_COUNT(counters_ += cell.Counters());
+    if (progress)
+        progress->Advance(iterations, iterations * cell.SiteCount());
+}
+
+// Seed of the random stream of a replica (the same on all platforms).
+unsigned int _ReplicaSeed(const int & seed, const size_t & size, const size_t & index,
+    const double & temperature, const double & magnetic_h)
+{
+    uint64_t t = 0, h = 0;
+    memcpy(&t, &temperature, sizeof(t));
+    memcpy(&h, &magnetic_h, sizeof(h));
+    seed_seq sequence{ static_cast<unsigned int>(seed), static_cast<unsigned int>(size),
+        static_cast<unsigned int>(index), static_cast<unsigned int>(t),
+        static_cast<unsigned int>(t >> 32), static_cast<unsigned int>(h),
+        static_cast<unsigned int>(h >> 32) };
+    unsigned int replica_seed = 0;
+    sequence.generate(&replica_seed, &replica_seed + 1);
+    return replica_seed;
+}
+
+template <size_t kLanes>
+void SimulationUnit::RunReplicas(const vector<Replica> & replicas, const size_t & iterations,
+    const size_t & n_ensemble, const size_t & n_delta, Progress * progress)
+{
+    const auto kCount = replicas.size();
+    vector<ReplicaLane> lanes;
+    vector<BlockSpinMeasurement> block_spin;
+    vector<CorrelationMeasurement> correlation(kCount);
+    for (auto & replica : replicas)
+    {
+        auto & unit = *replica.unit;
+        lanes.push_back({ 1.0 / replica.temperature, replica.magnetic_h, _ReplicaSeed(unit.seed_,
+            unit.lattice_size_, replica.index, replica.temperature, replica.magnetic_h) });
+        block_spin.emplace_back(unit.block_spin_scales_, unit.block_spin_rule_);
+    }
+    vector<BlockSpinMeasurement *> block_spin_lanes;
+    vector<CorrelationMeasurement *> correlation_lanes;
+    for (size_t r = 0; r != kCount; ++r)
+    {
+        block_spin_lanes.push_back(block_spin[r].Empty() ? nullptr : &block_spin[r]);
+        correlation_lanes.push_back(replicas[r].unit->correlation_ ? &correlation[r] : nullptr);
+    }
+
+    Ising2DReplicas<kLanes> cells(replicas.front().unit->lattice_size_);
+    cells.Initialize(lanes);
+    auto results = cells.Evaluate(iterations, n_ensemble, n_delta, block_spin_lanes,
+        correlation_lanes);
+
+    // Each lane takes its share of the counters.
+    auto counters = cells.Counters();
+    counters.rand_draws    /= kCount;
+    counters.analyses      /= kCount;
+    counters.sweep_time    /= kCount;
+    counters.analysis_time /= kCount;
+    for (size_t r = 0; r != kCount; ++r)
+    {
+        auto & unit = *replicas[r].unit;
+        auto index = replicas[r].index;
+        unit.result_list_[index] = results[r];
+        unit.block_spin_result_list_[index] = block_spin[r].Result();
+        if (unit.correlation_)
+            unit.correlation_list_[index] = correlation[r].Result();
+#ifdef ISING_PARALLEL
+#pragma omp critical
+#endif
+        ISING_COUNT(unit.counters_ += counters);
+        if (progress)
+            progress->Advance(iterations, iterations * cells.SiteCount());
+    }
+}
 
-void SimulationUnit::Run(const double & temperature, const double & magnetic_h,
-    const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta)
+void SimulationUnit::Preload(const vector<StoredRepetition> & repetitions)
 {
-    Observable result;
-    for (auto & cell : eval_list_)
+    for (auto & repetition : repetitions)
     {
-        cell.Initialize();
-        result = cell.Evaluate(1.0 / temperature, magnetic_h, iterations, n_ensemble, n_delta);
-        result_list_.push_back(result);
+        result_list_.push_back(repetition.result);
+        block_spin_result_list_.push_back(repetition.block_spin_result);
+        if (correlation_)
+            correlation_list_.push_back(repetition.correlation);
     }
+    preloaded_count_ = repetitions.size();
+}
+
+vector<StoredRepetition> SimulationUnit::NewRepetitions(const int & seed) const
+{
+    vector<StoredRepetition> repetitions;
+    for (size_t i = preloaded_count_; i < result_list_.size(); ++i)
+        repetitions.push_back({ seed, result_list_[i], block_spin_result_list_[i],
+            correlation_ ? correlation_list_[i] : Correlation() });
+    return repetitions;
 }
 
 Simulation::Simulation(const Parameter & param) :
@@ -44,58 +209,565 @@ Simulation::Simulation(const Parameter & param) :
     n_ensemble_(param.n_ensemble),
     n_delta_(param.n_delta),
     repetitions_(param.repetitions),
+    dimension_(param.dimension),
+    boundary_condition_(param.boundary_condition),
+    status_file_(param.status_file),
+    block_spin_scales_(param.block_spin_scales),
+    block_spin_rule_(param.block_spin_rule),
+    correlation_(param.correlation),
+    disorder_(param.disorder),
+    n_fold_temperature_(param.n_fold_temperature),
+    replica_lanes_(param.replica_lanes),
+    adaptive_max_count_(param.adaptive_max_count),
+    adaptive_tolerance_(param.adaptive_tolerance),
+    adaptive_min_step_(param.adaptive_min_step),
+    seed_(param.seed),
     size_list_size_(size_list_.size()),
     eval_cell_num_(temperature_list_.size() * magnetic_h_list_.size()),
-    // Initialize `eval_list_` and `result_list_` with correct dimensions.
+    // Initialize `eval_list_` with correct dimensions.
     eval_list_(size_list_size_, vector<SimulationUnit>(eval_cell_num_)),
-    result_list_(size_list_size_,
-        vector<vector<Observable>>(eval_cell_num_, vector<Observable>(repetitions_)))
+    result_store_(param.result_store),
+    result_store_good_(true)
 {
     // Initialize `eval_list_` with correct `size` parameter.
     for (size_t i = 0; i != size_list_size_; ++i)
         for (size_t j = 0; j != eval_cell_num_; ++j)
-            eval_list_[i][j] = SimulationUnit(repetitions_, size_list_[i]);
+            eval_list_[i][j] = SimulationUnit(repetitions_, size_list_[i],
+                block_spin_scales_, block_spin_rule_, correlation_, disorder_, seed_);
 }
 
 int Simulation::Run()
 {
     PrintParameters(cerr);
+    if (ReplaysStoredSeed())
+        return 1;
+    FastRandInitialize(seed_);
+    // Cells are written by the output thread as soon as they are completed.
+    json_output_.reset(new JsonArrayStream(cout));
     Simulate();
-    PrintResults(cout);
+    json_output_->Close();
+
+    if (!result_store_good_)
+    {
+        cerr << "Failed to write the result store " << result_store_.FileName() << "." << endl;
+        return 1;
+    }
+    return 0;
+}
+
+bool Simulation::ReplaysStoredSeed() const
+{
+    if (result_store_.Enabled() == false)
+        return false;
+    for (auto size : size_list_)
+        for (auto h : magnetic_h_list_)
+            for (auto t : StoredTemperatures(size, h))
+            {
+                auto & repetitions = result_store_.Find(Key(size, t, h));
+                if (repetitions.size() >= repetitions_)
+                    continue;
+                for (auto & repetition : repetitions)
+                {
+                    if (repetition.seed == seed_)
+                    {
+                        cerr << "The result store " << result_store_.FileName()
+                             << " has repetitions of the seed " << seed_ << " for "
+                             << Key(size, t, h).String() << "." << endl
+                             << "Use another \"seed\" to add repetitions to it." << endl;
+                        return true;
+                    }
+                }
+            }
+    return false;
+}
+
+int Simulation::RunExport()
+{
+    if (result_store_.Enabled() == false)
+    {
+        cerr << "No result store is given (\"resultStore.file\")." << endl;
+        return 1;
+    }
+
+    size_t index = 0;
+    json_output_.reset(new JsonArrayStream(cout));
+    for (auto size : size_list_)
+        for (auto h : magnetic_h_list_)
+            for (auto t : StoredTemperatures(size, h))
+            {
+                SimulationUnit unit(0, size, block_spin_scales_, block_spin_rule_, correlation_,
+                    disorder_, seed_);
+                unit.Preload(result_store_.Find(Key(size, t, h)));
+                if (unit.Result().empty() == false)
+                    WriteCell(index++, size, t, h, unit);
+            }
+    json_output_->Close();
+
+    return 0;
+}
+
+int Simulation::RunAnalysis()
+{
+    if (result_store_.Enabled() == false)
+    {
+        cerr << "No result store is given (\"resultStore.file\")." << endl;
+        return 1;
+    }
+
+    rapidjson::Document doc;
+    auto & doc_allocator = doc.GetAllocator();
+    rapidjson::Value cells_val(rapidjson::Type::kArrayType);
+    rapidjson::Value crossings_val(rapidjson::Type::kArrayType);
+    rapidjson::Value collapse_val(rapidjson::Type::kArrayType);
+
+    cerr << endl << InformationSeparator() << endl
+         << "* Finite-size scaling of " << result_store_.FileName() << endl;
+    for (auto h : magnetic_h_list_)
+    {
+        // 1st dimension: size (with cells)
+        // 2nd dimension: temperature
+        vector<size_t> sizes;
+        vector<vector<GridPoint>> susceptibility, binder_cumulant;
+        size_t cell_count = 0;
+        for (auto size : size_list_)
+        {
+            const auto kSites = static_cast<double>(dimension_ == 3 ? size * size * size : size * size);
+            vector<GridPoint> chi, u4;
+            for (auto t : StoredTemperatures(size, h))
+            {
+                auto & repetitions = result_store_.Find(Key(size, t, h));
+                if (repetitions.empty())
+                    continue;
+                vector<Observable> results;
+                for (auto & repetition : repetitions)
+                    results.push_back(repetition.result);
+                auto response = EstimateResponse(t, results, kSites);
+                chi.push_back(response.susceptibility);
+                u4.push_back(response.binder_cumulant);
+
+                rapidjson::Value cell_val(rapidjson::Type::kObjectType);
+                cell_val.AddMember("size", size, doc_allocator);
+                cell_val.AddMember("temperature", t, doc_allocator);
+                cell_val.AddMember("externalMagneticField", h, doc_allocator);
+                cell_val.AddMember("repetitions", results.size(), doc_allocator);
+                cell_val.AddMember("specificHeat", response.specific_heat.value, doc_allocator);
+                cell_val.AddMember("specificHeat.Error", response.specific_heat.error, doc_allocator);
+                cell_val.AddMember("susceptibility", response.susceptibility.value, doc_allocator);
+                cell_val.AddMember("susceptibility.Error", response.susceptibility.error, doc_allocator);
+                cell_val.AddMember("binderCumulant", response.binder_cumulant.value, doc_allocator);
+                cell_val.AddMember("binderCumulant.Error", response.binder_cumulant.error, doc_allocator);
+                cells_val.PushBack(cell_val, doc_allocator);
+                cell_count += 1;
+            }
+            if (u4.empty() == false)
+            {
+                sizes.push_back(size);
+                susceptibility.push_back(chi);
+                binder_cumulant.push_back(u4);
+            }
+        }
+        cerr << "*" << endl
+             << "*   H = " << h << ": " << cell_count << " cells" << endl;
+
+        // Crossings of successive sizes.
+        double crossing_sum = 0.0;
+        size_t crossing_count = 0;
+        for (size_t i = 0; i + 1 < sizes.size(); ++i)
+        {
+            BinderCrossing crossing;
+            if (!FindBinderCrossing(binder_cumulant[i], binder_cumulant[i + 1], crossing))
+                continue;
+            crossing_sum += crossing.temperature;
+            crossing_count += 1;
+            cerr << "*   U_4 crossing L = " << sizes[i] << ", " << sizes[i + 1] << ": T = "
+                 << crossing.temperature << " +- " << crossing.error << endl;
+
+            rapidjson::Value crossing_val(rapidjson::Type::kObjectType);
+            rapidjson::Value sizes_val(rapidjson::Type::kArrayType);
+            sizes_val.PushBack(sizes[i], doc_allocator).PushBack(sizes[i + 1], doc_allocator);
+            crossing_val.AddMember("externalMagneticField", h, doc_allocator);
+            crossing_val.AddMember("sizes", sizes_val, doc_allocator);
+            crossing_val.AddMember("temperature", crossing.temperature, doc_allocator);
+            crossing_val.AddMember("temperature.Error", crossing.error, doc_allocator);
+            crossings_val.PushBack(crossing_val, doc_allocator);
+        }
+
+        // The scaling forms hold at H = 0 only.
+        if (h != 0.0 || sizes.size() < 2)
+            continue;
+        // Tc and nu from U_4 (starting from the crossings, or the susceptibility peak of the
+        //   largest size), then gamma / nu from chi.
+        CollapseFit start;
+        if (crossing_count != 0)
+            start.critical_temperature = crossing_sum / crossing_count;
+        else
+            start.critical_temperature = max_element(susceptibility.back().begin(),
+                susceptibility.back().end(), [](const GridPoint & a, const GridPoint & b)
+                { return a.value < b.value; })->temperature;
+        auto scaling = FitCollapse(sizes, binder_cumulant, start, true, false);
+        start = scaling;
+        start.exponent = 1.0;
+        auto exponent = FitCollapse(sizes, susceptibility, start, false, true);
+        cerr << "*   Data collapse: Tc = " << scaling.critical_temperature
+             << " +- " << scaling.critical_temperature_error
+             << ", nu = " << scaling.nu << " +- " << scaling.nu_error
+             << ", gamma / nu = " << exponent.exponent << " +- " << exponent.exponent_error << endl
+             << "*     (quality U_4 " << scaling.quality << ", chi " << exponent.quality << ")" << endl;
+
+        rapidjson::Value fit_val(rapidjson::Type::kObjectType);
+        fit_val.AddMember("externalMagneticField", h, doc_allocator);
+        fit_val.AddMember("criticalTemperature", scaling.critical_temperature, doc_allocator);
+        fit_val.AddMember("criticalTemperature.Error", scaling.critical_temperature_error, doc_allocator);
+        fit_val.AddMember("nu", scaling.nu, doc_allocator);
+        fit_val.AddMember("nu.Error", scaling.nu_error, doc_allocator);
+        fit_val.AddMember("gammaOverNu", exponent.exponent, doc_allocator);
+        fit_val.AddMember("gammaOverNu.Error", exponent.exponent_error, doc_allocator);
+        fit_val.AddMember("quality.BinderCumulant", scaling.quality, doc_allocator);
+        fit_val.AddMember("quality.Susceptibility", exponent.quality, doc_allocator);
+        collapse_val.PushBack(fit_val, doc_allocator);
+    }
+    cerr << InformationSeparator() << endl << endl;
+
+    rapidjson::Value analysis_val(rapidjson::Type::kObjectType);
+    analysis_val.AddMember("cells", cells_val, doc_allocator);
+    analysis_val.AddMember("binderCrossings", crossings_val, doc_allocator);
+    analysis_val.AddMember("dataCollapse", collapse_val, doc_allocator);
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    analysis_val.Accept(writer);
+    cout << buffer.GetString() << endl;
 
     return 0;
 }
 
+vector<double> Simulation::StoredTemperatures(const size_t & size, const double & magnetic_h) const
+{
+    // With the adaptive grid, all the stored temperatures in the range.
+    if (adaptive_max_count_ == 0 || temperature_list_.empty())
+        return temperature_list_;
+    vector<double> temperatures;
+    for (auto t : result_store_.Temperatures(Key(size, 0.0, magnetic_h)))
+        if (t >= temperature_list_.front() && t <= temperature_list_.back())
+            temperatures.push_back(t);
+    return temperatures;
+}
+
+CellKey Simulation::Key(const size_t & size, const double & temperature,
+    const double & magnetic_h) const
+{
+    return { dimension_, boundary_condition_, size, temperature, magnetic_h,
+        iterations_, n_ensemble_, n_delta_, block_spin_scales_, block_spin_rule_, correlation_,
+        disorder_ };
+}
+
 void Simulation::Simulate()
+{
+    AsyncWriter output;
+    if (disorder_.Enabled())
+    {
+        Simulate<Ising2DDisordered>(output);
+        return;
+    }
+    if (dimension_ == 3)
+    {
+        Simulate<Ising3D<>>(output);
+        return;
+    }
+    switch (boundary_condition_)
+    {
+    case kFree:
+        Simulate<Ising2D_FBC>(output);
+        break;
+    case kAntiperiodic:
+        Simulate<Ising2D_APBC>(output);
+        break;
+    default:
+        Simulate<Ising2D_PBC>(output);
+    }
+}
+
+template <typename Lattice>
+void Simulation::RunTasks(const vector<SimulationUnit::Replica> & tasks, const size_t & size,
+    Progress & progress, const function<void(const size_t &)> & done)
+{
+    auto batches = Batch<Lattice>(tasks);
+    // OpenMP for need signed integer.
+    const int batch_count = static_cast<int>(batches.size());
+#ifdef ISING_PARALLEL
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int b = 0; b < batch_count; ++b)
+    {
+        auto & batch = batches[b];
+        if (batch.size() == 1)
+        {
+            auto & task = tasks[batch.front()];
+            RunRepetition<Lattice>(*task.unit, task.index, size, task.temperature,
+                task.magnetic_h, progress);
+        }
+        else
+        {
+            vector<SimulationUnit::Replica> replicas;
+            for (auto k : batch)
+                replicas.push_back(tasks[k]);
+            if (replicas.size() <= 16)
+                SimulationUnit::RunReplicas<16>(replicas, iterations_, n_ensemble_, n_delta_, &progress);
+            else if (replicas.size() <= 32)
+                SimulationUnit::RunReplicas<32>(replicas, iterations_, n_ensemble_, n_delta_, &progress);
+            else
+                SimulationUnit::RunReplicas<64>(replicas, iterations_, n_ensemble_, n_delta_, &progress);
+        }
+        for (auto k : batch)
+            done(k);
+    }
+}
+
+template <typename Lattice>
+vector<vector<size_t>> Simulation::Batch(const vector<SimulationUnit::Replica> & tasks) const
+{
+    vector<vector<size_t>> batches;
+    for (size_t k = 0; k != tasks.size(); ++k)
+        batches.push_back({ k });
+    return batches;
+}
+
+// Number of the threads running the batches of `RunTasks()`.
+size_t _BatchThreadCount()
+{
+#if defined ISING_PARALLEL && defined _OPENMP
+    return static_cast<size_t>(omp_get_max_threads());
+#else
+    return 1;
+#endif
+}
+
+// The tasks above the n-fold way run as lanes of `Ising2DReplicas`, in batches of even sizes up
+//   to `replica_lanes_`. A lane costs about a quarter of a site update of `Ising2D`, but a batch
+//   runs on a single thread, so there are at least as many batches as threads, each of at least
+//   `kMinReplicaLanes` lanes. With fewer lanes than that, the tasks run one by one in parallel,
+//   since a thread left idle costs more than the lanes save.
+template <>
+vector<vector<size_t>> Simulation::Batch<Ising2D_PBC>(const vector<SimulationUnit::Replica> & tasks) const
+{
+    const size_t kMinReplicaLanes = 4;
+    const size_t kMaxReplicaLanes = 64;
+    const auto kThreadCount = _BatchThreadCount();
+
+    vector<vector<size_t>> batches;
+    vector<size_t> lanes;
+    for (size_t k = 0; k != tasks.size(); ++k)
+    {
+        if (tasks[k].temperature < n_fold_temperature_ || replica_lanes_ < 2)
+            batches.push_back({ k });
+        else
+            lanes.push_back(k);
+    }
+    if (lanes.size() < kMinReplicaLanes * kThreadCount)
+    {
+        for (auto k : lanes)
+            batches.push_back({ k });
+        return batches;
+    }
+    auto max_lanes = min(replica_lanes_, kMaxReplicaLanes);
+    auto count = max((lanes.size() + max_lanes - 1) / max_lanes, kThreadCount);
+    for (size_t b = 0; b != count; ++b)
+        batches.emplace_back(lanes.begin() + lanes.size() * b / count,
+            lanes.begin() + lanes.size() * (b + 1) / count);
+    return batches;
+}
+
+template <typename Lattice>
+void Simulation::RunRepetition(SimulationUnit & unit, const size_t & index, const size_t &,
+    const double & temperature, const double & magnetic_h, Progress & progress)
+{
+    unit.RunRepetition<Lattice>(index, temperature, magnetic_h,
+        iterations_, n_ensemble_, n_delta_, &progress);
+}
+
+// Runs a repetition with the engine chosen by `RunPeriodic2D()`.
+struct _RepetitionRunner
+{
+    SimulationUnit & unit;
+    size_t           index;
+    double           temperature;
+    double           magnetic_h;
+    size_t           iterations;
+    size_t           n_ensemble;
+    size_t           n_delta;
+    Progress *       progress;
+
+    template <typename Lattice>
+    void Run()
+    {
+        unit.RunRepetition<Lattice>(index, temperature, magnetic_h,
+            iterations, n_ensemble, n_delta, progress);
+    }
+};
+
+// Low temperatures use the n-fold way, where nearly all the Metropolis steps are rejected.
+// Small periodic lattices use the bit-packed engines of fixed size.
+template <>
+void Simulation::RunRepetition<Ising2D_PBC>(SimulationUnit & unit, const size_t & index,
+    const size_t & size, const double & temperature, const double & magnetic_h, Progress & progress)
+{
+    if (temperature < n_fold_temperature_)
+    {
+        unit.RunRepetition<Ising2DNFold>(index, temperature, magnetic_h,
+            iterations_, n_ensemble_, n_delta_, &progress);
+        return;
+    }
+    _RepetitionRunner runner{ unit, index, temperature, magnetic_h,
+        iterations_, n_ensemble_, n_delta_, &progress };
+    RunPeriodic2D(size, runner);
+}
+
+template <typename Lattice>
+void Simulation::Simulate(AsyncWriter & output)
 {
     const auto kTemperatureListSize = temperature_list_.size();
     Timing run_clock;
 
-    for (size_t i = 0; i != size_list_size_; ++i)
+    // The cost of a cell is proportional to (sweeps * L^d).
+    // The adaptive grid is counted with its full budget, and may finish earlier.
+    auto cell_num = eval_cell_num_;
+    if (adaptive_max_count_ > temperature_list_.size())
+        cell_num = adaptive_max_count_ * magnetic_h_list_.size();
+    size_t total_work = 0;
+    for (auto size : size_list_)
+        total_work += cell_num * repetitions_ * iterations_
+                    * (dimension_ == 3 ? size * size * size : size * size);
+    Progress progress(size_list_size_ * cell_num, total_work, status_file_);
+
+    cerr << "Running..." << endl;
+    run_clock.TimingBegin();
+    progress.Start();
+    if (adaptive_max_count_ != 0)
+        SimulateAdaptive<Lattice>(output, progress);
+    else
     {
-        cerr << "Running on size " << size_list_[i] << "..." << endl;
+        for (size_t i = 0; i != size_list_size_; ++i)
+        {
+            // Each cell is written by the thread completing its last repetition, and not
+            //   touched afterwards.
+            auto complete = [this, &progress, &output, i, kTemperatureListSize](const size_t & j)
+            {
+                auto t = temperature_list_[j % kTemperatureListSize];
+                auto h = magnetic_h_list_[j / kTemperatureListSize];
+                progress.Complete();
+                output.Push([this, i, j, t, h]
+                    { WriteCell(i * eval_cell_num_ + j, size_list_[i], t, h, eval_list_[i][j]); });
+            };
+
+            // The missing repetitions (e.g. the disorder samples), and their cells.
+            vector<SimulationUnit::Replica> tasks;
+            vector<size_t> task_cells;
+            vector<atomic<size_t>> remaining(eval_cell_num_);
+            for (size_t j = 0; j != eval_cell_num_; ++j)
+            {
+                auto & eval = eval_list_[i][j];
+                auto t = temperature_list_[j % kTemperatureListSize];
+                auto h = magnetic_h_list_[j / kTemperatureListSize];
+                if (result_store_.Enabled())
+                    eval.Preload(result_store_.Find(Key(size_list_[i], t, h)));
+                auto first = eval.Allocate();
+                remaining[j] = first < repetitions_ ? repetitions_ - first : 0;
+                for (auto k = first; k < repetitions_; ++k)
+                {
+                    tasks.push_back({ &eval, k, t, h });
+                    task_cells.push_back(j);
+                }
+                if (remaining[j] == 0)
+                    complete(j);
+            }
+            RunTasks<Lattice>(tasks, size_list_[i], progress, [&](const size_t & k)
+            {
+                if (remaining[task_cells[k]].fetch_sub(1) == 1)
+                    complete(task_cells[k]);
+            });
+        }
+    }
+    // The tail of the output.
+    output.Finish();
+    progress.Stop();
+    run_clock.TimingEnd();
 
-        run_clock.TimingBegin();
-#ifdef ISING_PARALLEL
-#pragma omp parallel for
-#endif
-        // OpenMP for need signed integer.
-        for (int j = 0; j < eval_cell_num_; ++j)
+    cerr << "Finished!" << endl
+         << "Running time: " << run_clock.GetRunningTime() << "s." << endl << endl;
+}
+
+// Specific heat and susceptibility (per site) of the cells, with the standard errors over the
+//   repetitions.
+vector<vector<GridPoint>> _ResponseCurves(const map<double, SimulationUnit> & cells,
+    const double & sites)
+{
+    vector<vector<GridPoint>> curves(2);
+    for (auto & cell : cells)
+    {
+        auto response = EstimateResponse(cell.first, cell.second.Result(), sites);
+        curves[0].push_back(response.specific_heat);
+        curves[1].push_back(response.susceptibility);
+    }
+    return curves;
+}
+
+template <typename Lattice>
+void Simulation::SimulateAdaptive(AsyncWriter & output, Progress & progress)
+{
+    size_t index = 0;
+    for (size_t i = 0; i != size_list_size_; ++i)
+    {
+        const auto kSize = size_list_[i];
+        const auto kSites = static_cast<double>(dimension_ == 3 ? kSize * kSize * kSize : kSize * kSize);
+        for (auto h : magnetic_h_list_)
         {
-            auto & eval = eval_list_[i][j];
-            auto t = temperature_list_[j % kTemperatureListSize];
-            auto h = magnetic_h_list_[j / kTemperatureListSize];
-            eval.Run(t, h, iterations_, n_ensemble_, n_delta_);
-            result_list_[i][j] = eval.Result();
+            // Cells sorted by temperature.
+            map<double, SimulationUnit> cells;
+            auto temperatures = temperature_list_;
+            while (temperatures.empty() == false)
+            {
+                vector<SimulationUnit> units(temperatures.size(),
+                    SimulationUnit(repetitions_, kSize, block_spin_scales_, block_spin_rule_,
+                        correlation_, disorder_, seed_));
+                vector<SimulationUnit::Replica> tasks;
+                vector<size_t> task_units;
+                vector<atomic<size_t>> remaining(temperatures.size());
+                for (size_t k = 0; k != temperatures.size(); ++k)
+                {
+                    if (result_store_.Enabled())
+                        units[k].Preload(result_store_.Find(Key(kSize, temperatures[k], h)));
+                    auto first = units[k].Allocate();
+                    remaining[k] = first < repetitions_ ? repetitions_ - first : 0;
+                    for (auto r = first; r < repetitions_; ++r)
+                    {
+                        tasks.push_back({ &units[k], r, temperatures[k], h });
+                        task_units.push_back(k);
+                    }
+                    if (remaining[k] == 0)
+                        progress.Complete();
+                }
+                RunTasks<Lattice>(tasks, kSize, progress, [&](const size_t & k)
+                {
+                    if (remaining[task_units[k]].fetch_sub(1) == 1)
+                        progress.Complete();
+                });
+                for (size_t k = 0; k != temperatures.size(); ++k)
+                    cells[temperatures[k]] = units[k];
+
+                auto budget = adaptive_max_count_ > cells.size() ? adaptive_max_count_ - cells.size() : 0;
+                temperatures = RefineTemperatureGrid(_ResponseCurves(cells, kSites),
+                    adaptive_tolerance_, adaptive_min_step_, budget);
+            }
 
-            PrintProgress(eval_cell_num_, j + 1);
+            for (auto & cell : cells)
+            {
+                auto t = cell.first;
+                auto unit = cell.second;
+                output.Push([this, index, kSize, t, h, unit]
+                    { WriteCell(index, kSize, t, h, unit); });
+                ++index;
+            }
         }
-        run_clock.TimingEnd();
-        cerr << endl
-             << "Running time: " << run_clock.GetRunningTime() << "s." << endl << endl;
     }
-    
-    cerr << "Finished!" << endl;
 }
 
 void Simulation::PrintParameters(std::ostream & os)
@@ -106,10 +778,10 @@ void Simulation::PrintParameters(std::ostream & os)
        << "*" << endl
        << "* Parameters:" << endl;
 
+    os << "*   Dimension:          "
+       << dimension_ << endl;
     os << "*   Boundary condition: "
-       // TODO: use only Periodic boundary condition now.
-       // << (param.boundary_condition == kPeriodic ? "Periodic" : "Free") << endl
-       << "Periodic" << endl;
+       << BoundaryConditionName(boundary_condition_) << endl;
 
     os << "*   Size list:" << endl
        << "*     ";
@@ -125,6 +797,45 @@ void Simulation::PrintParameters(std::ostream & os)
        << "*     "
        << magnetic_h_list_.front() << " -- " << magnetic_h_list_.back() << endl;
 
+    if (result_store_.Enabled())
+        os << "*   Result store:       "
+           << result_store_.FileName() << " (seed " << seed_ << ")" << endl;
+
+    if (adaptive_max_count_ != 0)
+        os << "*   Adaptive grid:      "
+           << "up to " << adaptive_max_count_ << " temperatures, tolerance "
+           << adaptive_tolerance_ << ", min step " << adaptive_min_step_ << endl;
+
+    if (block_spin_scales_.empty() == false)
+    {
+        os << "*   Block-spin scales (" << BlockRuleName(block_spin_rule_) << "):" << endl
+           << "*     ";
+        for (auto i : block_spin_scales_)
+            os << i << " ";
+        os << endl;
+    }
+
+    if (disorder_.Enabled())
+        os << "*   Disorder:           "
+           << "J = -1 with p = " << disorder_.bond_probability
+           << ", vacancies " << disorder_.dilution
+           << ", random field +-" << disorder_.random_field
+           << " (" << disorder_.field_classes << " classes)" << endl
+           << "*                       repetitions are disorder samples" << endl;
+    else if (dimension_ == 2 && boundary_condition_ == kPeriodic)
+    {
+        if (n_fold_temperature_ > temperature_list_.front())
+            os << "*   N-fold way:         "
+               << "below T = " << n_fold_temperature_ << endl;
+        if (replica_lanes_ > 1)
+            os << "*   Replicas:           "
+               << "up to " << min(replica_lanes_, size_t(64)) << " lanes in lockstep" << endl;
+    }
+
+    if (correlation_)
+        os << "*   Correlations:       "
+           << "G(r), S(k), second-moment length (FFT)" << endl;
+
     os << "*   Iterations:         "
        << iterations_ << endl
        << "*   Repetitions:        "
@@ -141,60 +852,147 @@ void Simulation::PrintParameters(std::ostream & os)
 #else
        << "Off" << endl
 #endif
+       << "*   Instruction set:    "
+       << CpuPathName(ActiveCpuPath()) << endl
        << InformationSeparator() << endl << endl;
 }
 
-void Simulation::PrintResults(ostream & os)
+// Add the observables of all the repetitions to `val` (an object).
+void _AddObservables(rapidjson::Value & val, const vector<Observable> & result_list,
+    rapidjson::Document::AllocatorType & allocator)
 {
-    const auto kTemperatureListSize = temperature_list_.size();
+    rapidjson::Value magnetic_dipole(rapidjson::Type::kArrayType);
+    rapidjson::Value magnetic_dipole_abs(rapidjson::Type::kArrayType);
+    rapidjson::Value magnetic_dipole_square(rapidjson::Type::kArrayType);
+    rapidjson::Value energy(rapidjson::Type::kArrayType);
+    rapidjson::Value energy_square(rapidjson::Type::kArrayType);
+    rapidjson::Value magnetic_dipole_fourth(rapidjson::Type::kArrayType);
+    rapidjson::Value energy_fourth(rapidjson::Type::kArrayType);
+
+    for (auto result : result_list)
+    {
+        magnetic_dipole.PushBack(result.magnetic_dipole, allocator);
+        magnetic_dipole_abs.PushBack(result.magnetic_dipole_abs, allocator);
+        magnetic_dipole_square.PushBack(result.magnetic_dipole_square, allocator);
+        energy.PushBack(result.energy, allocator);
+        energy_square.PushBack(result.energy_square, allocator);
+        magnetic_dipole_fourth.PushBack(result.magnetic_dipole_fourth, allocator);
+        energy_fourth.PushBack(result.energy_fourth, allocator);
+    }
+
+    val.AddMember("magneticDipole", magnetic_dipole, allocator);
+    val.AddMember("magneticDipole.Abs", magnetic_dipole_abs, allocator);
+    val.AddMember("magneticDipole.Square", magnetic_dipole_square, allocator);
+    val.AddMember("energy", energy, allocator);
+    val.AddMember("energy.Square", energy_square, allocator);
+    val.AddMember("magneticDipole.Fourth", magnetic_dipole_fourth, allocator);
+    val.AddMember("energy.Fourth", energy_fourth, allocator);
+}
+
+// JSON array of `values`.
+rapidjson::Value _ArrayValue(const vector<double> & values,
+    rapidjson::Document::AllocatorType & allocator)
+{
+    rapidjson::Value val(rapidjson::Type::kArrayType);
+    for (auto value : values)
+        val.PushBack(value, allocator);
+    return val;
+}
 
-    rapidjson::Document doc(rapidjson::Type::kArrayType);
+void Simulation::WriteCell(const size_t & index, const size_t & size,
+    const double & temperature, const double & magnetic_h, const SimulationUnit & unit)
+{
+    rapidjson::Document doc;
     auto & doc_allocator = doc.GetAllocator();
 
-    for (size_t i = 0; i != size_list_size_; ++i)
-        for (size_t j = 0; j != eval_cell_num_; ++j)
-        {
-            rapidjson::Value cell_val(rapidjson::Type::kObjectType);
-
-            // Parameters.
-            cell_val.AddMember("size", size_list_[i], doc_allocator);
-            cell_val.AddMember("temperature",
-                temperature_list_[j % kTemperatureListSize], doc_allocator);
-            cell_val.AddMember("externalMagneticField ",
-                magnetic_h_list_[j / kTemperatureListSize], doc_allocator);
-
-            // Simulation results (observables)
-            rapidjson::Value magnetic_dipole(rapidjson::Type::kArrayType);
-            rapidjson::Value magnetic_dipole_abs(rapidjson::Type::kArrayType);
-            rapidjson::Value magnetic_dipole_square(rapidjson::Type::kArrayType);
-            rapidjson::Value energy(rapidjson::Type::kArrayType);
-            rapidjson::Value energy_square(rapidjson::Type::kArrayType);
-
-            for (auto result : result_list_[i][j])
-            {
-                magnetic_dipole.PushBack(result.magnetic_dipole, doc_allocator);
-                magnetic_dipole_abs.PushBack(result.magnetic_dipole_abs, doc_allocator);
-                magnetic_dipole_square.PushBack(result.magnetic_dipole_square, doc_allocator);
-                energy.PushBack(result.energy, doc_allocator);
-                energy_square.PushBack(result.energy_square, doc_allocator);
-            }
+#ifdef ISING_COUNTERS
+    // Time spent on building the JSON value of this cell.
+    Timing serialize_clock;
+    serialize_clock.TimingBegin();
+#endif
+    rapidjson::Value cell_val(rapidjson::Type::kObjectType);
+
+    // Parameters.
+    cell_val.AddMember("size", size, doc_allocator);
+    cell_val.AddMember("temperature", temperature, doc_allocator);
+    cell_val.AddMember("externalMagneticField ", magnetic_h, doc_allocator);
 
-            cell_val.AddMember("magneticDipole", magnetic_dipole, doc_allocator);
-            cell_val.AddMember("magneticDipole.Abs", magnetic_dipole_abs, doc_allocator);
-            cell_val.AddMember("magneticDipole.Square", magnetic_dipole_square, doc_allocator);
-            cell_val.AddMember("energy", energy, doc_allocator);
-            cell_val.AddMember("energy.Square", energy_square, doc_allocator);
+    // Simulation results (observables)
+    _AddObservables(cell_val, unit.Result(), doc_allocator);
 
-            // Add to the outer array.
-            doc.PushBack(cell_val, doc_allocator);
+    // Observables of the blocked lattices.
+    // 1st dimension: block-spin scale
+    // 2nd dimension (in each observable): repetition
+    if (block_spin_scales_.empty() == false)
+    {
+        rapidjson::Value block_spin_val(rapidjson::Type::kArrayType);
+        for (size_t k = 0; k != block_spin_scales_.size(); ++k)
+        {
+            vector<Observable> scale_result;
+            for (auto & result : unit.BlockSpinResult())
+                scale_result.push_back(result[k]);
+            rapidjson::Value scale_val(rapidjson::Type::kObjectType);
+            scale_val.AddMember("scale", block_spin_scales_[k], doc_allocator);
+            _AddObservables(scale_val, scale_result, doc_allocator);
+            block_spin_val.PushBack(scale_val, doc_allocator);
         }
+        cell_val.AddMember("blockSpin", block_spin_val, doc_allocator);
+    }
+
+    // Correlations.
+    // 1st dimension: repetition
+    // 2nd dimension (G(r), S(k)): shell of |r| (lattice spacings), |k| (2 pi / L)
+    if (correlation_)
+    {
+        rapidjson::Value length_val(rapidjson::Type::kArrayType);
+        rapidjson::Value function_val(rapidjson::Type::kArrayType);
+        rapidjson::Value structure_factor_val(rapidjson::Type::kArrayType);
+        for (auto & correlation : unit.CorrelationResult())
+        {
+            length_val.PushBack(correlation.length, doc_allocator);
+            function_val.PushBack(_ArrayValue(correlation.function, doc_allocator), doc_allocator);
+            structure_factor_val.PushBack(
+                _ArrayValue(correlation.structure_factor, doc_allocator), doc_allocator);
+        }
+        cell_val.AddMember("correlationLength.SecondMoment", length_val, doc_allocator);
+        cell_val.AddMember("correlationFunction", function_val, doc_allocator);
+        cell_val.AddMember("structureFactor", structure_factor_val, doc_allocator);
+    }
+
+#ifdef ISING_COUNTERS
+    auto counters = unit.Counters();
+    serialize_clock.TimingEnd();
+    counters.serialize_time += serialize_clock.GetRunningTime();
+
+    rapidjson::Value counters_val(rapidjson::Type::kObjectType);
+    rapidjson::Value acceptance_by_class(rapidjson::Type::kArrayType);
+    for (size_t k = 0; k != counters.class_count; ++k)
+    {
+        auto attempted = counters.attempted_by_class[k];
+        acceptance_by_class.PushBack(attempted == 0 ? 0.0 :
+            static_cast<double>(counters.accepted_by_class[k]) / attempted,
+            doc_allocator);
+    }
+    counters_val.AddMember("sweeps", counters.sweeps, doc_allocator);
+    counters_val.AddMember("analyses", counters.analyses, doc_allocator);
+    counters_val.AddMember("attemptedFlips", counters.AttemptedFlips(), doc_allocator);
+    counters_val.AddMember("acceptedFlips", counters.AcceptedFlips(), doc_allocator);
+    counters_val.AddMember("acceptanceByClass", acceptance_by_class, doc_allocator);
+    counters_val.AddMember("randDraws", counters.rand_draws, doc_allocator);
+    counters_val.AddMember("sweepTime", counters.sweep_time, doc_allocator);
+    counters_val.AddMember("analysisTime", counters.analysis_time, doc_allocator);
+    counters_val.AddMember("serializeTime", counters.serialize_time, doc_allocator);
+    cell_val.AddMember("counters", counters_val, doc_allocator);
+#endif
 
     rapidjson::StringBuffer buffer;
     rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-    doc.Accept(writer);
+    cell_val.Accept(writer);
+    json_output_->Put(index, buffer.GetString());
 
-    string json_str(buffer.GetString());
-    os << json_str << endl;
+    if (result_store_.Enabled())
+        result_store_good_ = result_store_.Append(Key(size, temperature, magnetic_h),
+            unit.NewRepetitions(seed_)) && result_store_good_;
 }
 
 int RunSimulation(const Parameter & param)
@@ -203,4 +1001,16 @@ int RunSimulation(const Parameter & param)
     return eval.Run();
 }
 
+int RunSimulationExport(const Parameter & param)
+{
+    Simulation eval(param);
+    return eval.RunExport();
+}
+
+int RunSimulationAnalysis(const Parameter & param)
+{
+    Simulation eval(param);
+    return eval.RunAnalysis();
+}
+
 ISING_NAMESPACE_END
@@ -1,12 +1,21 @@
 #ifndef ISING_CORE_SIMULATION_H_
 #define ISING_CORE_SIMULATION_H_
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "core/async-writer.h"
+#include "core/block-spin.h"
+#include "core/correlation.h"
+#include "core/counters.h"
 #include "core/ising.h"
 #include "core/ising-2d.h"
 #include "core/parameter.h"
+#include "core/progress.h"
+#include "core/result-store.h"
 
 // "Windows.h" should be put after "rapidjson/document.h".
 // See https://github.com/Tencent/rapidjson/issues/766
@@ -17,19 +26,68 @@ ISING_NAMESPACE_BEGIN
 
 // Each cell will be initialized with the same parameters (size, T, H).
 // Repeat the evaluation for `repetitions` times for calculating deviation etc.
+// With quenched disorder, each repetition is a disorder sample, drawn from (`seed`, size,
+//   index of the repetition), i.e. the same samples at all the temperatures and fields.
 class SimulationUnit
 {
 public:
     SimulationUnit() = default;
-    SimulationUnit(const size_t & repetitions, const size_t & lattice_size);
-    
-    void Run(const double & temperature, const double & magnetic_h,
-        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta);
-    inline std::vector<Observable> Result() { return result_list_; }
+    SimulationUnit(const size_t & repetitions, const size_t & lattice_size,
+        const std::vector<size_t> & block_spin_scales = std::vector<size_t>(),
+        const BlockRule & block_spin_rule = kMajority, const bool & correlation = false,
+        const Disorder & disorder = Disorder(), const int & seed = 0);
+
+    // Make room for the missing repetitions, and return the index of the first one.
+    size_t Allocate();
+    // Run the `index`-th repetition (after `Allocate()`). Different repetitions of a unit may
+    //   run in parallel.
+    // `Lattice` is an `Ising2D`, `Ising2DSmall`, `Ising2DDisordered` or `Ising3D`
+    //   instantiation, which fixes the dimension and the boundary condition.
+    // `progress` (if not null) is advanced after the repetition.
+    template <typename Lattice>
+    void RunRepetition(const size_t & index, const double & temperature, const double & magnetic_h,
+        const size_t & iterations, const size_t & n_ensemble, const size_t & n_delta,
+        toolkit::Progress * progress = nullptr);
+    // The `index`-th repetition of `unit` at (`temperature`, `magnetic_h`).
+    struct Replica
+    {
+        SimulationUnit * unit;
+        size_t           index;
+        double           temperature;
+        double           magnetic_h;
+    };
+    // Run up to `kLanes` repetitions of units of the same size (clean, 2D periodic) in lockstep
+    //   with `Ising2DReplicas<kLanes>`, one lane each. The random stream of a lane is drawn
+    //   from (`seed`, size, index of the repetition, T, H).
+    template <size_t kLanes>
+    static void RunReplicas(const std::vector<Replica> & replicas, const size_t & iterations,
+        const size_t & n_ensemble, const size_t & n_delta, toolkit::Progress * progress = nullptr);
+    // Start from stored repetitions, so that only the missing ones are computed.
+    void Preload(const std::vector<StoredRepetition> & repetitions);
+    // The repetitions computed by `RunRepetition()`, i.e. not preloaded.
+    std::vector<StoredRepetition> NewRepetitions(const int & seed) const;
+    inline std::vector<Observable> Result() const { return result_list_; }
+    // 1st dimension: repetition
+    // 2nd dimension: block-spin scale
+    inline std::vector<std::vector<Observable>> BlockSpinResult() const { return block_spin_result_list_; }
+    // Empty if the correlations are not measured.
+    inline std::vector<Correlation> CorrelationResult() const { return correlation_list_; }
+    // Counters summed over all repetitions.
+    inline KernelCounters Counters() const { return counters_; }
 
 private:
-    std::vector<Ising2D_PBC> eval_list_;
+    size_t                   repetitions_;
+    size_t                   lattice_size_;
+    std::vector<size_t>      block_spin_scales_;
+    BlockRule                block_spin_rule_;
     std::vector<Observable>  result_list_;
+    std::vector<std::vector<Observable>> block_spin_result_list_;
+    bool                     correlation_;
+    std::vector<Correlation> correlation_list_;
+    Disorder                 disorder_;
+    int                      seed_;
+    KernelCounters           counters_;
+    size_t                   preloaded_count_ = 0;
 };
 
 class Simulation
@@ -39,6 +97,12 @@ public:
     Simulation(const Parameter & param);
 
     int Run();
+    // Print the stored results of the cells (same format as `Run()`), without simulating.
+    int RunExport();
+    // Finite-size scaling of the stored cells (see "core/finite-size-scaling.h"): C_v, chi
+    //   and U_4 of each cell, the U_4 crossings of successive sizes, and the data collapse
+    //   (Tc, nu and gamma / nu) at H = 0. JSON on `cout`, and a summary on `cerr`.
+    int RunAnalysis();
 
 private:
     // Parameters and parameter lists.
@@ -49,6 +113,19 @@ private:
     const size_t              n_ensemble_;
     const size_t              n_delta_;
     const size_t              repetitions_;
+    const size_t              dimension_;
+    const BoundaryCondition   boundary_condition_;
+    const std::string         status_file_;
+    const std::vector<size_t> block_spin_scales_;
+    const BlockRule           block_spin_rule_;
+    const bool                correlation_;
+    const Disorder            disorder_;
+    const double              n_fold_temperature_;
+    const size_t              replica_lanes_;
+    const size_t              adaptive_max_count_;
+    const double              adaptive_tolerance_;
+    const double              adaptive_min_step_;
+    const int                 seed_;
 
     // The size (length) of `size_list_`
     const size_t size_list_size_;
@@ -58,20 +135,60 @@ private:
     // 1st dimension: size
     // 2nd dimension: T * B
     // 3rd dimension (in `SimulationUnit`): repetition
+    // Not used with the adaptive temperature grid.
     std::vector<std::vector<SimulationUnit>> eval_list_;
 
-    // 1st dimension: size
-    // 2nd dimension: T * B
-    // 3rd dimension: repetition
-    std::vector<std::vector<std::vector<Observable>>> result_list_;
-    
+    // The cells (JSON) in order, on `cout`.
+    std::unique_ptr<toolkit::JsonArrayStream> json_output_;
+
+    // Cells start from the stored repetitions, and the new ones are appended (if enabled).
+    ResultStore result_store_;
+    // Written by the output thread.
+    bool        result_store_good_;
+
+    // Dispatch on `dimension_`, `boundary_condition_` and `disorder_` once per run.
     void Simulate();
+    // The cells of a size and their missing repetitions run in parallel. Completed cells are
+    //   handed to `output`.
+    template <typename Lattice>
+    void Simulate(toolkit::AsyncWriter & output);
+    // Refine the temperature grid of each size and field, see "core/adaptive-grid.h".
+    // The cells of a (size, field) are handed to `output` when its grid is complete.
+    template <typename Lattice>
+    void SimulateAdaptive(toolkit::AsyncWriter & output, toolkit::Progress & progress);
+    // Run the repetitions `tasks` of a size in parallel, grouped by `Batch()`. `done(k)` is
+    //   called by the thread which ran the `k`-th task, after it.
+    template <typename Lattice>
+    void RunTasks(const std::vector<SimulationUnit::Replica> & tasks, const size_t & size,
+        toolkit::Progress & progress, const std::function<void(const size_t &)> & done);
+    // Indices of the tasks which run together: lanes of `Ising2DReplicas` for `Ising2D_PBC`
+    //   (see the specialization), otherwise one by one.
+    template <typename Lattice>
+    std::vector<std::vector<size_t>> Batch(const std::vector<SimulationUnit::Replica> & tasks) const;
+    // Run the `index`-th repetition of a cell of size `size` with `Lattice`, see the
+    //   specialization for `Ising2D_PBC` (the n-fold way at low temperatures, and the
+    //   bit-packed engines for small sizes).
+    template <typename Lattice>
+    void RunRepetition(SimulationUnit & unit, const size_t & index, const size_t & size,
+        const double & temperature, const double & magnetic_h, toolkit::Progress & progress);
+    // Temperatures of the stored cells of a size and field: the temperature list, or with the
+    //   adaptive grid, all the stored ones in its range.
+    std::vector<double> StoredTemperatures(const size_t & size, const double & magnetic_h) const;
+    // Whether new repetitions would be added to stored cells which have repetitions of
+    //   `seed_`, i.e. would replay their random numbers (reported on `cerr`).
+    bool ReplaysStoredSeed() const;
+    // Store key of a cell.
+    CellKey Key(const size_t & size, const double & temperature, const double & magnetic_h) const;
     void PrintParameters(std::ostream & os);
-    void PrintResults(std::ostream & os);
+    // Serialize the `index`-th cell to `json_output_`, on the output thread.
+    void WriteCell(const size_t & index, const size_t & size, const double & temperature,
+        const double & magnetic_h, const SimulationUnit & unit);
 };
 
 // Interface.
 int RunSimulation(const Parameter & param);
+int RunSimulationExport(const Parameter & param);
+int RunSimulationAnalysis(const Parameter & param);
 
 ISING_NAMESPACE_END
 
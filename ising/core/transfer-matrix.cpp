@@ -0,0 +1,380 @@
+#include "core/transfer-matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "core/ising.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+// Number of 1 bits.
+inline int _BitCount(size_t x)
+{
+    int count = 0;
+    for (; x != 0; x &= x - 1)
+        ++count;
+    return count;
+}
+
+// Rotate the `width` bits of `x` by one.
+inline size_t _RotateRow(const size_t & x, const size_t & width)
+{
+    return ((x >> 1) | (x << (width - 1))) & ((size_t(1) << width) - 1);
+}
+
+// Sum of the spins and of the bonds within the row `state`.
+inline int _RowSpinSum(const size_t & state, const size_t & width)
+{
+    return 2 * _BitCount(state) - static_cast<int>(width);
+}
+inline int _RowBondSum(const size_t & state, const size_t & width)
+{
+    return static_cast<int>(width) - 2 * _BitCount(state ^ _RotateRow(state, width));
+}
+
+inline double _Dot(const vector<double> & x, const vector<double> & y)
+{
+    double sum = 0.0;
+    const auto kSize = static_cast<int>(x.size());
+#ifdef ISING_PARALLEL
+#pragma omp parallel for reduction(+:sum)
+#endif
+    for (int i = 0; i < kSize; ++i)
+        sum += x[i] * y[i];
+    return sum;
+}
+
+// Moments of u + c from the moments `z` of u (0 to 4), times `weight`, added to `out`.
+inline void _AddShifted(const double * z, const double & c, const double & weight, double * out)
+{
+    const double kBinomial[5][5] = {
+        { 1, 0, 0, 0, 0 }, { 1, 1, 0, 0, 0 }, { 1, 2, 1, 0, 0 }, { 1, 3, 3, 1, 0 }, { 1, 4, 6, 4, 1 } };
+    for (size_t n = 0; n != 5; ++n)
+    {
+        double sum = 0.0, power = 1.0;
+        for (size_t i = n + 1; i-- != 0; power *= c)
+            sum += kBinomial[n][i] * power * z[i];
+        out[n] += weight * sum;
+    }
+}
+
+TransferMatrix2D::TransferMatrix2D(const size_t & width, const size_t & length) :
+    width_(length == 0 ? width : min(width, length)),
+    length_(length == 0 ? 0 : max(width, length)),
+    eigenvalue_(0.0) {}
+
+TransferResult TransferMatrix2D::Evaluate(const double & T, const double & magnetic_h)
+{
+    return length_ == 0 ? EvaluateStrip(T, magnetic_h) : EvaluateTorus(T, magnetic_h);
+}
+
+void TransferMatrix2D::ApplyBonds(vector<double> & x, const double & t, const size_t & flipped) const
+{
+    const auto L = width_;
+    const auto kBlock = min(L, kBlockBits);
+    const auto kBlockSize = static_cast<int>(size_t(1) << kBlock);
+    const auto kStates = static_cast<int>(size_t(1) << L);
+    auto mix = [&x, &t, &flipped](const size_t & i, const size_t & j)
+    {
+        auto c = j == flipped ? -t : t;
+        auto a = x[i], b = x[i | (size_t(1) << j)];
+        x[i] = a + c * b;
+        x[i | (size_t(1) << j)] = c * a + b;
+    };
+
+    // The lower bits within a block.
+#ifdef ISING_PARALLEL
+#pragma omp parallel for
+#endif
+    for (int begin = 0; begin < kStates; begin += kBlockSize)
+        for (size_t j = 0; j != kBlock; ++j)
+            for (size_t i = begin; i != static_cast<size_t>(begin + kBlockSize); ++i)
+                if ((i & (size_t(1) << j)) == 0)
+                    mix(i, j);
+    // The higher bits, a pass each.
+    for (size_t j = kBlock; j != L; ++j)
+    {
+        const auto kLow = (size_t(1) << j) - 1;
+#ifdef ISING_PARALLEL
+#pragma omp parallel for
+#endif
+        for (int pair = 0; pair < kStates / 2; ++pair)
+        {
+            auto p = static_cast<size_t>(pair);
+            mix(((p & ~kLow) << 1) | (p & kLow), j);
+        }
+    }
+}
+
+void TransferMatrix2D::ApplyStrip(const vector<double> & x, vector<double> & y, const double & t) const
+{
+    const auto kStates = static_cast<int>(x.size());
+    for (int i = 0; i < kStates; ++i)
+        y[i] = half_diagonal_[i] * x[i];
+    ApplyBonds(y, t, width_);
+    for (int i = 0; i < kStates; ++i)
+        y[i] *= half_diagonal_[i];
+}
+
+TransferMatrix2D::StripMeans TransferMatrix2D::Strip(const double & k, const double & b)
+{
+    const auto L = width_;
+    const auto kStates = size_t(1) << L;
+    const auto t = exp(-2.0 * k);
+
+    // D exp(-L (K + |b|)) <= 1, and W exp(-L K) has the factors 1 and t.
+    half_diagonal_.resize(kStates);
+    for (size_t i = 0; i != kStates; ++i)
+        half_diagonal_[i] = exp(0.5 * (k * (_RowBondSum(i, L) - static_cast<double>(L))
+            + b * _RowSpinSum(i, L) - fabs(b) * L));
+
+    // Power iteration, from the last eigenvector or D^1/2 (the rows without the bonds between).
+    if (eigenvector_.size() != kStates)
+        eigenvector_ = half_diagonal_;
+    auto & x = eigenvector_;
+    auto norm = sqrt(_Dot(x, x));
+    for (auto & i : x)
+        i /= norm;
+    vector<double> y(kStates);
+    for (size_t iteration = 0; iteration != kMaxIterations; ++iteration)
+    {
+        ApplyStrip(x, y, t);
+        eigenvalue_ = _Dot(x, y);
+        norm = sqrt(_Dot(y, y));
+        double change = 0.0;
+        for (size_t i = 0; i != kStates; ++i)
+        {
+            y[i] /= norm;
+            change += (y[i] - x[i]) * (y[i] - x[i]);
+        }
+        x.swap(y);
+        if (change < kTolerance * kTolerance)
+            break;
+    }
+
+    // A row is distributed as x^2. The bond to the previous row is the same for all the spins:
+    //   <s_0 s'_0> = (w, S_0 W S_0 w) / (w, W w) with w = D^1/2 x.
+    double bond_sum = 0.0, spin_sum = 0.0;
+    for (size_t i = 0; i != kStates; ++i)
+    {
+        bond_sum += x[i] * x[i] * _RowBondSum(i, L);
+        spin_sum += x[i] * x[i] * _RowSpinSum(i, L);
+        y[i] = half_diagonal_[i] * x[i];
+    }
+    auto w = y;
+    ApplyBonds(y, t, 0);
+    auto vertical = _Dot(w, y) / eigenvalue_;
+    return { log(eigenvalue_) / L + 2.0 * k + fabs(b),
+             -(bond_sum / L + vertical),
+             spin_sum / L };
+}
+
+TransferResult TransferMatrix2D::EvaluateStrip(const double & T, const double & magnetic_h)
+{
+    const auto L = width_;
+    const auto kStates = size_t(1) << L;
+    const auto beta = 1.0 / T;
+    const auto b = beta * magnetic_h;
+    const auto delta = kDifferenceStep;
+
+    // d/dK of the means by 5-point differences, each started from the last eigenvector.
+    StripMeans around[4];
+    const double kSteps[4] = { -2.0, -1.0, 1.0, 2.0 };
+    for (size_t i = 0; i != 4; ++i)
+        around[i] = Strip(beta + kSteps[i] * delta, b);
+    auto derivative = [&around, &delta](double StripMeans::* mean)
+    {
+        return (around[0].*mean - 8.0 * (around[1].*mean) + 8.0 * (around[2].*mean)
+            - around[3].*mean) / (12.0 * delta);
+    };
+    auto bond_variance = -derivative(&StripMeans::bond_energy);
+    auto covariance    = -derivative(&StripMeans::magnetization);
+    auto means = Strip(beta, b);
+
+    // Var(M) / N = (2 (v, (I - T / lambda)^-1 v) - (v, v)) / L with v = (M_row - <M_row>) x,
+    //   where I - T / lambda is positive definite on v (orthogonal to x).
+    // Conjugate gradients for (lambda - T) y = lambda v.
+    const auto t = exp(-2.0 * beta);
+    const auto & x = eigenvector_;
+    vector<double> v(kStates);
+    for (size_t i = 0; i != kStates; ++i)
+        v[i] = (_RowSpinSum(i, L) - means.magnetization * L) * x[i];
+    auto project = [&x](vector<double> & z)
+    {
+        auto overlap = _Dot(x, z);
+        for (size_t i = 0; i != z.size(); ++i)
+            z[i] -= overlap * x[i];
+    };
+    project(v);
+    auto v_square = _Dot(v, v);
+    vector<double> y(kStates, 0.0), r(kStates), p(kStates), q(kStates);
+    for (size_t i = 0; i != kStates; ++i)
+        r[i] = p[i] = eigenvalue_ * v[i];
+    auto r_square = _Dot(r, r);
+    const auto kStop = r_square * kTolerance * kTolerance;
+    for (size_t iteration = 0; iteration != kMaxIterations && r_square > kStop; ++iteration)
+    {
+        ApplyStrip(p, q, t);
+        for (size_t i = 0; i != kStates; ++i)
+            q[i] = eigenvalue_ * p[i] - q[i];
+        project(q);
+        auto alpha = r_square / _Dot(p, q);
+        for (size_t i = 0; i != kStates; ++i)
+        {
+            y[i] += alpha * p[i];
+            r[i] -= alpha * q[i];
+        }
+        auto r_square_next = _Dot(r, r);
+        for (size_t i = 0; i != kStates; ++i)
+            p[i] = r[i] + r_square_next / r_square * p[i];
+        r_square = r_square_next;
+    }
+    auto spin_variance = v_square == 0.0 ? 0.0 : (2.0 * _Dot(v, y) - v_square) / L;
+
+    // E = 2 E_bond - h M as `Ising2D::Analysis()`.
+    TransferResult result;
+    auto & observable = result.observable;
+    result.free_energy = -T * means.log_lambda;
+    observable.magnetic_dipole = means.magnetization;
+    observable.energy          = 2.0 * means.bond_energy - magnetic_h * means.magnetization;
+    observable.magnetic_dipole_abs    = fabs(observable.magnetic_dipole);
+    observable.magnetic_dipole_square = pow(observable.magnetic_dipole, 2);
+    observable.energy_square          = pow(observable.energy, 2);
+    observable.magnetic_dipole_fourth = pow(observable.magnetic_dipole_square, 2);
+    observable.energy_fourth          = pow(observable.energy_square, 2);
+    result.specific_heat  = beta * beta * (4.0 * bond_variance - 4.0 * magnetic_h * covariance
+        + magnetic_h * magnetic_h * spin_variance);
+    result.susceptibility = beta * spin_variance;
+    return result;
+}
+
+TransferResult TransferMatrix2D::EvaluateTorus(const double & T, const double & magnetic_h)
+{
+    const auto L = width_;
+    const auto kSites  = L * length_;
+    const auto kStates = size_t(1) << L;
+    const auto kCounts = kSites + 1;
+    const auto kStride = kCounts * kMoments;
+    const auto beta = 1.0 / T;
+    const auto t = exp(-2.0 * beta);
+    const double t_power[3] = { 1.0, t, t * t };
+
+    // The smallest row of each class under rotation, and the size of the class.
+    vector<size_t> starts, multiplicity;
+    for (size_t state = 0; state != kStates; ++state)
+    {
+        size_t size = 1, rotated = _RotateRow(state, L);
+        for (; rotated != state && rotated > state; rotated = _RotateRow(rotated, L))
+            ++size;
+        if (rotated == state)
+        {
+            starts.push_back(state);
+            multiplicity.push_back(size);
+        }
+    }
+
+    // For each start: by the number of +1 spins, the moments of the number of broken bonds u,
+    //   weighted by t^u. Row after row, a spin after another, the new row replaces the last.
+    vector<vector<double>> traces(starts.size());
+#ifdef ISING_PARALLEL
+#pragma omp parallel for schedule(dynamic)
+#endif
+    // OpenMP for need signed integer.
+    for (int s = 0; s < static_cast<int>(starts.size()); ++s)
+    {
+        vector<double> x(kStates * kStride, 0.0);
+        double to_down[kMoments], to_up[kMoments];
+        x[starts[s] * kStride] = 1.0;
+        size_t placed = 0;
+        for (size_t row = 0; row != length_; ++row)
+            for (size_t j = 0; j != L; ++j, ++placed)
+            {
+                const auto bit = size_t(1) << j;
+                for (size_t state = 0; state != kStates; ++state)
+                {
+                    if ((state & bit) != 0)
+                        continue;
+                    // Broken bonds to the new spins on the left (and the first, to close the row).
+                    int left_up = j == 0 ? -1 : static_cast<int>((state >> (j - 1)) & 1);
+                    int first_up = j == L - 1 ? static_cast<int>(state & 1) : -1;
+                    int broken_up   = (left_up == 0) + (first_up == 0);
+                    int broken_down = (left_up == 1) + (first_up == 1);
+                    auto down = x.data() + state * kStride;
+                    auto up   = x.data() + (state | bit) * kStride;
+                    // Downwards, so that the entries of the new +1 spin (k + 1) are read before.
+                    for (size_t k = placed + 1; k-- != 0;)
+                    {
+                        auto down_k = down + k * kMoments, up_k = up + k * kMoments;
+                        fill(to_down, to_down + kMoments, 0.0);
+                        fill(to_up, to_up + kMoments, 0.0);
+                        _AddShifted(down_k, 0.0, 1.0, to_down);
+                        _AddShifted(up_k, 1.0, t, to_down);
+                        _AddShifted(up_k, 0.0, 1.0, to_up);
+                        _AddShifted(down_k, 1.0, t, to_up);
+                        fill(down_k, down_k + kMoments, 0.0);
+                        _AddShifted(to_down, broken_down, t_power[broken_down], down_k);
+                        fill(up_k + kMoments, up_k + 2 * kMoments, 0.0);
+                        _AddShifted(to_up, broken_up, t_power[broken_up], up_k + kMoments);
+                    }
+                    fill(up, up + kMoments, 0.0);
+                }
+            }
+        auto begin = x.begin() + starts[s] * kStride;
+        traces[s].assign(begin, begin + kStride);
+        for (auto & i : traces[s])
+            i *= static_cast<double>(multiplicity[s]);
+    }
+    vector<double> sectors(kStride, 0.0);
+    for (auto & trace : traces)
+        for (size_t i = 0; i != kStride; ++i)
+            sectors[i] += trace[i];
+
+    // Z = exp(2 N K) sum_k Z_k exp(beta h M_k), and E = 2 E_bond - h M = (4 u + c_k) with
+    //   c_k = -4 N - h M_k, as `Ising2D::Analysis()`.
+    const auto N = static_cast<double>(kSites);
+    double log_max = -HUGE_VAL;
+    for (size_t k = 0; k != kCounts; ++k)
+        if (sectors[k * kMoments] > 0.0)
+            log_max = max(log_max, log(sectors[k * kMoments]) + beta * magnetic_h * (2.0 * k - N));
+    double total = 0.0, energy[kMoments] = {};
+    TransferResult result;
+    auto & observable = result.observable;
+    for (size_t k = 0; k != kCounts; ++k)
+    {
+        auto z = sectors.data() + k * kMoments;
+        if (z[0] <= 0.0)
+            continue;
+        auto magnetization = 2.0 * k - N;
+        auto weight = exp(log(z[0]) + beta * magnetic_h * magnetization - log_max) / z[0];
+        double moments[kMoments] = {};
+        _AddShifted(z, (-4.0 * N - magnetic_h * magnetization) / 4.0, weight, moments);
+        for (size_t n = 0; n != kMoments; ++n)
+            energy[n] += moments[n] * pow(4.0 / N, static_cast<double>(n));
+        auto m = magnetization / N;
+        weight *= z[0];
+        total += weight;
+        observable.magnetic_dipole        += weight * m;
+        observable.magnetic_dipole_abs    += weight * fabs(m);
+        observable.magnetic_dipole_square += weight * m * m;
+        observable.magnetic_dipole_fourth += weight * pow(m, 4);
+    }
+    observable.magnetic_dipole        /= total;
+    observable.magnetic_dipole_abs    /= total;
+    observable.magnetic_dipole_square /= total;
+    observable.magnetic_dipole_fourth /= total;
+    observable.energy        = energy[1] / total;
+    observable.energy_square = energy[2] / total;
+    observable.energy_fourth = energy[4] / total;
+    result.free_energy    = -T * (2.0 * beta + (log(total) + log_max) / N);
+    result.specific_heat  = beta * beta * N
+        * (observable.energy_square - observable.energy * observable.energy);
+    result.susceptibility = beta * N
+        * (observable.magnetic_dipole_square - observable.magnetic_dipole * observable.magnetic_dipole);
+    return result;
+}
+
+ISING_NAMESPACE_END
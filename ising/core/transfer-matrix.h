@@ -0,0 +1,98 @@
+// Exact results of the 2D Ising model in a magnetic field by the row-to-row transfer matrix.
+// See R.J.Baxter *Exactly Solved Models in Statistical Mechanics* 2.1, 7.1.
+
+#ifndef ISING_CORE_TRANSFER_MATRIX_H_
+#define ISING_CORE_TRANSFER_MATRIX_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "core/ising.h"
+
+ISING_NAMESPACE_BEGIN
+
+// Per site, at a temperature and field.
+// `observable` is the thermal average of `Ising2D::Analysis()` (each bond counted twice), so
+//   that it compares with `Simulation` directly, and `specific_heat` is the fluctuation of that
+//   energy, beta^2 N (<E^2> - <E>^2) as `EstimateResponse()`. `free_energy` is -T ln Z / N and
+//   `susceptibility` is beta N (<m^2> - <m>^2) = d<m>/dh, of the Hamiltonian
+//   H = -sum_<ij> s_i s_j - h sum_i s_i.
+struct TransferResult
+{
+    double     free_energy;
+    Observable observable;
+    double     specific_heat;
+    double     susceptibility;
+};
+
+// The transfer matrix of a row of `width` spins (periodic) is applied a site after another,
+//   T = D^1/2 (W_1 ... W_L) D^1/2, where D is diagonal (the bonds within the row and the field)
+//   and W_j only mixes the two values of spin j (the bond to the previous row). A state is an
+//   index whose bit j is spin j (1 for +1), so W_j mixes the entries i and i ^ (1 << j).
+//   Each application costs L 2^L, with the lower bits blocked to stay in cache.
+// `length` = 0 is the L * infinity strip: Z is dominated by the leading eigenvalue (power
+//   iteration), whose eigenvector squared is the distribution of a row. An infinite strip is
+//   self-averaging, so the moments of `observable` are powers of the means. `susceptibility` sums
+//   the correlations of the row magnetizations, (I - T / lambda)^-1 by conjugate gradients, and
+//   `specific_heat` differentiates the means by 5-point differences in beta. Practical up to L of
+//   about 20, multi-threaded over the states. Below T_c at h = 0 the two leading eigenvalues
+//   nearly coincide for wide strips, and the susceptibility (truly huge) converges slowly.
+// `length` > 0 is the L * M torus, Z = Tr T^M, with the partition function resolved by the
+//   magnetization and the moments of the number of broken bonds carried along, so that every
+//   moment is exact (and the field enters only at the end). The trace starts from a row of each
+//   class under rotation, multi-threaded over the classes. The cost grows as 4^L (L M)^2 / L, so
+//   the narrow side is used as the width; practical up to L of about 10.
+class TransferMatrix2D
+{
+public:
+    static const size_t kMaxWidth = 24;
+
+    // The `width` * `length` torus, or the `width` * infinity strip if `length` is 0.
+    TransferMatrix2D(const size_t & width, const size_t & length);
+
+    TransferResult Evaluate(const double & T, const double & magnetic_h);
+
+private:
+    // Change of the (normalized) eigenvector, or relative residual of the conjugate gradients, at
+    //   convergence, and the most iterations of either.
+    const double kTolerance        = 1.0e-13;
+    const size_t kMaxIterations    = 1000000;
+    // Step of the differences in beta of the strip.
+    const double kDifferenceStep   = 1.0e-3;
+    // The bits of a state applied block by block (2^12 doubles).
+    const size_t kBlockBits        = 12;
+    // Moments of the number of broken bonds carried along the torus: 0 to 4.
+    static const size_t kMoments   = 5;
+
+    const size_t width_;
+    const size_t length_;
+
+    // Leading eigenvector of the strip (normalized), kept as the start of the next evaluation,
+    //   and its eigenvalue lambda exp(-L (2K + |b|)).
+    std::vector<double> eigenvector_;
+    double              eigenvalue_;
+    // Square root of D exp(-L (K + |b|)) of the strip, by state.
+    std::vector<double> half_diagonal_;
+
+    // Means of the strip per site at (K, b) = (beta, beta h): ln lambda / L, the bond energy
+    //   -sum_<ij> s_i s_j / N and the magnetization.
+    struct StripMeans
+    {
+        double log_lambda;
+        double bond_energy;
+        double magnetization;
+    };
+    StripMeans Strip(const double & k, const double & b);
+    // y <- T x (scaled as `eigenvalue_`).
+    void ApplyStrip(const std::vector<double> & x, std::vector<double> & y, const double & t) const;
+    TransferResult EvaluateStrip(const double & T, const double & magnetic_h);
+    TransferResult EvaluateTorus(const double & T, const double & magnetic_h);
+
+    // x <- W x with the factors exp(K (s s' - 1)), i.e. 1 and t = exp(-2K). The sign of the
+    //   mixing of bit `flipped` (if < width) is reversed, which is W with s_j s'_j inserted.
+    void ApplyBonds(std::vector<double> & x, const double & t, const size_t & flipped) const;
+};
+
+ISING_NAMESPACE_END
+
+#endif
@@ -0,0 +1,261 @@
+#include "lib/ising-c.h"
+
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/ising.h"
+#include "core/ising-2d-replicas.h"
+#include "core/parameter.h"
+
+using namespace std;
+
+ISING_NAMESPACE_BEGIN
+
+const size_t kMaxEmbeddedLanes = 64;
+
+// `Ising2DReplicas` of any number of lanes.
+class EmbeddedReplicas
+{
+public:
+    virtual ~EmbeddedReplicas() {}
+
+    virtual void Initialize(const vector<ReplicaLane> & lanes) = 0;
+    virtual void Sweep() = 0;
+    virtual vector<Observable> Analysis() const = 0;
+    virtual const signed char * Spins() const = 0;
+    // Spins per site, i.e. `kLanes`.
+    virtual size_t SiteStride() const = 0;
+};
+
+template <size_t kLanes>
+class EmbeddedReplicasOf : public EmbeddedReplicas
+{
+public:
+    EmbeddedReplicasOf(const size_t & size) : replicas_(size) {}
+
+    void Initialize(const vector<ReplicaLane> & lanes) override { replicas_.Initialize(lanes); }
+    void Sweep() override { replicas_.Sweep(); }
+    vector<Observable> Analysis() const override { return replicas_.Analysis(); }
+    const signed char * Spins() const override { return replicas_.Spins(); }
+    size_t SiteStride() const override { return kLanes; }
+
+private:
+    Ising2DReplicas<kLanes> replicas_;
+};
+
+// Of the calling thread, so that the simulators of different threads do not mix their errors.
+thread_local string last_error;
+
+int _Fail(const string & message)
+{
+    last_error = message;
+    return ISING_ERROR;
+}
+
+// Seed of the random stream of a lane (the same on all platforms).
+unsigned int _LaneSeed(const int & seed, const size_t & size, const size_t & lane)
+{
+    seed_seq sequence{ static_cast<unsigned int>(seed), static_cast<unsigned int>(size),
+        static_cast<unsigned int>(lane) };
+    unsigned int lane_seed = 0;
+    sequence.generate(&lane_seed, &lane_seed + 1);
+    return lane_seed;
+}
+
+ISING_NAMESPACE_END
+
+struct ising_simulator
+{
+    size_t                                   size;
+    std::vector<double>                      temperatures;
+    std::vector<ising::ReplicaLane>          lanes;
+    std::unique_ptr<ising::EmbeddedReplicas> replicas;
+};
+
+ISING_NAMESPACE_BEGIN
+
+// The simulator of parsed settings, or null (with the error set).
+ising_simulator * _CreateSimulator(const Parameter & param)
+{
+    if (param.dimension != 2 || param.boundary_condition != kPeriodic || param.disorder.Enabled())
+    {
+        _Fail("Only clean 2D periodic lattices are supported.");
+        return nullptr;
+    }
+    if (param.lattice_size_list.size() != 1 || param.lattice_size_list.front() < 2)
+    {
+        _Fail("\"size.list\" should have a single size of at least 2.");
+        return nullptr;
+    }
+    for (auto & temperature : param.temperature_list)
+    {
+        if (!(temperature > 0.0))
+        {
+            _Fail("The temperatures should be positive.");
+            return nullptr;
+        }
+    }
+    auto count = param.temperature_list.size() * param.magnetic_h_list.size() * param.repetitions;
+    if (count == 0 || count > kMaxEmbeddedLanes)
+    {
+        _Fail("The temperatures, fields and repetitions should make 1 to "
+            + to_string(kMaxEmbeddedLanes) + " lanes.");
+        return nullptr;
+    }
+
+    unique_ptr<ising_simulator> simulator(new ising_simulator);
+    simulator->size = param.lattice_size_list.front();
+    for (auto & temperature : param.temperature_list)
+    {
+        for (auto & magnetic_h : param.magnetic_h_list)
+        {
+            for (size_t i = 0; i != param.repetitions; ++i)
+            {
+                auto lane = simulator->lanes.size();
+                simulator->temperatures.push_back(temperature);
+                simulator->lanes.push_back({ 1.0 / temperature, magnetic_h,
+                    _LaneSeed(param.seed, simulator->size, lane) });
+            }
+        }
+    }
+    if (count <= 16)
+        simulator->replicas.reset(new EmbeddedReplicasOf<16>(simulator->size));
+    else if (count <= 32)
+        simulator->replicas.reset(new EmbeddedReplicasOf<32>(simulator->size));
+    else
+        simulator->replicas.reset(new EmbeddedReplicasOf<64>(simulator->size));
+    simulator->replicas->Initialize(simulator->lanes);
+    return simulator.release();
+}
+
+ISING_NAMESPACE_END
+
+using namespace ising;
+
+// Nothing may throw through the C interface.
+
+int ising_api_version(void) { return ISING_API_VERSION; }
+
+const char * ising_last_error(void) { return last_error.c_str(); }
+
+ising_simulator * ising_create(const char * settings)
+{
+    if (!settings)
+    {
+        _Fail("The settings are null.");
+        return nullptr;
+    }
+    try
+    {
+        Parameter param;
+        param.ReadFromString(settings);
+        if (!param.IsValid())
+        {
+            _Fail("The settings are not a JSON object.");
+            return nullptr;
+        }
+        param.Parse();
+        return _CreateSimulator(param);
+    }
+    catch (const exception & e)
+    {
+        _Fail(e.what());
+        return nullptr;
+    }
+}
+
+void ising_destroy(ising_simulator * simulator) { delete simulator; }
+
+size_t ising_lane_count(const ising_simulator * simulator)
+{
+    return simulator ? simulator->lanes.size() : 0;
+}
+
+size_t ising_lattice_size(const ising_simulator * simulator)
+{
+    return simulator ? simulator->size : 0;
+}
+
+int ising_lane(const ising_simulator * simulator, size_t lane,
+    double * temperature, double * magnetic_h)
+{
+    if (!simulator || lane >= simulator->lanes.size())
+        return _Fail("No such lane.");
+    if (temperature)
+        *temperature = simulator->temperatures[lane];
+    if (magnetic_h)
+        *magnetic_h = simulator->lanes[lane].magnetic_h;
+    return ISING_OK;
+}
+
+int ising_reset(ising_simulator * simulator)
+{
+    if (!simulator)
+        return _Fail("The simulator is null.");
+    try
+    {
+        simulator->replicas->Initialize(simulator->lanes);
+    }
+    catch (const exception & e)
+    {
+        return _Fail(e.what());
+    }
+    return ISING_OK;
+}
+
+int ising_sweep(ising_simulator * simulator, size_t sweeps)
+{
+    if (!simulator)
+        return _Fail("The simulator is null.");
+    for (size_t i = 0; i != sweeps; ++i)
+        simulator->replicas->Sweep();
+    return ISING_OK;
+}
+
+int ising_analysis(const ising_simulator * simulator, ising_observable * observables, size_t count)
+{
+    if (!simulator || !observables)
+        return _Fail("The simulator or the observables are null.");
+    if (count < simulator->lanes.size())
+        return _Fail("Fewer observables than lanes.");
+    vector<Observable> analysis;
+    try
+    {
+        analysis = simulator->replicas->Analysis();
+    }
+    catch (const exception & e)
+    {
+        return _Fail(e.what());
+    }
+    for (size_t r = 0; r != analysis.size(); ++r)
+    {
+        auto & observable = analysis[r];
+        observables[r] = { observable.magnetic_dipole, observable.energy,
+            observable.magnetic_dipole_abs, observable.magnetic_dipole_square,
+            observable.energy_square, observable.magnetic_dipole_fourth,
+            observable.energy_fourth };
+    }
+    return ISING_OK;
+}
+
+int ising_lattice(const ising_simulator * simulator, ising_lattice_view * view)
+{
+    if (!simulator || !view)
+        return _Fail("The simulator or the view is null.");
+    // `signed char` is 8 bits wherever `int8_t` exists.
+    auto stride = static_cast<ptrdiff_t>(simulator->replicas->SiteStride());
+    auto size = simulator->size;
+    view->data       = reinterpret_cast<const int8_t *>(simulator->replicas->Spins());
+    view->ndim       = 3;
+    view->shape[0]   = simulator->lanes.size();
+    view->shape[1]   = size;
+    view->shape[2]   = size;
+    view->strides[0] = 1;
+    view->strides[1] = static_cast<ptrdiff_t>(size) * stride;
+    view->strides[2] = stride;
+    return ISING_OK;
+}
@@ -0,0 +1,91 @@
+/* C interface of `libising` (`make lib`), to drive the simulations in-process, e.g. from
+ *   Python with ctypes. Only C types cross it, and nothing throws.
+ *
+ * A simulator is created from a settings string (JSON, see "core/parameter.h"):
+ *   one "size.list" entry L, the lanes being every ("temperature.list",
+ *   "externalMagneticField.list") pair, "repetitions" times each, at most 64 of them, in that
+ *   order (temperature, then field, then repetition). The lattices are 2D periodic, swept in
+ *   lockstep by `Ising2DReplicas` with the random streams derived from "seed", so a simulator
+ *   is independent of the others and of `FastRand()`.
+ * A simulator is not thread-safe, but different simulators may be used by different threads.
+ *
+ * Functions returning `int` give ISING_OK, or ISING_ERROR with the reason in
+ *   `ising_last_error()` (of the calling thread).
+ *
+ * The spins (int8, +1 or -1) are read in place: `ising_lattice()` gives the address, shape
+ *   (lanes, L, L) and strides (bytes) of the spins of the simulator, e.g. with NumPy
+ *     np.ndarray(view.shape, np.int8, buffer, 0, view.strides)
+ *   over the `view.data` buffer. It stays valid until `ising_reset()` or `ising_destroy()`.
+ */
+
+#ifndef ISING_LIB_ISING_C_H_
+#define ISING_LIB_ISING_C_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#define ISING_API __declspec(dllexport)
+#else
+#define ISING_API __attribute__((visibility("default")))
+#endif
+
+/* Changed whenever a declaration below does. */
+#define ISING_API_VERSION 1
+
+#define ISING_OK     0
+#define ISING_ERROR -1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ising_simulator ising_simulator;
+
+/* Per site, as `Observable` (the energy counts each bond twice). */
+typedef struct ising_observable
+{
+    double magnetic_dipole;
+    double energy;
+    double magnetic_dipole_abs;
+    double magnetic_dipole_square;
+    double energy_square;
+    double magnetic_dipole_fourth;
+    double energy_fourth;
+} ising_observable;
+
+/* Spin (lane, x, y) is at data + lane * strides[0] + x * strides[1] + y * strides[2]. */
+typedef struct ising_lattice_view
+{
+    const int8_t * data;
+    size_t         ndim;
+    size_t         shape[3];
+    ptrdiff_t      strides[3];
+} ising_lattice_view;
+
+ISING_API int          ising_api_version(void);
+ISING_API const char * ising_last_error(void);
+
+/* NULL if the settings are invalid. All the spins are +1. */
+ISING_API ising_simulator * ising_create(const char * settings);
+ISING_API void              ising_destroy(ising_simulator * simulator);
+
+ISING_API size_t ising_lane_count(const ising_simulator * simulator);
+ISING_API size_t ising_lattice_size(const ising_simulator * simulator);
+ISING_API int    ising_lane(const ising_simulator * simulator, size_t lane,
+                     double * temperature, double * magnetic_h);
+
+/* All the spins to +1, and the random streams back to their start. */
+ISING_API int ising_reset(ising_simulator * simulator);
+/* Metropolis sweeps of all the lanes. */
+ISING_API int ising_sweep(ising_simulator * simulator, size_t sweeps);
+/* The observables of the current lattices, `count` (at least the lane count) of them. */
+ISING_API int ising_analysis(const ising_simulator * simulator,
+                  ising_observable * observables, size_t count);
+ISING_API int ising_lattice(const ising_simulator * simulator, ising_lattice_view * view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -3,6 +3,8 @@
 #include <string>
 #include <include/argagg/argagg.hpp>
 
+#include "core/cpu-dispatch.h"
+#include "core/dataset-server.h"
 #include "core/exact.h"
 #include "core/ising.h"
 #include "core/lattice-data.h"
@@ -21,24 +23,54 @@ const argagg::parser kIsingArgParser
         "Calculate specific heat for finite size 2D Ising model",
         0
     },
+    {
+        "peak",
+        { "--peak", "-p" },
+        "Locate the specific heat peak for each size (use with --exact).",
+        0
+    },
     {
         "simulation",
         { "--simulation", "-m" }, // `m` for Monte Carlo.
         "Analyze critical behavior with Monte Carlo algorithm.",
         0
     },
+    {
+        "export",
+        { "--export" },
+        "Print the results in the result store for the settings (same format as --simulation).",
+        0
+    },
+    {
+        "analyze",
+        { "--analyze" },
+        "Finite-size scaling of the results in the result store (Binder crossings, data collapse).",
+        0
+    },
     {
         "lattice",
         { "--lattice", "-l" },
         "Generate lattice data with Monte Carlo algorithm.",
         0
     },
+    {
+        "serve",
+        { "--serve" },
+        "Serve lattice data on the given Unix domain socket (see \"core/dataset-server.h\").",
+        1
+    },
     {
         "settings",
         { "--settings", "-s" },
         "Use settings file (JSON format).",
         1
     },
+    {
+        "cpu",
+        { "--cpu" },
+        "Instruction set of the kernels: auto (default), sse2, avx2, avx512.",
+        1
+    },
     {
         "dumped",
         { "--dumped", "-d" },
@@ -81,16 +113,33 @@ int Run(int argc, char * argv[])
         return exit_code;
     }
 
+    if (args["cpu"] && !toolkit::SelectCpuPath(args["cpu"].as<string>("auto")))
+    {
+        cerr << "Instruction set \"" << args["cpu"].as<string>("auto")
+             << "\" is unknown or not supported by this CPU." << endl;
+        exit_code = EXIT_FAILURE;
+        return exit_code;
+    }
+
     Parameter param;
     if (args["settings"])
         param.ReadFromFile(args["settings"].as<string>(""));
     else
         param.ReadFromString(kDefaultSettingsString);
-    param.Parse();
+    try
+    {
+        param.Parse();
+    }
+    catch (const exception & e)
+    {
+        std::cerr << e.what() << std::endl;
+        exit_code = EXIT_FAILURE;
+        return exit_code;
+    }
 
     if (args["exact"])
     {
-        exit_code = RunExact(param);
+        exit_code = args["peak"] ? RunExactPeak(param) : RunExact(param);
         return exit_code;
     }
 
@@ -100,12 +149,30 @@ int Run(int argc, char * argv[])
         return exit_code;
     }
 
+    if (args["export"])
+    {
+        exit_code = RunSimulationExport(param);
+        return exit_code;
+    }
+
+    if (args["analyze"])
+    {
+        exit_code = RunSimulationAnalysis(param);
+        return exit_code;
+    }
+
     if (args["lattice"])
     {
         exit_code = RunLatticeData(param);
         return exit_code;
     }
 
+    if (args["serve"])
+    {
+        exit_code = RunDatasetServer(param, args["serve"].as<string>(""));
+        return exit_code;
+    }
+
     if (args["help"])
     {
         exit_code = PrintHelp(argv[0]);
@@ -1,8 +1,31 @@
 #include "stdafx.h"
 
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
 #include "core/ising.h"
+#include "core/adaptive-grid.h"
+#include "core/async-writer.h"
+#include "core/block-spin.h"
+#include "core/chebyshev.h"
+#include "core/correlation.h"
+#include "core/dataset-server.h"
+#include "core/exact.h"
+#include "core/fast-rand.h"
+#include "core/finite-size-scaling.h"
 #include "core/parameter.h"
+#include "core/result-store.h"
+#include "core/transfer-matrix.h"
 #include "core/ising-2d.h"
+#include "core/ising-2d-disordered.h"
+#include "core/ising-2d-n-fold.h"
+#include "core/ising-2d-replicas.h"
+#include "core/ising-2d-small.h"
+#include "core/ising-3d.h"
+#include "lib/ising-c.h"
 
 using namespace std;
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -107,6 +130,577 @@ public:
         _WriteLatticeMessageFBC(s);
     }
 
+    TEST_METHOD(ApbcEvaluate)
+    {
+        PRINT_TEST_INFO("Ising lattice evaluate (antiperiodic)")
+
+        Ising2D_APBC s(lattice_size_, lattice_size_);
+        s.Initialize();
+        _WriteResultMessage(s.Evaluate(beta_, h_, iterations_, n_ensemble_));
+        for (auto i = 0; i != lattice_size_; ++i)
+            _WriteRowMessage(s, i);
+    }
+
+    TEST_METHOD(Ising3DEvaluate)
+    {
+        PRINT_TEST_INFO("Ising lattice evaluate (3D)")
+
+        Ising3D<> s(lattice_size_);
+        s.Initialize();
+        _WriteResultMessage(s.Evaluate(beta_, h_, iterations_, n_ensemble_));
+        for (auto i = 0; i != lattice_size_; ++i)
+            _WriteRowMessage(s, i);
+    }
+
+    TEST_METHOD(BlockSpinTransform)
+    {
+        PRINT_TEST_INFO("Block-spin transforms")
+
+        Lattice2D lattice = {
+            {  1,  1, -1, -1,  1 },
+            {  1, -1, -1, -1,  1 },
+            { -1,  1,  1,  1,  1 },
+            {  1,  1, -1,  1,  1 },
+            {  1,  1,  1,  1,  1 } };
+        Lattice2D majority   = { { 1, -1 }, {  1, 1 } };
+        Lattice2D decimation = { { 1, -1 }, { -1, 1 } };
+
+        Assert::IsTrue(majority   == BlockSpin(lattice, 2, kMajority));
+        Assert::IsTrue(decimation == BlockSpin(lattice, 2, kDecimation));
+    }
+
+    TEST_METHOD(AsyncJsonOutput)
+    {
+        PRINT_TEST_INFO("Cells written out of order by the output thread")
+
+        ostringstream os;
+        toolkit::JsonArrayStream json(os);
+        {
+            toolkit::AsyncWriter output(1);
+            for (size_t i : { 2, 0, 3, 1 })
+                output.Push([&json, i] { json.Put(i, to_string(i)); });
+        }
+        json.Close();
+
+        Assert::AreEqual(string("[0,1,2,3]\n"), os.str());
+    }
+
+    TEST_METHOD(AdaptiveGridRefinement)
+    {
+        PRINT_TEST_INFO("Adaptive temperature grid around a peak")
+
+        // A sharp peak at T = 2.3 on a coarse grid.
+        vector<GridPoint> curve;
+        for (auto t : { 1.0, 1.5, 2.0, 2.5, 3.0, 3.5, 4.0 })
+            curve.push_back({ t, 1.0 / (0.01 + (t - 2.3) * (t - 2.3)), 0.0 });
+
+        auto temperatures = RefineTemperatureGrid({ curve }, 0.1, 0.01, 2);
+        Assert::AreEqual(size_t(2), temperatures.size());
+        for (auto t : temperatures)
+            Assert::IsTrue(t > 1.5 && t < 3.0);
+
+        // Flat curves and exhausted budgets are not refined.
+        for (auto & point : curve)
+            point.value = 1.0;
+        Assert::IsTrue(RefineTemperatureGrid({ curve }, 0.1, 0.01, 10).empty());
+        Assert::IsTrue(RefineTemperatureGrid({ curve }, 0.1, 0.01, 0).empty());
+    }
+
+    TEST_METHOD(ResultStoreAppend)
+    {
+        PRINT_TEST_INFO("Repetitions accumulated in the result store")
+
+        const string kFileName = "result-store-test.txt";
+        remove(kFileName.c_str());
+        CellKey key = { 2, kPeriodic, 8, 2.25, 0.0, 100, 10, 1, { 2 }, kMajority };
+        StoredRepetition repetition = { 1, Observable(), { Observable() } };
+        repetition.result.energy = -1.5;
+        {
+            ResultStore store(kFileName);
+            Assert::IsTrue(store.Find(key).empty());
+            Assert::IsTrue(store.Append(key, { repetition, repetition }));
+        }
+        {
+            ResultStore store(kFileName);
+            Assert::AreEqual(size_t(2), store.Find(key).size());
+            Assert::AreEqual(-1.5, store.Find(key)[0].result.energy);
+            Assert::AreEqual(size_t(1), store.Find(key)[0].block_spin_result.size());
+            key.temperature = 2.5;
+            Assert::IsTrue(store.Find(key).empty());
+            Assert::AreEqual(size_t(1), store.Temperatures(key).size());
+        }
+        remove(kFileName.c_str());
+    }
+
+    TEST_METHOD(CorrelationOrderedLattice)
+    {
+        PRINT_TEST_INFO("Correlations of ordered and striped lattices")
+
+        // 6 * 5: Bluestein transforms along both axes.
+        CorrelationMeasurement ordered;
+        ordered.Measure(Lattice2D(6, vector<int>(5, 1)));
+        auto correlation = ordered.Result();
+        Assert::AreEqual(1.0, correlation.function[0], 1.0e-12);
+        Assert::AreEqual(1.0, correlation.function.back(), 1.0e-12);
+        Assert::AreEqual(30.0, correlation.structure_factor[0], 1.0e-9);
+        // Infinite, reported as 0 so that the results stay valid JSON.
+        Assert::AreEqual(0.0, correlation.length);
+
+        // 8 * 8: radix-2 transforms, where S(k_min) is exactly 0.
+        CorrelationMeasurement ordered_radix_2;
+        ordered_radix_2.Measure(Lattice2D(8, vector<int>(8, 1)));
+        Assert::AreEqual(0.0, ordered_radix_2.Result().length);
+
+        // Alternating rows: G = 1 along the rows and -1 otherwise. The shell |r| = 1 holds
+        // 2 offsets along the rows, 2 across and 4 diagonals (|r| = 1.41).
+        CorrelationMeasurement striped;
+        striped.Measure({ { 1, 1, 1, 1 }, { -1, -1, -1, -1 }, { 1, 1, 1, 1 }, { -1, -1, -1, -1 } });
+        correlation = striped.Result();
+        Assert::AreEqual(1.0, correlation.function[0], 1.0e-12);
+        Assert::AreEqual(-0.5, correlation.function[1], 1.0e-12);
+        Assert::AreEqual(0.0, correlation.structure_factor[0], 1.0e-12);
+    }
+
+    TEST_METHOD(FiniteSizeScalingCollapse)
+    {
+        PRINT_TEST_INFO("Binder crossing and data collapse of scaling functions")
+
+        // U_4 = f((T - Tc) L) and chi = L^1.75 g((T - Tc) L), i.e. nu = 1 and gamma / nu = 1.75.
+        const double kTc = 2.27;
+        vector<size_t> sizes = { 8, 16, 32 };
+        vector<vector<GridPoint>> binder_cumulant(3), susceptibility(3);
+        for (size_t i = 0; i != sizes.size(); ++i)
+            for (int k = 0; k <= 20; ++k)
+            {
+                auto t = 2.1 + 0.02 * k;
+                auto x = (t - kTc) * sizes[i];
+                binder_cumulant[i].push_back({ t, 2.0 / 3.0 / (1.0 + exp(x)), 0.001 });
+                susceptibility[i].push_back({ t, pow(sizes[i], 1.75) / (1.0 + x * x),
+                    0.01 * pow(sizes[i], 1.75) });
+            }
+
+        BinderCrossing crossing;
+        Assert::IsTrue(FindBinderCrossing(binder_cumulant[0], binder_cumulant[1], crossing));
+        Assert::AreEqual(kTc, crossing.temperature, 1.0e-3);
+
+        CollapseFit start;
+        start.critical_temperature = 2.3;
+        auto scaling = FitCollapse(sizes, binder_cumulant, start, true, false);
+        Assert::AreEqual(kTc, scaling.critical_temperature, 1.0e-3);
+        Assert::AreEqual(1.0, scaling.nu, 0.02);
+        scaling.exponent = 1.0;
+        auto exponent = FitCollapse(sizes, susceptibility, scaling, false, true);
+        Assert::AreEqual(1.75, exponent.exponent, 0.05);
+    }
+
+    TEST_METHOD(DisorderedCleanLimit)
+    {
+        PRINT_TEST_INFO("Disordered lattice without disorder, and with all the bonds negated")
+
+        // The same random numbers give the same lattices as `Ising2D_PBC`.
+        Ising2D_PBC clean(lattice_size_);
+        Ising2DDisordered disordered(lattice_size_);
+        clean.Initialize();
+        disordered.Quench(Disorder(), 1);
+        toolkit::FastRandInitialize(1);
+        for (size_t i = 0; i != iterations_; ++i)
+            clean.Sweep(beta_, 0.0);
+        toolkit::FastRandInitialize(1);
+        for (size_t i = 0; i != iterations_; ++i)
+            disordered.Sweep(beta_, 0.0);
+        Assert::IsTrue(clean.Lattice() == disordered.Lattice());
+        Assert::AreEqual(clean.Analysis(0.0).energy, disordered.Analysis(0.0).energy, 1.0e-12);
+
+        // With J = -1 everywhere, the ordered state costs what it saves in the clean model.
+        Disorder antiferromagnet;
+        antiferromagnet.bond_probability = 1.0;
+        disordered.Quench(antiferromagnet, 1);
+        clean.Initialize();
+        Assert::AreEqual(-clean.Analysis(0.0).energy, disordered.Analysis(0.0).energy, 1.0e-12);
+    }
+
+    TEST_METHOD(NFoldWayBuckets)
+    {
+        PRINT_TEST_INFO("N-fold way buckets against the lattice")
+
+        Ising2DNFold s(lattice_size_);
+        s.Initialize();
+        for (size_t i = 0; i != iterations_; ++i)
+            s.Sweep(beta_, h_);
+#ifdef ISING_COUNTERS
+        Assert::IsTrue(s.Counters().AcceptedFlips() > 0);
+#endif
+
+        // `Analysis()` counts the buckets.
+        auto lattice = s.Lattice();
+        const auto L = lattice_size_;
+        double spin_total = 0.0, energy_total = 0.0;
+        for (size_t i = 0; i != L; ++i)
+            for (size_t j = 0; j != L; ++j)
+            {
+                spin_total   += lattice[i][j];
+                energy_total += lattice[i][j] * (lattice[i][(j + 1) % L] + lattice[(i + 1) % L][j]);
+            }
+        auto result = s.Analysis(h_);
+        Assert::AreEqual(spin_total / (L * L), result.magnetic_dipole, 1.0e-12);
+        Assert::AreEqual((-2.0 * energy_total - h_ * spin_total) / (L * L), result.energy, 1.0e-12);
+    }
+
+    TEST_METHOD(ReplicaLanes)
+    {
+        PRINT_TEST_INFO("Lanes of the lockstep replicas with their own temperature and field")
+
+        // A strong negative field flips every spin of lane 0 at once, and lane 1 is frozen.
+        Ising2DReplicas<16> s(lattice_size_);
+        s.Initialize({ { 1.0, -10.0, 1 }, { 10.0, 0.0, 2 } });
+        s.Sweep();
+        auto result = s.Analysis();
+        Assert::AreEqual(size_t(2), result.size());
+        Assert::AreEqual(-1.0, result[0].magnetic_dipole, 1.0e-12);
+        Assert::AreEqual(-14.0, result[0].energy, 1.0e-12);
+        Assert::AreEqual(1.0, result[1].magnetic_dipole, 1.0e-12);
+        Assert::AreEqual(-4.0, result[1].energy, 1.0e-12);
+        Assert::IsTrue(s.Lattice(0) == Lattice2D(lattice_size_, vector<int>(lattice_size_, -1)));
+    }
+
+    TEST_METHOD(TransferMatrixExact)
+    {
+        PRINT_TEST_INFO("Transfer matrix against Kaufman (h = 0), and long tori against strips")
+
+        // The energy of `Ising2D::Analysis()` counts each bond twice.
+        const double T = 2.0;
+        IsingExact2D kaufman(4, T);
+        auto torus = TransferMatrix2D(4, 4).Evaluate(T, 0.0);
+        Assert::AreEqual(2.0 * kaufman.Energy(), torus.observable.energy, 1.0e-10);
+        Assert::AreEqual(4.0 * kaufman.SpecificHeat(), torus.specific_heat, 1.0e-8);
+        Assert::AreEqual(0.0, torus.observable.magnetic_dipole, 1.0e-12);
+
+        auto strip = TransferMatrix2D(4, 0).Evaluate(T, 0.3);
+        auto long_torus = TransferMatrix2D(4, 30).Evaluate(T, 0.3);
+        Assert::AreEqual(strip.free_energy, long_torus.free_energy, 1.0e-9);
+        Assert::AreEqual(strip.observable.magnetic_dipole, long_torus.observable.magnetic_dipole, 1.0e-8);
+        Assert::AreEqual(strip.susceptibility, long_torus.susceptibility, 1.0e-6);
+    }
+
+    TEST_METHOD(ReplicaSpinsInPlace)
+    {
+        PRINT_TEST_INFO("Spins of the replicas in place (as libising shares them), and settings checks")
+
+        const size_t kLanes = 16;
+        Ising2DReplicas<kLanes> s(lattice_size_);
+        s.Initialize({ { beta_, h_, 1 }, { beta_, -h_, 2 }, { 0.1, 0.0, 3 } });
+        for (size_t i = 0; i != 10; ++i)
+            s.Sweep();
+        auto spins = s.Spins();
+        for (size_t r = 0; r != s.LaneCount(); ++r)
+        {
+            auto lattice = s.Lattice(r);
+            for (size_t x = 0; x != lattice_size_; ++x)
+                for (size_t y = 0; y != lattice_size_; ++y)
+                    Assert::AreEqual(lattice[x][y],
+                        static_cast<int>(spins[(x * lattice_size_ + y) * kLanes + r]));
+        }
+
+        Parameter param;
+        param.ReadFromString("[4, 8]");
+        Assert::IsFalse(param.IsValid());
+        param.ReadFromString(kDefaultSettingsString);
+        Assert::IsTrue(param.IsValid());
+    }
+
+    TEST_METHOD(FastRandRange)
+    {
+        PRINT_TEST_INFO("FastRand() against kFastRandMax, whatever RAND_MAX is")
+
+        toolkit::FastRandInitialize(1);
+        unsigned int largest = 0;
+        for (size_t i = 0; i != 1 << 20; ++i)
+        {
+            auto value = toolkit::FastRand();
+            if (value > largest)
+                largest = value;
+        }
+        Assert::AreEqual(toolkit::kFastRandMax, largest);
+        for (size_t i = 0; i != 1 << 10; ++i)
+        {
+            auto uniform = toolkit::FastRandUniform();
+            Assert::IsTrue(uniform >= 0.0 && uniform < 1.0);
+        }
+    }
+
+    TEST_METHOD(PbcHighTemperature)
+    {
+        PRINT_TEST_INFO("Ising lattice disordered at T = 3 (PBC)")
+
+        // Accepting every flip would alternate between the two ordered states (E = -4, |m| = 1).
+        // The exact energy of the 16 * 16 torus at T = 3 is -1.635 (each bond counted twice).
+        toolkit::FastRandInitialize(1);
+        Ising2D_PBC s(16, 16);
+        s.Initialize();
+        auto result = s.Evaluate(1.0 / 3.0, 0.0, 2000, 1000);
+        Assert::AreEqual(-1.635, result.energy, 0.1);
+        Assert::IsTrue(result.magnetic_dipole_abs < 0.5);
+    }
+
+    TEST_METHOD(SpecificHeatPeakScan)
+    {
+        PRINT_TEST_INFO("Specific heat peak against a dense scan")
+
+        const double kStep = 1.0e-5;
+        for (size_t size : { 8, 16 })
+        {
+            auto peak = SpecificHeatPeak(size, 1.5, 3.5);
+            double scan_t = 0.0, scan_c = 0.0;
+            for (auto t = 2.0; t < 2.6; t += kStep)
+            {
+                auto c = IsingExact2D(size, t).SpecificHeat();
+                if (c > scan_c)
+                {
+                    scan_t = t;
+                    scan_c = c;
+                }
+            }
+            Assert::AreEqual(scan_t, peak.first, kStep);
+            // No point of the scan is above the peak.
+            Assert::IsTrue(peak.second >= scan_c - 1.0e-12);
+        }
+    }
+
+    TEST_METHOD(ExactAsymptoticPath)
+    {
+        PRINT_TEST_INFO("Infinite lattice fast path against the full Kaufman product")
+
+        // At L = 64 the critical window of the tolerance 1e-12 is about [1.69, 3.18].
+        const size_t kSize = 64;
+        size_t asymptotic_count = 0, window_count = 0;
+        for (size_t i = 0; i != 201; ++i)
+        {
+            auto T = 1.5 + 0.01 * i;
+            IsingExact2D fast(kSize, T, 1.0e-12), full(kSize, T);
+            if (fast.IsAsymptotic())
+            {
+                asymptotic_count += 1;
+                Assert::AreEqual(full.Energy(), fast.Energy(), 1.0e-12);
+                Assert::AreEqual(full.SpecificHeat(), fast.SpecificHeat(), 1.0e-12);
+            }
+            else
+            {
+                window_count += 1;
+                Assert::AreEqual(full.Energy(), fast.Energy());
+                Assert::AreEqual(full.SpecificHeat(), fast.SpecificHeat());
+            }
+        }
+        Assert::IsTrue(asymptotic_count > 0 && window_count > 0);
+        Assert::IsFalse(IsingExact2D(kSize, 1.0).IsAsymptotic());
+    }
+
+    TEST_METHOD(SmallMatchesPbc)
+    {
+        PRINT_TEST_INFO("Ising2DSmall<8> against Ising2D_PBC with the same random numbers")
+
+        // T = 3.3 is swept without a branch, and the others with one.
+        for (auto beta : { 0.3, 0.44, 0.6 })
+        {
+            toolkit::FastRandInitialize(7);
+            Ising2DSmall<8> small(8);
+            small.Initialize();
+            auto small_result = small.Evaluate(beta, h_, 200, 100);
+
+            toolkit::FastRandInitialize(7);
+            Ising2D_PBC pbc(8, 8);
+            pbc.Initialize();
+            auto pbc_result = pbc.Evaluate(beta, h_, 200, 100);
+
+            Assert::AreEqual(pbc_result.energy, small_result.energy);
+            Assert::AreEqual(pbc_result.magnetic_dipole, small_result.magnetic_dipole);
+            Assert::AreEqual(pbc_result.energy_square, small_result.energy_square);
+            Assert::IsTrue(pbc.Lattice() == small.Lattice());
+        }
+    }
+
+    TEST_METHOD(DatasetServerProtocol)
+    {
+        PRINT_TEST_INFO("Requests, header and records of the dataset server")
+
+        Parameter param;
+        param.iterations               = 100;
+        param.seed                     = 1;
+        param.server_temperature_count = 4;
+        param.server_sample_sweeps     = 2;
+        param.server_max_size          = 16;
+        param.server_max_chains        = 4;
+        DatasetServer server(param, "");
+
+        DatasetRequest request;
+        Assert::IsFalse(server.ParseRequest("", request));
+        Assert::IsFalse(server.ParseRequest("1 2.0 3.0 4", request));
+        Assert::IsFalse(server.ParseRequest("32 2.0 3.0 4", request));
+        Assert::IsFalse(server.ParseRequest("12 0.0 3.0 4", request));
+        Assert::IsFalse(server.ParseRequest("12 2.0 3.0 4294967296", request));
+        Assert::IsTrue(server.ParseRequest("12 2.0 3.0 4294967295", request));
+        Assert::IsTrue(server.ParseRequest("12 2.0 3.0 5 0.1", request));
+        Assert::AreEqual(0.1, request.magnetic_h);
+
+        // "ISNG", size, count and bytes per lattice (2 bytes per row).
+        auto header = server.Header(request);
+        Assert::AreEqual(size_t(16), header.size());
+        Assert::IsTrue(string(header.begin(), header.begin() + 4) == "ISNG");
+        uint32_t fields[3];
+        memcpy(fields, header.data() + 4, sizeof(fields));
+        Assert::AreEqual(uint32_t(12), fields[0]);
+        Assert::AreEqual(uint32_t(5), fields[1]);
+        Assert::AreEqual(uint32_t(24), fields[2]);
+
+        // The temperatures cycle through 4 points, and the labels match the lattices.
+        const double temperatures[] = { 2.0, 2.0 + 1.0 / 3.0, 2.0 + 2.0 / 3.0, 3.0, 2.0 };
+        for (size_t i = 0; i != 5; ++i)
+        {
+            vector<uint8_t> record;
+            server.Record(request, i, record);
+            Assert::AreEqual(size_t(4 * 8 + 24), record.size());
+            double labels[4];
+            memcpy(labels, record.data(), sizeof(labels));
+            Assert::AreEqual(temperatures[i], labels[0], 1.0e-12);
+            Assert::AreEqual(0.1, labels[1]);
+            double spin_total = 0.0;
+            for (size_t x = 0; x != 12; ++x)
+                for (size_t y = 0; y != 12; ++y)
+                {
+                    auto byte = record[4 * 8 + x * 2 + y / 8];
+                    spin_total += (byte >> (7 - y % 8)) & 1 ? 1.0 : -1.0;
+                }
+            Assert::AreEqual(spin_total / 144.0, labels[3], 1.0e-12);
+        }
+        Assert::AreEqual(size_t(4), server.ChainCount());
+
+        // The least recently used chain is dropped.
+        Assert::IsTrue(server.ParseRequest("8 2.5 2.5 1", request));
+        vector<uint8_t> record;
+        server.Record(request, 0, record);
+        Assert::AreEqual(size_t(4), server.ChainCount());
+    }
+
+    TEST_METHOD(NFoldWayExact)
+    {
+        PRINT_TEST_INFO("N-fold way against the exact results (L = 4 and 8)")
+
+        // The energy of `Analysis()` counts each bond twice. The tolerances are about 4
+        //   standard deviations of a run.
+        toolkit::FastRandInitialize(1);
+        Ising2DNFold small(4);
+        small.Initialize();
+        auto small_result = small.Evaluate(1.0 / 2.0, 0.0, 20000, 10000);
+        Assert::AreEqual(2.0 * IsingExact2D(4, 2.0).Energy(), small_result.energy, 0.06);
+
+        // Below T_c a run stays in the + state, so the field is tested at L = 8, where the
+        //   - state weighs about exp(-2 h L^2 / T) = 2e-4.
+        auto exact = TransferMatrix2D(8, 8).Evaluate(1.5, 0.1);
+        Ising2DNFold large(8);
+        large.Initialize();
+        auto large_result = large.Evaluate(1.0 / 1.5, 0.1, 20000, 10000);
+        Assert::AreEqual(exact.observable.energy, large_result.energy, 0.006);
+        Assert::AreEqual(exact.observable.magnetic_dipole, large_result.magnetic_dipole, 0.002);
+    }
+
+    TEST_METHOD(ReplicasExact)
+    {
+        PRINT_TEST_INFO("Lockstep replicas against the transfer matrix (L = 8)")
+
+        // Lanes 0-3 at T = 1.5 and 4-7 at T = 2.5, averaged. The tolerances are about 4
+        //   standard deviations of the average.
+        vector<ReplicaLane> lanes;
+        for (unsigned int i = 0; i != 8; ++i)
+            lanes.push_back({ i < 4 ? 1.0 / 1.5 : 1.0 / 2.5, 0.1, i + 1 });
+        Ising2DReplicas<16> s(8);
+        s.Initialize(lanes);
+        auto result = s.Evaluate(20000, 10000);
+        const double tolerance[][2] = { { 0.005, 0.002 }, { 0.04, 0.04 } };
+        for (size_t k = 0; k != 2; ++k)
+        {
+            auto exact = TransferMatrix2D(8, 8).Evaluate(k == 0 ? 1.5 : 2.5, 0.1);
+            double energy = 0.0, magnetic_dipole = 0.0;
+            for (size_t r = 4 * k; r != 4 * k + 4; ++r)
+            {
+                energy += result[r].energy / 4.0;
+                magnetic_dipole += result[r].magnetic_dipole / 4.0;
+            }
+            Assert::AreEqual(exact.observable.energy, energy, tolerance[k][0]);
+            Assert::AreEqual(exact.observable.magnetic_dipole, magnetic_dipole, tolerance[k][1]);
+        }
+    }
+
+    TEST_METHOD(ChebyshevMissedTolerance)
+    {
+        PRINT_TEST_INFO("Chebyshev pieces missing the tolerance at the maximum depth")
+
+        // No polynomial fits the step, so the pieces around it are bisected to the maximum
+        //   depth and then marked, while the smooth parts are fitted.
+        toolkit::Chebyshev f_approx;
+        f_approx.Fit([](double x) { return x < 0.3 ? 0.0 : 1.0; }, 0.0, 1.0, 1.0e-6);
+        Assert::IsFalse(f_approx.Accurate(0.3));
+        Assert::IsTrue(std::isnan(f_approx(0.3)));
+        Assert::IsTrue(f_approx.Accurate(0.1) && f_approx.Accurate(0.9));
+        Assert::AreEqual(0.0, f_approx(0.1), 1.0e-6);
+        Assert::AreEqual(1.0, f_approx(0.9), 1.0e-6);
+    }
+
+    TEST_METHOD(LibraryInterface)
+    {
+        PRINT_TEST_INFO("C interface of libising: lane order, spins in place, and invalid settings")
+
+        // Lanes in the order (temperature, field, repetition). At T = 0.1 the field -10 flips
+        //   every spin at the first sweep, and the spins stay +1 without it.
+        auto simulator = ising_create("{ \"size.list\": [8], \"temperature.list\": [0.1, 100.0], "
+            "\"externalMagneticField.list\": [-10.0, 0.0], \"repetitions\": 2, \"seed\": 1 }");
+        Assert::IsTrue(simulator != nullptr);
+        Assert::AreEqual(size_t(8), ising_lane_count(simulator));
+        for (size_t lane = 0; lane != 8; ++lane)
+        {
+            double temperature = 0.0, magnetic_h = 0.0;
+            Assert::AreEqual(ISING_OK, ising_lane(simulator, lane, &temperature, &magnetic_h));
+            Assert::AreEqual(lane < 4 ? 0.1 : 100.0, temperature);
+            Assert::AreEqual(lane % 4 < 2 ? -10.0 : 0.0, magnetic_h);
+        }
+        Assert::AreEqual(ISING_OK, ising_sweep(simulator, 1));
+
+        // 8 lanes are swept as 16, so the lanes of a site are 16 bytes apart.
+        ising_lattice_view view;
+        Assert::AreEqual(ISING_OK, ising_lattice(simulator, &view));
+        Assert::AreEqual(size_t(3), view.ndim);
+        for (size_t i = 0; i != 3; ++i)
+            Assert::AreEqual(size_t(8), view.shape[i]);
+        Assert::IsTrue(view.strides[0] == 1 && view.strides[1] == 8 * 16 && view.strides[2] == 16);
+
+        vector<ising_observable> observables(8);
+        Assert::AreEqual(ISING_ERROR, ising_analysis(simulator, observables.data(), 7));
+        Assert::AreEqual(ISING_OK, ising_analysis(simulator, observables.data(), 8));
+        for (size_t lane = 0; lane != 8; ++lane)
+        {
+            double spin_total = 0.0;
+            for (size_t x = 0; x != 8; ++x)
+                for (size_t y = 0; y != 8; ++y)
+                    spin_total += view.data[lane * view.strides[0] + x * view.strides[1]
+                        + y * view.strides[2]];
+            Assert::AreEqual(observables[lane].magnetic_dipole, spin_total / 64.0, 1.0e-12);
+            if (lane < 2)
+                Assert::AreEqual(-1.0, spin_total / 64.0);
+            else if (lane < 4)
+                Assert::AreEqual(1.0, spin_total / 64.0);
+        }
+        ising_destroy(simulator);
+
+        // Values of wrong types and negative counts are reported, instead of failing the
+        //   assertions of rapidjson or running (almost) forever.
+        for (auto settings : { "{ \"size.list\": 8 }",
+            "{ \"size.list\": [8], \"temperature.span\": { \"begin\": 1.0, \"end\": 2.0 } }",
+            "{ \"size.list\": [8], \"iterations\": 1.5 }",
+            "{ \"size.list\": [8], \"iterations\": -1 }", "[8]" })
+        {
+            Assert::IsTrue(ising_create(settings) == nullptr);
+            Assert::IsTrue(ising_last_error()[0] != '\0');
+        }
+    }
+
 private:
     template<typename T>
     void _WriteRowMessage(const T & s, const size_t & index)
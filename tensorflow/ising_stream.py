@@ -0,0 +1,70 @@
+"""Streaming lattices from the dataset server (`ising --serve <socket>`).
+"""
+
+import socket
+import struct
+import numpy as np
+
+
+class IsingStream:
+    """
+    Client of the dataset server, see "ising/core/dataset-server.h".
+
+    Functions
+    ---------
+
+        next_batch(batch_size: int)
+        close()
+
+    Attributes
+    ----------
+
+        socket_path: Path of the Unix domain socket of the server.
+        size: Lattice size L.
+        temperature: `(begin, end)` of the temperature range.
+        count: Number of lattices to stream. Default value 0 means an endless stream.
+        magnetic_field: External magnetic field. Default value is 0.
+    """
+
+    _HEADER = struct.Struct('<4sIII')
+    _LABELS = struct.Struct('<4d')
+
+    def __init__(self, socket_path, size, temperature, count=0, magnetic_field=0.0):
+        self.socket_path = socket_path
+        self.size = size
+        self.temperature = temperature
+        self.count = count
+        self.magnetic_field = magnetic_field
+
+        self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self._socket.connect(socket_path)
+        request = '{} {} {} {} {}\n'.format(size, temperature[0], temperature[1], count,
+                                            magnetic_field)
+        self._socket.sendall(request.encode('ascii'))
+        self._file = self._socket.makefile('rb')
+
+        header = self._file.read(self._HEADER.size)
+        if len(header) != self._HEADER.size or not header.startswith(b'ISNG'):
+            self.close()
+            raise ValueError('Invalid request: ' + request.strip())
+        _, _, _, self._lattice_bytes = self._HEADER.unpack(header)
+
+    def next_batch(self, batch_size):
+        """Return `(lattices, labels)` of at most `batch_size` lattices, where `lattices` are
+        +1 / -1 arrays of shape `[N, L, L]` and `labels` has the columns (temperature, field,
+        energy, magnetization). `N` is 0 at the end of the stream.
+        """
+        record_bytes = self._LABELS.size + self._lattice_bytes
+        data = self._file.read(record_bytes * batch_size)
+        n = len(data) // record_bytes
+        records = np.frombuffer(data[:n * record_bytes], dtype=np.uint8).reshape(n, record_bytes)
+        labels = records[:, :self._LABELS.size].copy().view('<f8')
+        bits = records[:, self._LABELS.size:].reshape(n, self.size, self._lattice_bytes // self.size)
+        lattices = np.unpackbits(bits, axis=-1)[..., :self.size].astype(np.int8) * 2 - 1
+        return lattices, labels
+
+    def close(self):
+        """Close the connection.
+        """
+        self._file.close()
+        self._socket.close()